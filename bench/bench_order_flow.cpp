@@ -0,0 +1,130 @@
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/market_manager.hpp"
+#include "order_flow.hpp"
+
+namespace {
+
+const Symbol symbol{0, "USDRUB"};
+
+OrderBookOptions BookOptions(int64_t layout) {
+    return (layout == 0) ? OrderBookOptions::Tree() : OrderBookOptions::Ladder(1);
+}
+
+// Benchmarks resting orders count, mean depth in ticks and layout (0 tree, 1 ladder)
+void DepthArgs(benchmark::internal::Benchmark *benchmark) {
+    for (int64_t layout = 0; layout < 2; ++layout) {
+        benchmark->Args({10000, 10, layout});
+        benchmark->Args({1000000, 100, layout});
+    }
+}
+
+}
+
+// Passive adds into a book already holding the given number of orders. Every batch of adds is cancelled untimed, so
+// the depth stays where it started.
+static void BM_PassiveAdd(benchmark::State &state) {
+    constexpr size_t batch = 1024;
+    OrderFlowOptions options;
+    options.MeanDepthTicks = double(state.range(1));
+    OrderFlow flow(symbol, options);
+
+    MarketManager market_manager;
+    flow.Setup(market_manager, BookOptions(state.range(2)));
+    flow.Fill(market_manager, size_t(state.range(0)));
+
+    size_t added = 0;
+    for (auto _: state) {
+        market_manager.AddOrder(flow.Passive());
+
+        if (++added == batch) {
+            state.PauseTiming();
+            for (size_t i = 0; i < batch; ++i)
+                market_manager.DeleteOrder(flow.CancelLast());
+            added = 0;
+            state.ResumeTiming();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_PassiveAdd)->Apply(DepthArgs)->Unit(benchmark::kNanosecond);
+
+// Every add is matched by a cancel of a random resting order, the flow of a quoting market maker
+static void BM_CancelHeavy(benchmark::State &state) {
+    OrderFlowOptions options;
+    options.MeanDepthTicks = double(state.range(1));
+    OrderFlow flow(symbol, options);
+
+    MarketManager market_manager;
+    flow.Setup(market_manager, BookOptions(state.range(2)));
+    flow.Fill(market_manager, size_t(state.range(0)));
+
+    for (auto _: state) {
+        market_manager.AddOrder(flow.Passive());
+        market_manager.DeleteOrder(flow.Cancel());
+    }
+
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+BENCHMARK(BM_CancelHeavy)->Apply(DepthArgs)->Unit(benchmark::kNanosecond);
+
+// One aggressive buy sweeps the given number of ask levels, four orders each
+static void BM_Sweep(benchmark::State &state) {
+    constexpr boost::uint64_t orders_per_level = 4;
+    const auto levels = (boost::uint64_t) state.range(0);
+    const User user{0, "user0"};
+    const boost::uint64_t price = 1000000;
+
+    std::unique_ptr<MarketManager> market_manager_ptr;
+
+    for (auto _: state) {
+        state.PauseTiming();
+
+        market_manager_ptr = std::make_unique<MarketManager>();
+        MarketManager &market_manager = *market_manager_ptr;
+        market_manager.AddSymbol(symbol);
+        market_manager.AddOrderBook(symbol, BookOptions(state.range(1)));
+        market_manager.AddUser(user);
+
+        boost::uint64_t id = 1;
+        for (boost::uint64_t i = 0; i < levels; ++i)
+            for (boost::uint64_t j = 0; j < orders_per_level; ++j)
+                market_manager.AddOrder(Order::Sell(id++, symbol.Id, user.Id, price + i, 10));
+
+        state.ResumeTiming();
+
+        market_manager.AddOrder(Order::Buy(id++, symbol.Id, user.Id, price + levels, 10 * orders_per_level * levels));
+
+        state.PauseTiming();
+        market_manager_ptr.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * levels * orders_per_level);
+}
+
+BENCHMARK(BM_Sweep)->ArgsProduct({{10, 100, 1000}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+// Passive adds, cancels and aggressive orders in proportions close to a busy lit book
+static void BM_MixedFlow(benchmark::State &state) {
+    OrderFlowOptions options;
+    options.CancelRatio = 0.45;
+    options.AggressiveRatio = 0.1;
+    OrderFlow flow(symbol, options);
+
+    MarketManager market_manager;
+    flow.Setup(market_manager, BookOptions(state.range(0)));
+    flow.Fill(market_manager, 10000);
+
+    for (auto _: state)
+        flow.Apply(market_manager);
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_MixedFlow)->Arg(0)->Arg(1)->Unit(benchmark::kNanosecond);
@@ -0,0 +1,53 @@
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/market_manager.hpp"
+
+// One aggressive buy lifts the offer and trips a ladder of resting buy stops, each of which lifts the offer further.
+// The second argument puts a trailing buy stop behind every plain one, so that plain stops keep coming into range
+// while trailing ones are already triggered.
+static void BM_StopCascade(benchmark::State &state) {
+    const auto stops = (boost::uint64_t) state.range(0);
+    const bool trailing = state.range(1) != 0;
+    const boost::uint64_t orders = trailing ? 2 * stops : stops;
+    const Symbol symbol{0, "USDRUB"};
+    const User user{0, "user0"};
+
+    std::unique_ptr<MarketManager> market_manager_ptr;
+
+    for (auto _: state) {
+        state.PauseTiming();
+
+        market_manager_ptr = std::make_unique<MarketManager>();
+        MarketManager &market_manager = *market_manager_ptr;
+        market_manager.AddSymbol(symbol);
+        market_manager.AddOrderBook(symbol);
+        market_manager.AddUser(user);
+
+        boost::uint64_t id = 1;
+        boost::uint64_t price = 1000000;
+
+        for (boost::uint64_t i = 0; i <= orders; ++i)
+            market_manager.AddOrder(Order::Sell(id++, symbol.Id, user.Id, price + i, 1));
+
+        for (boost::uint64_t i = 0; i < stops; ++i) {
+            market_manager.AddOrder(Order::BuyStopLimit(id++, symbol.Id, user.Id, price + orders, price + 1 + i / 4, 1));
+            if (trailing)
+                market_manager.AddOrder(Order::TrailingBuyStopLimit(id++, symbol.Id, user.Id, price + orders, price + 1,
+                                                                    1, 1, 1));
+        }
+
+        state.ResumeTiming();
+
+        market_manager.AddOrder(Order::Buy(id++, symbol.Id, user.Id, price, 1));
+
+        state.PauseTiming();
+        market_manager_ptr.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * orders);
+}
+
+BENCHMARK(BM_StopCascade)->ArgsProduct({{1000, 10000}, {0, 1}})->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,43 @@
+#include <benchmark/benchmark.h>
+
+#include "../src/market_manager.hpp"
+
+// Walks the market down one tick per iteration against a book full of resting trailing buy stops. The trailing
+// steps are spread out, so only a small share of the stops is repriced on any given tick.
+static void BM_TrailingStopRepricing(benchmark::State &state) {
+    const auto stops = (boost::uint64_t) state.range(0);
+    const Symbol symbol{0, "USDRUB"};
+    const User user{0, "user0"};
+
+    MarketManager market_manager;
+    market_manager.AddSymbol(symbol);
+    market_manager.AddOrderBook(symbol);
+    market_manager.AddUser(user);
+
+    boost::uint64_t id = 1;
+    boost::uint64_t price = 1000000000;
+
+    market_manager.AddOrder(Order::Sell(id++, symbol.Id, user.Id, price, 2));
+    market_manager.AddOrder(Order::Buy(id++, symbol.Id, user.Id, price, 1));
+    boost::uint64_t ask_id = 1;
+
+    for (boost::uint64_t i = 0; i < stops; ++i)
+        market_manager.AddOrder(Order::TrailingBuyStopLimit(id++, symbol.Id, user.Id, 2 * price, 2 * price, 1,
+                                                            (boost::int64_t) (10 + i % 100),
+                                                            (boost::int64_t) (100 + i % 1000)));
+
+    for (auto _: state) {
+        --price;
+
+        market_manager.AddOrder(Order::Sell(id, symbol.Id, user.Id, price, 2));
+        market_manager.AddOrder(Order::Buy(id + 1, symbol.Id, user.Id, price, 1));
+        market_manager.DeleteOrder(ask_id);
+
+        ask_id = id;
+        id += 2;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TrailingStopRepricing)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
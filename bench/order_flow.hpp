@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../src/market_manager.hpp"
+
+// Shape of a synthetic order flow. Passive orders rest a geometrically distributed number of ticks away from the mid,
+// so most of them crowd the touch and a thin tail reaches deep into the book, and their quantities are a lognormal
+// number of lots. The ratios are the shares of cancels and of aggressive orders, the rest are passive adds.
+class OrderFlowOptions {
+public:
+    boost::uint64_t MidPrice = 1000000;
+    boost::uint64_t TickSize = 1;
+    double MeanDepthTicks = 10;
+    boost::uint64_t MaxDepthTicks = 1000;
+    boost::uint64_t LotSize = 10;
+    double QuantitySigma = 1;
+    double CancelRatio = 0;
+    double AggressiveRatio = 0;
+    boost::uint64_t Users = 16;
+    unsigned Seed = 1;
+};
+
+// Deterministic generator of passive adds, cancels of orders it added and aggressive orders that cross a few ticks
+// into the opposite side and rest what they do not fill. Cancels pick a random order among those it added and not
+// cancelled yet, some of which may have been filled.
+class OrderFlow {
+public:
+    enum class Command : boost::uint8_t {
+        ADD,
+        CANCEL
+    };
+
+    OrderFlow(const Symbol &symbol, const OrderFlowOptions &options) : symbol_(symbol), options_(options),
+                                                                        random_(options.Seed),
+                                                                        depth_(1.0 / (1.0 + options.MeanDepthTicks)),
+                                                                        lots_(0, options.QuantitySigma),
+                                                                        unit_(0, 1), next_id_(1) {
+    }
+
+    [[nodiscard]] const OrderFlowOptions &options() const noexcept { return options_; }
+
+    [[nodiscard]] boost::uint64_t next_id() const noexcept { return next_id_; }
+
+    // Adds the symbol, its book and the users to a market manager
+    void Setup(MarketManager &market_manager, const OrderBookOptions &book_options = OrderBookOptions()) const {
+        market_manager.AddSymbol(symbol_);
+        market_manager.AddOrderBook(symbol_, book_options);
+        for (boost::uint64_t user_id = 0; user_id < options_.Users; ++user_id)
+            market_manager.AddUser(User(user_id, "user" + std::to_string(user_id)));
+    }
+
+    Order Passive() {
+        bool buy = (random_() % 2) == 0;
+        boost::uint64_t ticks = 1 + std::min<boost::uint64_t>(depth_(random_), options_.MaxDepthTicks - 1);
+        boost::uint64_t price = buy ? options_.MidPrice - ticks * options_.TickSize
+                                    : options_.MidPrice + ticks * options_.TickSize;
+        return Make(buy, price);
+    }
+
+    // Crosses up to the given number of ticks past the mid, the unfilled rest stays in the book
+    Order Aggressive(boost::uint64_t ticks = 3) {
+        bool buy = (random_() % 2) == 0;
+        boost::uint64_t price = buy ? options_.MidPrice + ticks * options_.TickSize
+                                    : options_.MidPrice - ticks * options_.TickSize;
+        return Make(buy, price);
+    }
+
+    // Removes a random order from the tracked ones and returns its id, zero when none is left
+    boost::uint64_t Cancel() {
+        if (live_.empty())
+            return 0;
+        size_t index = random_() % live_.size();
+        boost::uint64_t id = live_[index];
+        live_[index] = live_.back();
+        live_.pop_back();
+        return id;
+    }
+
+    // Removes the most recently added order from the tracked ones and returns its id, zero when none is left
+    boost::uint64_t CancelLast() {
+        if (live_.empty())
+            return 0;
+        boost::uint64_t id = live_.back();
+        live_.pop_back();
+        return id;
+    }
+
+    // Applies one command drawn with the configured ratios
+    Command Apply(MarketManager &market_manager) {
+        double draw = unit_(random_);
+        if (draw < options_.CancelRatio) {
+            market_manager.DeleteOrder(Cancel());
+            return Command::CANCEL;
+        }
+        market_manager.AddOrder((draw < options_.CancelRatio + options_.AggressiveRatio) ? Aggressive() : Passive());
+        return Command::ADD;
+    }
+
+    // Rests the given number of passive orders in the book
+    void Fill(MarketManager &market_manager, size_t orders) {
+        for (size_t i = 0; i < orders; ++i)
+            market_manager.AddOrder(Passive());
+    }
+
+private:
+    Symbol symbol_;
+    OrderFlowOptions options_;
+    std::mt19937_64 random_;
+    std::geometric_distribution<boost::uint64_t> depth_;
+    std::lognormal_distribution<double> lots_;
+    std::uniform_real_distribution<double> unit_;
+    boost::uint64_t next_id_;
+    std::vector<boost::uint64_t> live_;
+
+    Order Make(bool buy, boost::uint64_t price) {
+        boost::uint64_t user_id = random_() % options_.Users;
+        boost::uint64_t quantity = options_.LotSize * std::max<boost::uint64_t>(1, std::llround(lots_(random_)));
+        live_.push_back(next_id_);
+        return buy ? Order::Buy(next_id_++, symbol_.Id, user_id, price, quantity)
+                   : Order::Sell(next_id_++, symbol_.Id, user_id, price, quantity);
+    }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+
+#include "errors.hpp"
+#include "order.hpp"
+
+static_assert(std::endian::native == std::endian::little, "The binary protocol is sent in host byte order");
+
+enum class BinaryMessageType : boost::uint8_t {
+    REGISTER = 1,
+    BALANCE,
+    ADD_ORDER,
+    CANCEL_ORDER,
+    REPLACE_ORDER,
+    MODIFY_ORDER,
+    ACK = 128
+};
+
+// Order entry wire format. Every message starts with a header whose Size counts the whole message, header included;
+// all integers are little endian and there is no padding. Every request is answered with exactly one Ack.
+#pragma pack(push, 1)
+
+class BinaryHeader {
+public:
+    boost::uint16_t Size;
+    BinaryMessageType Type;
+};
+
+class RegisterRequest {
+public:
+    static constexpr size_t MaxUsername = 32;
+
+    BinaryHeader Header;
+    char Username[MaxUsername];
+};
+
+class BalanceRequest {
+public:
+    BinaryHeader Header;
+};
+
+class AddOrderRequest {
+public:
+    BinaryHeader Header;
+    boost::uint64_t SymbolId;
+    OrderSide Side;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+};
+
+class CancelOrderRequest {
+public:
+    BinaryHeader Header;
+    boost::uint64_t SymbolId;
+    boost::uint64_t OrderId;
+};
+
+// Cancels the order and enters a new one with the given price and quantity, the Ack carries the id of the new order
+class ReplaceOrderRequest {
+public:
+    BinaryHeader Header;
+    boost::uint64_t SymbolId;
+    boost::uint64_t OrderId;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+};
+
+// Changes the price and the open quantity of the order in place, keeping its id. A smaller quantity at the same price
+// keeps the time priority of the order, any other change loses it.
+class ModifyOrderRequest {
+public:
+    BinaryHeader Header;
+    boost::uint64_t SymbolId;
+    boost::uint64_t OrderId;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+};
+
+// Value is the user id for REGISTER and the balance for BALANCE
+class AckMessage {
+public:
+    BinaryHeader Header;
+    BinaryMessageType Request;
+    ErrorCode Error;
+    boost::uint64_t OrderId;
+    boost::int64_t Value;
+};
+
+#pragma pack(pop)
+
+constexpr size_t MaxBinaryMessageSize = 256;
+
+// Size a well-formed message of the given type must have, zero for an unknown type
+constexpr size_t GetBinaryMessageSize(BinaryMessageType type) noexcept {
+    switch (type) {
+        case BinaryMessageType::REGISTER:
+            return sizeof(RegisterRequest);
+        case BinaryMessageType::BALANCE:
+            return sizeof(BalanceRequest);
+        case BinaryMessageType::ADD_ORDER:
+            return sizeof(AddOrderRequest);
+        case BinaryMessageType::CANCEL_ORDER:
+            return sizeof(CancelOrderRequest);
+        case BinaryMessageType::REPLACE_ORDER:
+            return sizeof(ReplaceOrderRequest);
+        case BinaryMessageType::MODIFY_ORDER:
+            return sizeof(ModifyOrderRequest);
+        case BinaryMessageType::ACK:
+            return sizeof(AckMessage);
+    }
+    return 0;
+}
+
+// Copies a message out of a receive buffer that holds at least sizeof(Message) bytes
+template<typename Message>
+Message DecodeBinaryMessage(const boost::uint8_t *data) noexcept {
+    Message message;
+    std::memcpy(&message, data, sizeof(message));
+    return message;
+}
+
+template<typename Message>
+void EncodeBinaryMessage(const Message &message, boost::uint8_t *data) noexcept {
+    std::memcpy(data, &message, sizeof(message));
+}
+
+inline AckMessage MakeAck(BinaryMessageType request, ErrorCode error, boost::uint64_t order_id = 0,
+                          boost::int64_t value = 0) noexcept {
+    return {{sizeof(AckMessage), BinaryMessageType::ACK}, request, error, order_id, value};
+}
@@ -0,0 +1,364 @@
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include "binary_session.hpp"
+
+BinarySession::BinarySession(boost::asio::io_service &io_service, MarketManager &market_manager,
+                             ShardedEngine *engine_ptr, EngineIds &engine_ids, IoStrand &engine_strand)
+        : strand_(boost::asio::make_strand(io_service)), socket_(strand_), market_manager_(market_manager),
+          engine_ptr_(engine_ptr), engine_ids_(engine_ids), engine_strand_(engine_strand),
+          user_id_(std::numeric_limits<boost::uint64_t>::max()), batch_size_(0), current_(0), malformed_(false),
+          reply_ready_(strand_, StrandTimer::time_point::max()),
+          reply_slots_free_(strand_, StrandTimer::time_point::max()), reading_(true),
+          writer_waiting_(false), reader_waiting_(false) {
+    gather_.reserve(MaxGatheredReplies);
+    batch_.reserve(replies_.capacity());
+    if (engine_ptr_ != nullptr)
+        pending_ = std::make_unique<Pending[]>(replies_.capacity());
+}
+
+void BinarySession::Start() {
+    auto self = shared_from_this();
+    boost::asio::co_spawn(strand_, ReadLoop(self), boost::asio::detached);
+    boost::asio::co_spawn(strand_, WriteLoop(self), boost::asio::detached);
+}
+
+StrandAwaitable<> BinarySession::ReadLoop(std::shared_ptr<BinarySession> self) {
+    boost::system::error_code error;
+    for (;;) {
+        bool valid = CollectRequests();
+        if (!batch_.empty()) {
+            co_await ExecuteOnEngine(engine_strand_, [this]() { ExecuteBatch(); }, use_strand_awaitable);
+            CompleteBatch();
+        }
+
+        // A malformed request closes the session
+        if (!valid || malformed_) {
+            socket_.close();
+            break;
+        }
+
+        if (replies_.full()) {
+            reader_waiting_ = true;
+            co_await reply_slots_free_.async_wait(boost::asio::redirect_error(use_strand_awaitable, error));
+            reader_waiting_ = false;
+            if (!socket_.is_open())
+                break;
+            continue;
+        }
+
+        size_t bytes_transferred = co_await socket_.async_read_some(
+                boost::asio::buffer(buffer_.Prepare(MaxBinaryMessageSize), buffer_.available()),
+                boost::asio::redirect_error(use_strand_awaitable, error));
+        if (error)
+            break;
+        buffer_.Commit(bytes_transferred);
+    }
+
+    // Cancel on disconnect: the orders of a user do not outlive its session
+    if (registered())
+        co_await ExecuteOnEngine(engine_strand_, [this]() { CancelAllOrders(); }, use_strand_awaitable);
+
+    // The writer still sends the acks the engine owes
+    reading_ = false;
+    if (writer_waiting_)
+        reply_ready_.cancel();
+}
+
+StrandAwaitable<> BinarySession::WriteLoop(std::shared_ptr<BinarySession> self) {
+    boost::system::error_code error;
+    for (;;) {
+        while (!replies_.ready()) {
+            if (!reading_ && (replies_.empty() || !socket_.is_open()))
+                co_return;
+
+            writer_waiting_ = true;
+            co_await reply_ready_.async_wait(boost::asio::redirect_error(use_strand_awaitable, error));
+            writer_waiting_ = false;
+        }
+
+        gather_.clear();
+        size_t gathered = replies_.Gather([this](const EncodedAck &ack) {
+            gather_.push_back(boost::asio::buffer(ack));
+        }, MaxGatheredReplies);
+
+        // A view, the write keeps copies of the buffer sequence
+        std::span<const boost::asio::const_buffer> buffers(gather_.data(), gather_.size());
+        co_await boost::asio::async_write(socket_, buffers,
+                                          boost::asio::redirect_error(use_strand_awaitable, error));
+        if (error) {
+            socket_.close();
+            if (reader_waiting_)
+                reply_slots_free_.cancel();
+            co_return;
+        }
+
+        replies_.Pop(gathered);
+        if (reader_waiting_ && (replies_.size() < replies_.capacity() / 2))
+            reply_slots_free_.cancel();
+    }
+}
+
+bool BinarySession::CollectRequests() {
+    batch_.clear();
+    batch_size_ = 0;
+    while (!replies_.full() && (buffer_.size() - batch_size_ >= sizeof(BinaryHeader))) {
+        auto header = DecodeBinaryMessage<BinaryHeader>(buffer_.data() + batch_size_);
+        if ((header.Size != GetBinaryMessageSize(header.Type)) || (header.Type == BinaryMessageType::ACK))
+            return false;
+        if (buffer_.size() - batch_size_ < header.Size)
+            break;
+
+        batch_.push_back(BatchRequest{replies_.Reserve(), batch_size_, false, {}});
+        batch_size_ += header.Size;
+    }
+    return true;
+}
+
+void BinarySession::ExecuteBatch() {
+    for (current_ = 0; current_ < batch_.size(); ++current_) {
+        if (!HandleRequest(buffer_.data() + batch_[current_].Offset)) {
+            malformed_ = true;
+            break;
+        }
+    }
+}
+
+void BinarySession::CompleteBatch() {
+    for (const auto &request: batch_)
+        if (request.Replied)
+            replies_.Complete(request.Sequence, request.Ack);
+    buffer_.Consume(batch_size_);
+
+    if (writer_waiting_ && replies_.ready())
+        reply_ready_.cancel();
+}
+
+void BinarySession::CancelAllOrders() {
+    if (engine_ptr_ != nullptr)
+        engine_ptr_->CancelAllOrders(0, user_id_);
+    else
+        market_manager_.CancelAllOrders(user_id_);
+}
+
+bool BinarySession::HandleRequest(const boost::uint8_t *data) {
+    switch (DecodeBinaryMessage<BinaryHeader>(data).Type) {
+        case BinaryMessageType::REGISTER:
+            return HandleRegister(DecodeBinaryMessage<RegisterRequest>(data));
+        case BinaryMessageType::BALANCE:
+            return HandleBalance(DecodeBinaryMessage<BalanceRequest>(data));
+        case BinaryMessageType::ADD_ORDER:
+            return HandleAddOrder(DecodeBinaryMessage<AddOrderRequest>(data));
+        case BinaryMessageType::CANCEL_ORDER:
+            return HandleCancelOrder(DecodeBinaryMessage<CancelOrderRequest>(data));
+        case BinaryMessageType::REPLACE_ORDER:
+            return HandleReplaceOrder(DecodeBinaryMessage<ReplaceOrderRequest>(data));
+        case BinaryMessageType::MODIFY_ORDER:
+            return HandleModifyOrder(DecodeBinaryMessage<ModifyOrderRequest>(data));
+        case BinaryMessageType::ACK:
+            break;
+    }
+    return false;
+}
+
+void BinarySession::Reply(const AckMessage &ack) {
+    BatchRequest &request = batch_[current_];
+    EncodeBinaryMessage(ack, request.Ack.data());
+    request.Replied = true;
+}
+
+void BinarySession::Reply(boost::uint64_t sequence, const AckMessage &ack) {
+    EncodedAck encoded;
+    EncodeBinaryMessage(ack, encoded.data());
+    replies_.Complete(sequence, encoded);
+    if (writer_waiting_ && replies_.ready())
+        reply_ready_.cancel();
+}
+
+void BinarySession::OnEngineReply(boost::uint64_t sequence, boost::uint8_t type, ErrorCode error,
+                                  boost::uint64_t order_id, boost::int64_t value) {
+    auto request = static_cast<BinaryMessageType>(type);
+    if (request == BinaryMessageType::REGISTER)
+        value = (error == ErrorCode::OK) ? boost::int64_t(user_id_) : 0;
+
+    Reply(sequence, MakeAck(request, error, order_id, value));
+}
+
+bool BinarySession::HandleRegister(const RegisterRequest &request) {
+    if (registered()) {
+        Reply(MakeAck(BinaryMessageType::REGISTER, ErrorCode::USER_DUPLICATE, 0, boost::int64_t(user_id_)));
+        return true;
+    }
+
+    if (engine_ptr_ != nullptr) {
+        user_id_ = engine_ids_.NextUserId++;
+        engine_ptr_->AddUser(0, user_id_, &Pending::OnResult,
+                             NewPending(BinaryMessageType::REGISTER, 0, engine_ptr_->shards()));
+        return true;
+    }
+
+    boost::uint64_t user_id = market_manager_.users().size();
+    std::string username(request.Username, strnlen(request.Username, RegisterRequest::MaxUsername));
+
+    ErrorCode error = market_manager_.AddUser(User(user_id, std::move(username)));
+    if (error == ErrorCode::OK)
+        user_id_ = user_id;
+
+    Reply(MakeAck(BinaryMessageType::REGISTER, error, 0, (error == ErrorCode::OK) ? boost::int64_t(user_id) : 0));
+    return true;
+}
+
+bool BinarySession::HandleBalance(const BalanceRequest &) {
+    if (!registered()) {
+        Reply(MakeAck(BinaryMessageType::BALANCE, ErrorCode::USER_NOT_FOUND));
+        return true;
+    }
+
+    if (engine_ptr_ != nullptr) {
+        engine_ptr_->GetBalance(0, user_id_, &Pending::OnResult,
+                                NewPending(BinaryMessageType::BALANCE, 0, engine_ptr_->shards()));
+        return true;
+    }
+
+    Reply(MakeAck(BinaryMessageType::BALANCE, ErrorCode::OK, 0, market_manager_.GetUser(user_id_)->Balance));
+    return true;
+}
+
+bool BinarySession::HandleAddOrder(const AddOrderRequest &request) {
+    if ((request.Side != OrderSide::BUY) && (request.Side != OrderSide::SELL))
+        return false;
+
+    if (!registered() || (request.Quantity == 0)) {
+        Reply(MakeAck(BinaryMessageType::ADD_ORDER,
+                      registered() ? ErrorCode::ORDER_QUANTITY_INVALID : ErrorCode::USER_NOT_FOUND));
+        return true;
+    }
+
+    if (engine_ptr_ != nullptr) {
+        boost::uint64_t order_id = engine_ids_.NextOrderId++;
+        engine_ptr_->AddOrder(0, Order(order_id, request.SymbolId, user_id_, request.Side, request.Price, 0,
+                                       request.Quantity), &Pending::OnResult,
+                              NewPending(BinaryMessageType::ADD_ORDER, order_id, 1));
+        return true;
+    }
+
+    boost::uint64_t order_id = market_manager_.GetOrdersCount();
+    ErrorCode error = market_manager_.AddOrder(Order(order_id, request.SymbolId, user_id_, request.Side,
+                                                     request.Price, 0, request.Quantity));
+
+    Reply(MakeAck(BinaryMessageType::ADD_ORDER, error, order_id));
+    return true;
+}
+
+bool BinarySession::HandleCancelOrder(const CancelOrderRequest &request) {
+    if (!registered()) {
+        Reply(MakeAck(BinaryMessageType::CANCEL_ORDER, ErrorCode::USER_NOT_FOUND, request.OrderId));
+        return true;
+    }
+
+    if (engine_ptr_ != nullptr) {
+        engine_ptr_->DeleteOrder(0, request.SymbolId, request.OrderId, user_id_, &Pending::OnResult,
+                                 NewPending(BinaryMessageType::CANCEL_ORDER, request.OrderId, 1));
+        return true;
+    }
+
+    const Order *order_ptr = market_manager_.GetOrder(request.OrderId);
+    if ((order_ptr != nullptr) && (order_ptr->SymbolId != request.SymbolId)) {
+        Reply(MakeAck(BinaryMessageType::CANCEL_ORDER, ErrorCode::ORDER_NOT_FOUND, request.OrderId));
+        return true;
+    }
+
+    Reply(MakeAck(BinaryMessageType::CANCEL_ORDER, market_manager_.DeleteOrder(request.OrderId, user_id_),
+                  request.OrderId));
+    return true;
+}
+
+bool BinarySession::HandleReplaceOrder(const ReplaceOrderRequest &request) {
+    if (!registered() || (request.Quantity == 0)) {
+        Reply(MakeAck(BinaryMessageType::REPLACE_ORDER,
+                      registered() ? ErrorCode::ORDER_QUANTITY_INVALID : ErrorCode::USER_NOT_FOUND));
+        return true;
+    }
+
+    if (engine_ptr_ != nullptr) {
+        // The shard takes the side over from the replaced order
+        boost::uint64_t order_id = engine_ids_.NextOrderId++;
+        engine_ptr_->ReplaceOrder(0, request.SymbolId, request.OrderId, user_id_, order_id, request.Price,
+                                  request.Quantity, &Pending::OnResult,
+                                  NewPending(BinaryMessageType::REPLACE_ORDER, order_id, 1));
+        return true;
+    }
+
+    const Order *order_ptr = market_manager_.GetOrder(request.OrderId);
+    if ((order_ptr == nullptr) || (order_ptr->UserId != user_id_) || (order_ptr->SymbolId != request.SymbolId)) {
+        Reply(MakeAck(BinaryMessageType::REPLACE_ORDER, ErrorCode::ORDER_NOT_FOUND, request.OrderId));
+        return true;
+    }
+
+    OrderSide side = order_ptr->Side;
+    market_manager_.DeleteOrder(request.OrderId);
+
+    boost::uint64_t order_id = market_manager_.GetOrdersCount();
+    ErrorCode error = market_manager_.AddOrder(Order(order_id, request.SymbolId, user_id_, side, request.Price, 0,
+                                                     request.Quantity));
+
+    Reply(MakeAck(BinaryMessageType::REPLACE_ORDER, error, order_id));
+    return true;
+}
+
+bool BinarySession::HandleModifyOrder(const ModifyOrderRequest &request) {
+    if (!registered()) {
+        Reply(MakeAck(BinaryMessageType::MODIFY_ORDER, ErrorCode::USER_NOT_FOUND, request.OrderId));
+        return true;
+    }
+
+    if (engine_ptr_ != nullptr) {
+        engine_ptr_->ModifyOrder(0, request.SymbolId, request.OrderId, user_id_, request.Price, request.Quantity,
+                                 &Pending::OnResult, NewPending(BinaryMessageType::MODIFY_ORDER, request.OrderId, 1));
+        return true;
+    }
+
+    const Order *order_ptr = market_manager_.GetOrder(request.OrderId);
+    if ((order_ptr != nullptr) && (order_ptr->SymbolId != request.SymbolId)) {
+        Reply(MakeAck(BinaryMessageType::MODIFY_ORDER, ErrorCode::ORDER_NOT_FOUND, request.OrderId));
+        return true;
+    }
+
+    Reply(MakeAck(BinaryMessageType::MODIFY_ORDER,
+                  market_manager_.ModifyOrder(request.OrderId, user_id_, request.Price, request.Quantity),
+                  request.OrderId));
+    return true;
+}
+
+BinaryServer::BinaryServer(boost::asio::io_service &io_service, boost::uint16_t port, MarketManager &market_manager,
+                           ShardedEngine *engine_ptr, EngineIds &engine_ids, IoStrand &engine_strand)
+        : io_service_(io_service),
+          acceptor_(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
+          market_manager_(market_manager), engine_ptr_(engine_ptr), engine_ids_(engine_ids),
+          engine_strand_(engine_strand) {
+    StartAccept();
+}
+
+void BinaryServer::StartAccept() {
+    auto new_session = std::make_shared<BinarySession>(io_service_, market_manager_, engine_ptr_, engine_ids_,
+                                                       engine_strand_);
+    acceptor_.async_accept(new_session->socket(), [this, new_session](const boost::system::error_code &error) {
+        HandleAccept(new_session, error);
+    });
+}
+
+void BinaryServer::HandleAccept(const std::shared_ptr<BinarySession> &new_session,
+                                const boost::system::error_code &error) {
+    if (!error) {
+        boost::asio::ip::tcp::no_delay option(true);
+        new_session->socket().set_option(option);
+        new_session->Start();
+        StartAccept();
+    }
+}
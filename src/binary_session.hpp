@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/container/vector.hpp>
+
+#include "binary_protocol.hpp"
+#include "engine_reply.hpp"
+#include "engine_strand.hpp"
+#include "market_manager.hpp"
+#include "receive_buffer.hpp"
+#include "reply_queue.hpp"
+#include "sharded_engine.hpp"
+
+// Order entry session speaking the binary protocol. Requests are decoded straight out of the receive buffer; with an
+// engine they are executed on the shards and acknowledged once the shards report back, otherwise they run against the
+// market manager.
+//
+// The connection is served by two coroutines on the session strand. The reader collects every complete request of a
+// read, executes them as one batch on the engine strand and reads again, so requests are pipelined; it stops while all
+// reply slots are taken. The writer sends the acks in request order, gathering all those that are ready, including the
+// ones the engine reports while a write is in flight, into one write. Buffers and reply slots are preallocated and the
+// coroutine frames and operation states are recycled, so without an engine a steady stream of requests does not
+// allocate. With an engine every reply slot also has its engine callback context, and the matching threads hand replies
+// back without allocating; the I/O thread still allocates now and then, since asio keeps a single spare block per
+// thread for the strand and socket operations of a round trip.
+class BinarySession : public std::enable_shared_from_this<BinarySession> {
+public:
+    BinarySession(boost::asio::io_service &io_service, MarketManager &market_manager, ShardedEngine *engine_ptr,
+                  EngineIds &engine_ids, IoStrand &engine_strand);
+
+    StrandSocket &socket() { return socket_; }
+
+    IoStrand &executor() { return strand_; }
+
+    void Start();
+
+    void OnEngineReply(boost::uint64_t sequence, boost::uint8_t type, ErrorCode error, boost::uint64_t order_id,
+                       boost::int64_t value);
+
+private:
+    typedef std::array<boost::uint8_t, sizeof(AckMessage)> EncodedAck;
+
+    // A request of the batch being executed, with its ack when the engine phase produced one
+    class BatchRequest {
+    public:
+        boost::uint64_t Sequence;
+        size_t Offset;
+        bool Replied;
+        EncodedAck Ack;
+    };
+
+    IoStrand strand_;
+    StrandSocket socket_;
+    MarketManager &market_manager_;
+    ShardedEngine *engine_ptr_;
+    EngineIds &engine_ids_;
+    IoStrand &engine_strand_;
+    boost::uint64_t user_id_;
+
+    ReceiveBuffer buffer_;
+    ReplyQueue<EncodedAck> replies_;
+    boost::container::vector<boost::asio::const_buffer> gather_;
+    boost::container::vector<BatchRequest> batch_;
+    size_t batch_size_;
+    size_t current_;
+    bool malformed_;
+
+    // Timers that never expire, cancelled to wake the coroutine waiting on them
+    StrandTimer reply_ready_;
+    StrandTimer reply_slots_free_;
+    bool reading_;
+    bool writer_waiting_;
+    bool reader_waiting_;
+
+    StrandAwaitable<> ReadLoop(std::shared_ptr<BinarySession> self);
+
+    StrandAwaitable<> WriteLoop(std::shared_ptr<BinarySession> self);
+
+    // Takes the complete requests in the buffer into the batch while there are reply slots, false means a malformed
+    // request follows them
+    bool CollectRequests();
+
+    // Runs on the engine strand
+    void ExecuteBatch();
+
+    // Queues the acks of the executed batch and drops its requests from the buffer
+    void CompleteBatch();
+
+    // Runs on the engine strand when the session closes
+    void CancelAllOrders();
+
+    // Handles the request at the front of the buffer, false means a malformed request
+    bool HandleRequest(const boost::uint8_t *data);
+
+    // Acks the request being executed
+    void Reply(const AckMessage &ack);
+
+    void Reply(boost::uint64_t sequence, const AckMessage &ack);
+
+    // Each handler either replies right away or leaves the reply to the engine; false means a malformed request
+    bool HandleRegister(const RegisterRequest &request);
+
+    bool HandleBalance(const BalanceRequest &request);
+
+    bool HandleAddOrder(const AddOrderRequest &request);
+
+    bool HandleCancelOrder(const CancelOrderRequest &request);
+
+    bool HandleReplaceOrder(const ReplaceOrderRequest &request);
+
+    bool HandleModifyOrder(const ModifyOrderRequest &request);
+
+    [[nodiscard]] bool registered() const noexcept {
+        return user_id_ != std::numeric_limits<boost::uint64_t>::max();
+    }
+
+    typedef EngineReply<BinarySession> Pending;
+
+    // One engine callback context per reply slot, only allocated with an engine
+    std::unique_ptr<Pending[]> pending_;
+
+    // Engine callback context acking the request being handled. It is the one of the request's reply slot, which stays
+    // reserved until the engine has reported back and the ack has been written.
+    Pending *NewPending(BinaryMessageType type, boost::uint64_t order_id, size_t remaining) {
+        boost::uint64_t sequence = batch_[current_].Sequence;
+        Pending *pending_ptr = &pending_[replies_.Index(sequence)];
+        pending_ptr->Reset(shared_from_this(), sequence, boost::uint8_t(type), order_id, remaining);
+        return pending_ptr;
+    }
+};
+
+class BinaryServer {
+public:
+    BinaryServer(boost::asio::io_service &io_service, boost::uint16_t port, MarketManager &market_manager,
+                 ShardedEngine *engine_ptr, EngineIds &engine_ids, IoStrand &engine_strand);
+
+    [[nodiscard]] boost::asio::ip::tcp::endpoint local_endpoint() const { return acceptor_.local_endpoint(); }
+
+private:
+    boost::asio::io_service &io_service_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    MarketManager &market_manager_;
+    ShardedEngine *engine_ptr_;
+    EngineIds &engine_ids_;
+    IoStrand &engine_strand_;
+
+    void StartAccept();
+
+    void HandleAccept(const std::shared_ptr<BinarySession> &new_session, const boost::system::error_code &error);
+};
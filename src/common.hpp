@@ -1,9 +1,18 @@
 #include <boost/cstdint.hpp>
 
 constexpr boost::uint16_t PORT = 5555;
+constexpr boost::uint16_t BINARY_PORT = 5557;
+
+constexpr const char *MARKET_DATA_GROUP = "239.255.0.1";
+constexpr boost::uint16_t MARKET_DATA_PORT = 5556;
+constexpr size_t MARKET_DATA_RING_SIZE = 65536;
+
+// Period of the latency stats dump to the standard output, zero disables it
+constexpr boost::uint64_t STATS_DUMP_SECONDS = 60;
 
 enum class Requests : boost::uint64_t {
     Registration,
     ViewBalance,
-    AddOrder
+    AddOrder,
+    Stats
 };
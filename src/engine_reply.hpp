@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include <boost/asio/post.hpp>
+
+#include "engine_strand.hpp"
+#include "errors.hpp"
+
+// Ids handed out by the servers when the matching runs on engine shards
+class EngineIds {
+public:
+    std::atomic<boost::uint64_t> NextUserId{0};
+    std::atomic<boost::uint64_t> NextOrderId{1};
+};
+
+// Room for the one handler a recycled engine reply posts from the matching thread. Asio would otherwise allocate it
+// there and free it on an I/O thread, and the matching thread has no recycled blocks to take it from.
+class EngineReplyStorage {
+public:
+    static constexpr size_t Size = 256;
+
+    alignas(std::max_align_t) unsigned char Data[Size];
+};
+
+template<typename T>
+class EngineReplyAllocator {
+public:
+    typedef T value_type;
+
+    EngineReplyStorage *StoragePtr;
+
+    explicit EngineReplyAllocator(EngineReplyStorage *storage_ptr) noexcept: StoragePtr(storage_ptr) {
+    }
+
+    template<typename U>
+    EngineReplyAllocator(const EngineReplyAllocator<U> &allocator) noexcept: StoragePtr(allocator.StoragePtr) {
+    }
+
+    T *allocate(size_t n) {
+        if (n * sizeof(T) <= EngineReplyStorage::Size)
+            return reinterpret_cast<T *>(StoragePtr->Data);
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, size_t) noexcept {
+        if (static_cast<void *>(ptr) != StoragePtr->Data)
+            ::operator delete(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const EngineReplyAllocator<U> &allocator) const noexcept {
+        return StoragePtr == allocator.StoragePtr;
+    }
+
+    template<typename U>
+    bool operator!=(const EngineReplyAllocator<U> &allocator) const noexcept {
+        return StoragePtr != allocator.StoragePtr;
+    }
+};
+
+// Collects the per-shard callbacks of one engine request and hands the combined result back to the session on its
+// I/O thread once all of them have arrived: the first error wins and the values are summed. The sequence is the slot the
+// session reserved for the reply. The session type provides executor() and
+// OnEngineReply(sequence, type, error, order_id, value).
+//
+// A reply created with new deletes itself once complete. A session may instead keep default constructed replies and
+// Reset one per request; it is free again once the session has handled its OnEngineReply. A recycled reply posts from
+// its own storage to the I/O threads, which move it onto the session strand, so the matching thread never allocates.
+template<typename SessionType>
+class EngineReply {
+public:
+    std::shared_ptr<SessionType> SessionPtr;
+    boost::uint64_t Sequence;
+    boost::uint8_t Type;
+    boost::uint64_t OrderId;
+    std::atomic<size_t> Remaining;
+    std::atomic<ErrorCode> Error;
+    std::atomic<boost::int64_t> Value;
+    bool Recycled;
+    EngineReplyStorage Storage;
+
+    EngineReply() noexcept: Sequence(0), Type(0), OrderId(0), Remaining(0), Error(ErrorCode::OK), Value(0),
+                            Recycled(true) {
+    }
+
+    EngineReply(std::shared_ptr<SessionType> session_ptr, boost::uint64_t sequence, boost::uint8_t type,
+                boost::uint64_t order_id, size_t remaining)
+            : SessionPtr(std::move(session_ptr)), Sequence(sequence), Type(type), OrderId(order_id),
+              Remaining(remaining), Error(ErrorCode::OK), Value(0), Recycled(false) {
+    }
+
+    EngineReply(const EngineReply &) = delete;
+
+    EngineReply(EngineReply &&) = delete;
+
+    ~EngineReply() = default;
+
+    EngineReply &operator=(const EngineReply &) = delete;
+
+    EngineReply &operator=(EngineReply &&) = delete;
+
+    void Reset(std::shared_ptr<SessionType> session_ptr, boost::uint64_t sequence, boost::uint8_t type,
+               boost::uint64_t order_id, size_t remaining) noexcept {
+        SessionPtr = std::move(session_ptr);
+        Sequence = sequence;
+        Type = type;
+        OrderId = order_id;
+        Remaining.store(remaining, std::memory_order_relaxed);
+        Error.store(ErrorCode::OK, std::memory_order_relaxed);
+        Value.store(0, std::memory_order_relaxed);
+    }
+
+    static void OnResult(void *context, ErrorCode result, boost::int64_t value) {
+        auto *reply_ptr = static_cast<EngineReply *>(context);
+
+        reply_ptr->Value += value;
+        if (result != ErrorCode::OK) {
+            ErrorCode expected = ErrorCode::OK;
+            reply_ptr->Error.compare_exchange_strong(expected, result);
+        }
+
+        if (--reply_ptr->Remaining > 0)
+            return;
+
+        std::shared_ptr<SessionType> session_ptr = std::move(reply_ptr->SessionPtr);
+        boost::uint64_t sequence = reply_ptr->Sequence;
+        boost::uint8_t type = reply_ptr->Type;
+        boost::uint64_t order_id = reply_ptr->OrderId;
+        ErrorCode error = reply_ptr->Error.load();
+        boost::int64_t total = reply_ptr->Value.load();
+
+        // Matching threads never touch the session
+        if (!reply_ptr->Recycled) {
+            delete reply_ptr;
+            boost::asio::post(session_ptr->executor(), [session_ptr, sequence, type, error, order_id, total]() {
+                session_ptr->OnEngineReply(sequence, type, error, order_id, total);
+            });
+            return;
+        }
+
+        auto io_executor = session_ptr->executor().get_inner_executor();
+        boost::asio::post(io_executor, Handoff{std::move(session_ptr), sequence, type, error, order_id, total,
+                                               &reply_ptr->Storage});
+    }
+
+private:
+    // Runs on an I/O thread, whose handler block cache takes the post onto the session strand
+    class Handoff {
+    public:
+        typedef EngineReplyAllocator<void> allocator_type;
+
+        std::shared_ptr<SessionType> SessionPtr;
+        boost::uint64_t Sequence;
+        boost::uint8_t Type;
+        ErrorCode Error;
+        boost::uint64_t OrderId;
+        boost::int64_t Value;
+        EngineReplyStorage *StoragePtr;
+
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(StoragePtr); }
+
+        void operator()() {
+            std::shared_ptr<SessionType> session_ptr = std::move(SessionPtr);
+            boost::asio::post(session_ptr->executor(), Completion{session_ptr, Sequence, Type, Error, OrderId, Value});
+        }
+    };
+
+    class Completion {
+    public:
+        typedef HandlerAllocator<void> allocator_type;
+
+        std::shared_ptr<SessionType> SessionPtr;
+        boost::uint64_t Sequence;
+        boost::uint8_t Type;
+        ErrorCode Error;
+        boost::uint64_t OrderId;
+        boost::int64_t Value;
+
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(); }
+
+        void operator()() { SessionPtr->OnEngineReply(Sequence, Type, Error, OrderId, Value); }
+    };
+};
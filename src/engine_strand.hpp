@@ -0,0 +1,148 @@
+#pragma once
+
+#include <chrono>
+#include <new>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+typedef boost::asio::strand<boost::asio::io_context::executor_type> IoStrand;
+
+// Sessions run on strands of their own. Their sockets, timers and coroutines name the strand type, the type-erased
+// default executor would copy the strand to the heap for every operation.
+typedef boost::asio::basic_stream_socket<boost::asio::ip::tcp, IoStrand> StrandSocket;
+typedef boost::asio::basic_waitable_timer<std::chrono::steady_clock, boost::asio::wait_traits<std::chrono::steady_clock>,
+                                          IoStrand> StrandTimer;
+
+template<typename T = void>
+using StrandAwaitable = boost::asio::awaitable<T, IoStrand>;
+
+constexpr boost::asio::use_awaitable_t<IoStrand> use_strand_awaitable;
+
+// Per-thread cache of the small blocks asio allocates for posted handlers and strand invokers. Asio itself keeps a
+// single block per thread, which does not cover an engine round trip with both strands scheduled at once.
+class HandlerBlockCache {
+public:
+    static constexpr size_t BlockSize = 256;
+    static constexpr size_t MaxBlocks = 16;
+
+    HandlerBlockCache() noexcept: size_(0) {
+    }
+
+    HandlerBlockCache(const HandlerBlockCache &) = delete;
+
+    HandlerBlockCache(HandlerBlockCache &&) = delete;
+
+    ~HandlerBlockCache() {
+        while (size_ > 0)
+            ::operator delete(blocks_[--size_]);
+    }
+
+    HandlerBlockCache &operator=(const HandlerBlockCache &) = delete;
+
+    HandlerBlockCache &operator=(HandlerBlockCache &&) = delete;
+
+    static void *Allocate(size_t size) {
+        if (size > BlockSize)
+            return ::operator new(size);
+
+        HandlerBlockCache &cache = Get();
+        if (cache.size_ > 0)
+            return cache.blocks_[--cache.size_];
+        return ::operator new(BlockSize);
+    }
+
+    static void Deallocate(void *ptr, size_t size) noexcept {
+        if (size <= BlockSize) {
+            HandlerBlockCache &cache = Get();
+            if (cache.size_ < MaxBlocks) {
+                cache.blocks_[cache.size_++] = ptr;
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    void *blocks_[MaxBlocks];
+    size_t size_;
+
+    static HandlerBlockCache &Get() noexcept {
+        static thread_local HandlerBlockCache cache;
+        return cache;
+    }
+};
+
+template<typename T>
+class HandlerAllocator {
+public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef HandlerAllocator<U> other;
+    };
+
+    HandlerAllocator() noexcept = default;
+
+    template<typename U>
+    HandlerAllocator(const HandlerAllocator<U> &) noexcept {
+    }
+
+    T *allocate(size_t n) { return static_cast<T *>(HandlerBlockCache::Allocate(n * sizeof(T))); }
+
+    void deallocate(T *ptr, size_t n) noexcept { HandlerBlockCache::Deallocate(ptr, n * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const HandlerAllocator<U> &) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const HandlerAllocator<U> &) const noexcept { return false; }
+};
+
+// Hands the completion handler back to its own executor
+template<typename Handler>
+class EngineCompletion {
+public:
+    typedef HandlerAllocator<void> allocator_type;
+    typedef typename boost::asio::associated_executor<Handler>::type executor_type;
+
+    Handler CompletionHandler;
+
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(); }
+
+    [[nodiscard]] executor_type get_executor() const noexcept {
+        return boost::asio::get_associated_executor(CompletionHandler);
+    }
+
+    void operator()() { CompletionHandler(); }
+};
+
+template<typename Function, typename Handler>
+class EngineTask {
+public:
+    typedef HandlerAllocator<void> allocator_type;
+
+    Function Task;
+    Handler CompletionHandler;
+
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(); }
+
+    void operator()() {
+        Task();
+        boost::asio::post(EngineCompletion<Handler>{std::move(CompletionHandler)});
+    }
+};
+
+// Runs the function on the engine strand and completes on the caller's executor once it has returned. Everything that
+// touches the matching state from the network front end goes through one engine strand: in direct mode the market
+// manager is only used there, with engine shards it is the single producer of the command queues. Sessions run on
+// strands of their own, so reading, parsing and writing spread over the I/O threads while matching stays serial.
+template<typename Function, typename CompletionToken>
+auto ExecuteOnEngine(IoStrand &engine_strand, Function function, CompletionToken &&token) {
+    return boost::asio::async_initiate<CompletionToken, void()>(
+            [&engine_strand](auto handler, Function function) {
+                boost::asio::post(engine_strand, EngineTask<Function, decltype(handler)>{std::move(function),
+                                                                                       std::move(handler)});
+            }, token, std::move(function));
+}
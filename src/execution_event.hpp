@@ -0,0 +1,99 @@
+#pragma once
+
+#include <boost/cstdint.hpp>
+
+#include "level.hpp"
+#include "order.hpp"
+#include "spsc_ring.hpp"
+#include "update.hpp"
+
+enum class ExecutionEventType : boost::uint8_t {
+    TRADE,
+    ORDER_ACCEPTED,
+    ORDER_REDUCED,
+    ORDER_CANCELLED,
+    ORDER_MODIFIED,
+    LEVEL_UPDATE
+};
+
+class TradeEvent {
+public:
+    boost::uint64_t SymbolId;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+    boost::uint64_t MakerOrderId;
+    boost::uint64_t MakerUserId;
+    boost::uint64_t TakerOrderId;
+    boost::uint64_t TakerUserId;
+    OrderSide TakerSide;
+};
+
+class OrderEvent {
+public:
+    boost::uint64_t SymbolId;
+    boost::uint64_t OrderId;
+    boost::uint64_t UserId;
+    OrderSide Side;
+    OrderType Type;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+    boost::uint64_t LeavesQuantity;
+};
+
+class LevelEvent {
+public:
+    boost::uint64_t SymbolId;
+    UpdateType Update;
+    LevelType Type;
+    bool Top;
+    boost::uint64_t Price;
+    boost::uint64_t TotalVolume;
+    boost::uint64_t HiddenVolume;
+    boost::uint64_t VisibleVolume;
+    size_t Orders;
+};
+
+// Fixed-size record of one engine event. Type selects the active payload; Sequence is assigned by the publisher and
+// increases by one per published event across all symbols.
+class ExecutionEvent {
+public:
+    ExecutionEventType Type;
+    boost::uint64_t Sequence;
+
+    union {
+        TradeEvent Trade;
+        OrderEvent OrderState;
+        LevelEvent LevelState;
+    };
+
+    static ExecutionEvent MakeTrade(const Order &maker, const Order &taker, boost::uint64_t price,
+                                    boost::uint64_t quantity) noexcept {
+        ExecutionEvent event;
+        event.Type = ExecutionEventType::TRADE;
+        event.Sequence = 0;
+        event.Trade = {maker.SymbolId, price, quantity, maker.Id, maker.UserId, taker.Id, taker.UserId, taker.Side};
+        return event;
+    }
+
+    static ExecutionEvent MakeOrder(ExecutionEventType type, const Order &order,
+                                    boost::uint64_t leaves_quantity) noexcept {
+        ExecutionEvent event;
+        event.Type = type;
+        event.Sequence = 0;
+        event.OrderState = {order.SymbolId, order.Id, order.UserId, order.Side, order.Type, order.Price,
+                            order.Quantity, leaves_quantity};
+        return event;
+    }
+
+    static ExecutionEvent MakeLevel(boost::uint64_t symbol_id, const LevelUpdate &update) noexcept {
+        ExecutionEvent event;
+        event.Type = ExecutionEventType::LEVEL_UPDATE;
+        event.Sequence = 0;
+        event.LevelState = {symbol_id, update.Type, update.Update.Type, update.Top, update.Update.Price,
+                            update.Update.TotalVolume, update.Update.HiddenVolume, update.Update.VisibleVolume,
+                            update.Update.Orders};
+        return event;
+    }
+};
+
+typedef SpscRing<ExecutionEvent> ExecutionEventRing;
@@ -0,0 +1,688 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+
+#include "journal.hpp"
+#include "market_manager.hpp"
+
+namespace {
+
+constexpr size_t AlignUp(size_t size, size_t alignment) noexcept {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+constexpr size_t MaxRecordSize = AlignUp(sizeof(JournalRecordHeader) +
+                                         std::max(sizeof(JournalUserRecord) + Journal::MaxNameSize,
+                                                  sizeof(JournalBatchRecord) +
+                                                  MarketManager::MaxBatchSize * sizeof(JournalOrderRecord)),
+                                         Journal::RecordAlignment);
+
+constexpr size_t MinSegmentSize = Journal::BlockSize + AlignUp(MaxRecordSize, Journal::BlockSize);
+
+boost::uint32_t RecordChecksum(const boost::uint8_t *record, size_t size) noexcept {
+    static const boost::uint8_t zeros[sizeof(JournalRecordHeader::Checksum)] = {};
+    constexpr size_t checksum_offset = offsetof(JournalRecordHeader, Checksum);
+    constexpr size_t data_offset = checksum_offset + sizeof(JournalRecordHeader::Checksum);
+
+    boost::crc_32_type crc;
+    crc.process_bytes(record, checksum_offset);
+    crc.process_bytes(zeros, sizeof(zeros));
+    crc.process_bytes(record + data_offset, size - data_offset);
+    return crc.checksum();
+}
+
+JournalOrderRecord EncodeOrder(const Order &order) noexcept {
+    return {order.Id, order.SymbolId, order.UserId, order.Side, order.Type, order.Price, order.StopPrice,
+            order.Quantity, order.ExecutedQuantity, order.LeavesQuantity, order.MaxVisibleQuantity,
+            order.TrailingDistance, order.TrailingStep};
+}
+
+Order DecodeOrder(const JournalOrderRecord &record) noexcept {
+    Order order;
+    order.Id = record.Id;
+    order.SymbolId = record.SymbolId;
+    order.UserId = record.UserId;
+    order.Side = record.Side;
+    order.Type = record.Type;
+    order.Price = record.Price;
+    order.StopPrice = record.StopPrice;
+    order.Quantity = record.Quantity;
+    order.ExecutedQuantity = record.ExecutedQuantity;
+    order.LeavesQuantity = record.LeavesQuantity;
+    order.MaxVisibleQuantity = record.MaxVisibleQuantity;
+    order.TrailingDistance = record.TrailingDistance;
+    order.TrailingStep = record.TrailingStep;
+    return order;
+}
+
+std::error_code LastError() {
+    return {errno, std::system_category()};
+}
+
+// Writes the whole vector, resuming after short writes
+std::error_code WriteFully(int fd, iovec *iov, int count, off_t offset) {
+    while (count > 0) {
+        ssize_t written = pwritev(fd, iov, count, offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return LastError();
+        }
+
+        offset += written;
+        while ((count > 0) && (size_t(written) >= iov->iov_len)) {
+            written -= ssize_t(iov->iov_len);
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<boost::uint8_t *>(iov->iov_base) + written;
+            iov->iov_len -= size_t(written);
+        }
+    }
+    return {};
+}
+
+}
+
+Journal::Journal(std::string directory, JournalDurability durability, size_t segment_size) : directory_(
+        std::move(directory)), durability_(durability), segment_size_(
+        AlignUp(std::max(segment_size, MinSegmentSize), BlockSize)), sequence_(0), durable_sequence_(0),
+                                                                                              stopping_(false),
+                                                                                              segment_fd_(-1),
+                                                                                              tail_offset_(0) {
+    std::filesystem::create_directories(directory_);
+
+    JournalReader reader(directory_);
+    JournalRecord record;
+    while (reader.Next(record)) {
+    }
+    sequence_ = durable_sequence_ = reader.sequence();
+
+    pending_.reserve(MaxPendingBytes + MaxRecordSize);
+    writing_.reserve(MaxPendingBytes + MaxRecordSize);
+    tail_.reserve(BlockSize);
+
+    std::error_code error = OpenSegment(sequence_ + 1);
+    if (error)
+        throw std::system_error(error, "Cannot open journal segment in " + directory_);
+
+    thread_ = std::thread(&Journal::Run, this);
+}
+
+Journal::~Journal() {
+    Close();
+}
+
+boost::uint64_t Journal::sequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sequence_;
+}
+
+boost::uint64_t Journal::durable_sequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return durable_sequence_;
+}
+
+std::error_code Journal::error() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void Journal::AddSymbol(const Symbol &symbol) {
+    std::string_view name = std::string_view(symbol.Name).substr(0, MaxNameSize);
+    JournalSymbolRecord payload{symbol.Id, boost::uint16_t(name.size())};
+    Append(JournalRecordType::ADD_SYMBOL, &payload, sizeof(payload), name);
+}
+
+void Journal::DeleteSymbol(boost::uint64_t id) {
+    JournalIdRecord payload{id};
+    Append(JournalRecordType::DELETE_SYMBOL, &payload, sizeof(payload));
+}
+
+void Journal::AddOrderBook(boost::uint64_t symbol_id, const OrderBookOptions &options) {
+    JournalOrderBookRecord payload{symbol_id, options.Layout, options.TickSize, options.LadderSize};
+    Append(JournalRecordType::ADD_ORDER_BOOK, &payload, sizeof(payload));
+}
+
+void Journal::DeleteOrderBook(boost::uint64_t id) {
+    JournalIdRecord payload{id};
+    Append(JournalRecordType::DELETE_ORDER_BOOK, &payload, sizeof(payload));
+}
+
+void Journal::AddOrder(const Order &order) {
+    JournalOrderRecord payload = EncodeOrder(order);
+    Append(JournalRecordType::ADD_ORDER, &payload, sizeof(payload));
+}
+
+void Journal::DeleteOrder(boost::uint64_t id) {
+    JournalIdRecord payload{id};
+    Append(JournalRecordType::DELETE_ORDER, &payload, sizeof(payload));
+}
+
+void Journal::ModifyOrder(boost::uint64_t id, boost::uint64_t price, boost::uint64_t quantity) {
+    JournalModifyRecord payload{id, price, quantity};
+    Append(JournalRecordType::MODIFY_ORDER, &payload, sizeof(payload));
+}
+
+void Journal::AddOrders(std::span<const Order> orders) {
+    boost::container::vector<JournalOrderRecord> records;
+    records.reserve(orders.size());
+    for (const Order &order: orders)
+        records.push_back(EncodeOrder(order));
+
+    JournalBatchRecord payload{orders.size()};
+    Append(JournalRecordType::ADD_ORDERS, &payload, sizeof(payload),
+           std::string_view(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(records[0])));
+}
+
+void Journal::DeleteOrders(std::span<const boost::uint64_t> ids) {
+    JournalBatchRecord payload{ids.size()};
+    Append(JournalRecordType::DELETE_ORDERS, &payload, sizeof(payload),
+           std::string_view(reinterpret_cast<const char *>(ids.data()), ids.size() * sizeof(ids[0])));
+}
+
+void Journal::AddUser(const User &user) {
+    std::string_view name = std::string_view(user.Name).substr(0, MaxNameSize);
+    JournalUserRecord payload{user.Id, user.Balance, boost::uint16_t(name.size())};
+    Append(JournalRecordType::ADD_USER, &payload, sizeof(payload), name);
+}
+
+void Journal::DeleteUser(boost::uint64_t id) {
+    JournalIdRecord payload{id};
+    Append(JournalRecordType::DELETE_USER, &payload, sizeof(payload));
+}
+
+void Journal::RemoveSegments(const std::string &directory, boost::uint64_t sequence) {
+    std::vector<std::string> segments = JournalReader::ListSegments(directory);
+    for (size_t i = 0; (i + 1 < segments.size()) && (JournalReader::SegmentSequence(segments[i + 1]) <= sequence + 1);
+         ++i) {
+        std::error_code error;
+        std::filesystem::remove(segments[i], error);
+    }
+}
+
+void Journal::Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    boost::uint64_t sequence = sequence_;
+    written_.wait(lock, [this, sequence] { return (durable_sequence_ >= sequence) || error_; });
+}
+
+void Journal::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_)
+            return;
+        stopping_ = true;
+    }
+    appended_.notify_one();
+    thread_.join();
+}
+
+void Journal::Append(JournalRecordType type, const void *payload, size_t payload_size, std::string_view tail) {
+    size_t size = AlignUp(sizeof(JournalRecordHeader) + payload_size + tail.size(), RecordAlignment);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    written_.wait(lock, [this] { return (pending_.size() < MaxPendingBytes) || error_ || stopping_; });
+    if (error_ || stopping_)
+        return;
+
+    size_t offset = pending_.size();
+    pending_.resize(offset + size);
+
+    boost::uint8_t *record = pending_.data() + offset;
+    JournalRecordHeader header{boost::uint32_t(size), 0, ++sequence_, type, {}};
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), payload, payload_size);
+    if (!tail.empty())
+        std::memcpy(record + sizeof(header) + payload_size, tail.data(), tail.size());
+
+    header.Checksum = RecordChecksum(record, size);
+    std::memcpy(record + offsetof(JournalRecordHeader, Checksum), &header.Checksum, sizeof(header.Checksum));
+
+    // The journal thread only sleeps while there is nothing pending
+    if (offset == 0)
+        appended_.notify_one();
+
+    if (durability_ == JournalDurability::PER_COMMAND) {
+        boost::uint64_t sequence = header.Sequence;
+        written_.wait(lock, [this, sequence] { return (durable_sequence_ >= sequence) || error_; });
+    }
+}
+
+void Journal::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        appended_.wait(lock, [this] { return !pending_.empty() || stopping_; });
+        if (pending_.empty())
+            break;
+
+        pending_.swap(writing_);
+        boost::uint64_t sequence = sequence_;
+        written_.notify_all();
+        lock.unlock();
+
+        std::error_code error = Write(writing_);
+        writing_.clear();
+
+        lock.lock();
+        if (error) {
+            error_ = error;
+            pending_.clear();
+            written_.notify_all();
+            break;
+        }
+        durable_sequence_ = sequence;
+        written_.notify_all();
+    }
+    lock.unlock();
+
+    std::error_code error;
+    if (segment_fd_ >= 0) {
+        if (durability_ == JournalDurability::NONE && (fdatasync(segment_fd_) != 0))
+            error = LastError();
+        std::error_code close_error = CloseSegment();
+        if (!error)
+            error = close_error;
+    }
+
+    lock.lock();
+    if (!error_)
+        error_ = error;
+    written_.notify_all();
+}
+
+std::error_code Journal::Write(const boost::container::vector<boost::uint8_t> &batch) {
+    size_t offset = 0;
+    while (offset < batch.size()) {
+        // Take the records that still fit into the segment, the rest go to a new one
+        size_t end = offset;
+        size_t room = segment_size_ - tail_offset_ - tail_.size();
+        JournalRecordHeader header{};
+        while (end < batch.size()) {
+            std::memcpy(&header, batch.data() + end, sizeof(header));
+            if (header.Size > room)
+                break;
+            room -= header.Size;
+            end += header.Size;
+        }
+
+        if (end > offset) {
+            std::error_code error = WriteTail(batch.data() + offset, end - offset);
+            if (error)
+                return error;
+            offset = end;
+        }
+
+        if (offset < batch.size()) {
+            std::error_code error = CloseSegment();
+            if (!error)
+                error = OpenSegment(header.Sequence);
+            if (error)
+                return error;
+        }
+    }
+
+    if ((durability_ != JournalDurability::NONE) && (fdatasync(segment_fd_) != 0))
+        return LastError();
+
+    return {};
+}
+
+std::error_code Journal::WriteTail(const boost::uint8_t *data, size_t size) {
+    static const boost::uint8_t zeros[BlockSize] = {};
+
+    size_t total = tail_.size() + size;
+    size_t rest = total % BlockSize;
+    iovec iov[3] = {{tail_.data(), tail_.size()},
+                    {const_cast<boost::uint8_t *>(data), size},
+                    {const_cast<boost::uint8_t *>(zeros), (rest != 0) ? BlockSize - rest : 0}};
+    std::error_code error = WriteFully(segment_fd_, iov, 3, off_t(tail_offset_));
+    if (error)
+        return error;
+
+    // Keep the partially filled last block for the next write
+    tail_offset_ += total - rest;
+    if (rest > size) {
+        tail_.erase(tail_.begin(), tail_.end() - ptrdiff_t(rest - size));
+        tail_.insert(tail_.end(), data, data + size);
+    } else {
+        tail_.assign(data + size - rest, data + size);
+    }
+    return {};
+}
+
+std::error_code Journal::OpenSegment(boost::uint64_t first_sequence) {
+    std::string path = directory_ + "/" + JournalReader::SegmentName(first_sequence);
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return LastError();
+
+    int result = posix_fallocate(fd, 0, off_t(segment_size_));
+    if (result != 0) {
+        close(fd);
+        return {result, std::system_category()};
+    }
+
+    alignas(JournalSegmentHeader) boost::uint8_t block[BlockSize] = {};
+    JournalSegmentHeader header{JournalSegmentHeader::SegmentMagic, JournalSegmentHeader::SegmentVersion,
+                                boost::uint32_t(BlockSize), segment_size_, first_sequence};
+    std::memcpy(block, &header, sizeof(header));
+    iovec iov{block, BlockSize};
+    std::error_code error = WriteFully(fd, &iov, 1, 0);
+
+    // The new directory entry has to be durable as well, otherwise the segment could vanish with the records in it
+    if (!error && (durability_ != JournalDurability::NONE)) {
+        if (fdatasync(fd) != 0) {
+            error = LastError();
+        } else {
+            int directory_fd = open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if ((directory_fd < 0) || (fsync(directory_fd) != 0))
+                error = LastError();
+            if (directory_fd >= 0)
+                close(directory_fd);
+        }
+    }
+
+    if (error) {
+        close(fd);
+        return error;
+    }
+
+    segment_fd_ = fd;
+    tail_.clear();
+    tail_offset_ = BlockSize;
+    return {};
+}
+
+std::error_code Journal::CloseSegment() {
+    std::error_code error;
+    if ((durability_ != JournalDurability::NONE) && (fdatasync(segment_fd_) != 0))
+        error = LastError();
+    if ((close(segment_fd_) != 0) && !error)
+        error = LastError();
+    segment_fd_ = -1;
+    return error;
+}
+
+JournalReader::JournalReader(const std::string &directory, boost::uint64_t skip_sequence)
+        : segments_(ListSegments(directory)), next_segment_(0), data_(nullptr), size_(0), offset_(0), sequence_(0),
+          skip_sequence_(skip_sequence), done_(false) {
+    // Segments that end before the first record wanted are never mapped
+    size_t first = 0;
+    while ((first + 1 < segments_.size()) && (SegmentSequence(segments_[first + 1]) <= skip_sequence + 1))
+        ++first;
+    segments_.erase(segments_.begin(), segments_.begin() + ptrdiff_t(first));
+}
+
+JournalReader::~JournalReader() {
+    UnmapSegment();
+}
+
+bool JournalReader::Next(JournalRecord &record) {
+    while (!done_) {
+        if (data_ == nullptr) {
+            if ((next_segment_ == segments_.size()) || !MapSegment(segments_[next_segment_++]))
+                done_ = true;
+            continue;
+        }
+
+        JournalRecordHeader header{};
+        if (size_ - offset_ >= sizeof(header))
+            std::memcpy(&header, data_ + offset_, sizeof(header));
+
+        bool valid = (header.Size >= sizeof(header)) && (header.Size % Journal::RecordAlignment == 0) &&
+                     (header.Size <= size_ - offset_) && (header.Sequence == sequence_ + 1) &&
+                     (header.Checksum == RecordChecksum(data_ + offset_, header.Size)) &&
+                     Decode(header, data_ + offset_ + sizeof(header), header.Size - sizeof(header), record);
+        if (!valid) {
+            // End of the data in this segment, a torn write leaves the rest of it to the segment opened on restart
+            UnmapSegment();
+            continue;
+        }
+
+        offset_ += header.Size;
+        sequence_ = header.Sequence;
+        if (sequence_ > skip_sequence_)
+            return true;
+    }
+    return false;
+}
+
+size_t JournalReader::Replay(MarketManager &market_manager) {
+    JournalRecord record;
+    size_t count = 0;
+    while (Next(record)) {
+        Apply(market_manager, record);
+        ++count;
+    }
+    return count;
+}
+
+ErrorCode JournalReader::Apply(MarketManager &market_manager, const JournalRecord &record) {
+    switch (record.Type) {
+        case JournalRecordType::ADD_SYMBOL:
+            return market_manager.AddSymbol(record.SymbolData);
+        case JournalRecordType::DELETE_SYMBOL:
+            return market_manager.DeleteSymbol(record.Id);
+        case JournalRecordType::ADD_ORDER_BOOK: {
+            const Symbol *symbol_ptr = market_manager.GetSymbol(record.Id);
+            if (symbol_ptr == nullptr)
+                return ErrorCode::SYMBOL_NOT_FOUND;
+            return market_manager.AddOrderBook(*symbol_ptr, record.Options);
+        }
+        case JournalRecordType::DELETE_ORDER_BOOK:
+            return market_manager.DeleteOrderBook(record.Id);
+        case JournalRecordType::ADD_ORDER:
+            return market_manager.AddOrder(record.OrderData);
+        case JournalRecordType::DELETE_ORDER:
+            return market_manager.DeleteOrder(record.Id);
+        case JournalRecordType::MODIFY_ORDER:
+            return market_manager.ModifyOrder(record.Id, record.Price, record.Quantity);
+        case JournalRecordType::ADD_USER:
+            return market_manager.AddUser(record.UserData);
+        case JournalRecordType::DELETE_USER:
+            return market_manager.DeleteUser(record.Id);
+        case JournalRecordType::ADD_ORDERS:
+        case JournalRecordType::DELETE_ORDERS: {
+            // Reports the first failure of the batch
+            bool orders = record.Type == JournalRecordType::ADD_ORDERS;
+            size_t size = orders ? record.Orders.size() : record.Ids.size();
+            boost::container::vector<ErrorCode> results(size);
+            std::span<ErrorCode> results_span(results.data(), size);
+            size_t count = orders ? market_manager.AddOrders(std::span(record.Orders.data(), size), results_span)
+                                  : market_manager.DeleteOrders(std::span(record.Ids.data(), size), results_span);
+            if (count == size)
+                return ErrorCode::OK;
+            return *std::find_if(results.begin(), results.end(),
+                                 [](ErrorCode result) { return result != ErrorCode::OK; });
+        }
+    }
+    return ErrorCode::OK;
+}
+
+std::vector<std::string> JournalReader::ListSegments(const std::string &directory) {
+    std::vector<std::string> segments;
+    std::error_code error;
+    for (const auto &entry: std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.starts_with("journal-") && name.ends_with(".wal"))
+            segments.push_back(entry.path().string());
+    }
+
+    // Segment names carry a fixed width first sequence, so they sort in sequence order
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+boost::uint64_t JournalReader::SegmentSequence(const std::string &path) {
+    std::string name = std::filesystem::path(path).filename().string();
+    return std::strtoull(name.c_str() + std::strlen("journal-"), nullptr, 10);
+}
+
+std::string JournalReader::SegmentName(boost::uint64_t first_sequence) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "journal-%020llu.wal", (unsigned long long) first_sequence);
+    return name;
+}
+
+bool JournalReader::MapSegment(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat status{};
+    void *data = MAP_FAILED;
+    if ((fstat(fd, &status) == 0) && (size_t(status.st_size) >= sizeof(JournalSegmentHeader)))
+        data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    data_ = static_cast<const boost::uint8_t *>(data);
+    size_ = size_t(status.st_size);
+    madvise(data, size_, MADV_SEQUENTIAL);
+
+    // A segment has to carry on right after the last record read, the first one sets where the journal starts and
+    // must not start after the first record wanted
+    JournalSegmentHeader header{};
+    std::memcpy(&header, data_, sizeof(header));
+    bool valid = (header.Magic == JournalSegmentHeader::SegmentMagic) &&
+                 (header.Version == JournalSegmentHeader::SegmentVersion) &&
+                 (header.BlockSize >= sizeof(header)) && (header.BlockSize <= size_) && (header.FirstSequence > 0) &&
+                 ((next_segment_ == 1) ? (header.FirstSequence <= skip_sequence_ + 1) || (skip_sequence_ == 0)
+                                       : (header.FirstSequence == sequence_ + 1));
+    if (!valid) {
+        UnmapSegment();
+        return false;
+    }
+
+    offset_ = header.BlockSize;
+    sequence_ = header.FirstSequence - 1;
+    return true;
+}
+
+void JournalReader::UnmapSegment() noexcept {
+    if (data_ != nullptr)
+        munmap(const_cast<boost::uint8_t *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    offset_ = 0;
+}
+
+bool JournalReader::Decode(const JournalRecordHeader &header, const boost::uint8_t *payload, size_t payload_size,
+                           JournalRecord &record) const {
+    record.Type = header.Type;
+    record.Sequence = header.Sequence;
+
+    switch (header.Type) {
+        case JournalRecordType::DELETE_SYMBOL:
+        case JournalRecordType::DELETE_ORDER_BOOK:
+        case JournalRecordType::DELETE_ORDER:
+        case JournalRecordType::DELETE_USER: {
+            JournalIdRecord id_record{};
+            if (payload_size < sizeof(id_record))
+                return false;
+            std::memcpy(&id_record, payload, sizeof(id_record));
+            record.Id = id_record.Id;
+            return true;
+        }
+        case JournalRecordType::ADD_SYMBOL: {
+            JournalSymbolRecord symbol_record{};
+            if (payload_size < sizeof(symbol_record))
+                return false;
+            std::memcpy(&symbol_record, payload, sizeof(symbol_record));
+            if (payload_size < sizeof(symbol_record) + symbol_record.NameSize)
+                return false;
+            record.Id = symbol_record.Id;
+            record.SymbolData.Id = symbol_record.Id;
+            record.SymbolData.Name.assign(reinterpret_cast<const char *>(payload + sizeof(symbol_record)),
+                                          symbol_record.NameSize);
+            return true;
+        }
+        case JournalRecordType::ADD_ORDER_BOOK: {
+            JournalOrderBookRecord order_book_record{};
+            if (payload_size < sizeof(order_book_record))
+                return false;
+            std::memcpy(&order_book_record, payload, sizeof(order_book_record));
+            record.Id = order_book_record.SymbolId;
+            record.Options = OrderBookOptions(order_book_record.Layout, order_book_record.TickSize,
+                                              size_t(order_book_record.LadderSize));
+            return true;
+        }
+        case JournalRecordType::ADD_ORDER: {
+            JournalOrderRecord order_record{};
+            if (payload_size < sizeof(order_record))
+                return false;
+            std::memcpy(&order_record, payload, sizeof(order_record));
+            record.Id = order_record.Id;
+            record.OrderData = DecodeOrder(order_record);
+            return true;
+        }
+        case JournalRecordType::MODIFY_ORDER: {
+            JournalModifyRecord modify_record{};
+            if (payload_size < sizeof(modify_record))
+                return false;
+            std::memcpy(&modify_record, payload, sizeof(modify_record));
+            record.Id = modify_record.Id;
+            record.Price = modify_record.Price;
+            record.Quantity = modify_record.Quantity;
+            return true;
+        }
+        case JournalRecordType::ADD_ORDERS:
+        case JournalRecordType::DELETE_ORDERS: {
+            JournalBatchRecord batch_record{};
+            if (payload_size < sizeof(batch_record))
+                return false;
+            std::memcpy(&batch_record, payload, sizeof(batch_record));
+            bool orders = header.Type == JournalRecordType::ADD_ORDERS;
+            size_t entry_size = orders ? sizeof(JournalOrderRecord) : sizeof(JournalIdRecord);
+            if ((batch_record.Count > MarketManager::MaxBatchSize) ||
+                (payload_size < sizeof(batch_record) + batch_record.Count * entry_size))
+                return false;
+
+            record.Orders.clear();
+            record.Ids.clear();
+            const boost::uint8_t *entry = payload + sizeof(batch_record);
+            for (size_t i = 0; i < batch_record.Count; ++i, entry += entry_size) {
+                if (orders) {
+                    JournalOrderRecord order_record{};
+                    std::memcpy(&order_record, entry, sizeof(order_record));
+                    record.Orders.push_back(DecodeOrder(order_record));
+                } else {
+                    JournalIdRecord id_record{};
+                    std::memcpy(&id_record, entry, sizeof(id_record));
+                    record.Ids.push_back(id_record.Id);
+                }
+            }
+            return true;
+        }
+        case JournalRecordType::ADD_USER: {
+            JournalUserRecord user_record{};
+            if (payload_size < sizeof(user_record))
+                return false;
+            std::memcpy(&user_record, payload, sizeof(user_record));
+            if (payload_size < sizeof(user_record) + user_record.NameSize)
+                return false;
+            record.Id = user_record.Id;
+            record.UserData.Id = user_record.Id;
+            record.UserData.Balance = user_record.Balance;
+            record.UserData.Name.assign(reinterpret_cast<const char *>(payload + sizeof(user_record)),
+                                        user_record.NameSize);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <boost/container/vector.hpp>
+#include <boost/cstdint.hpp>
+
+#include "order.hpp"
+#include "order_book.hpp"
+#include "symbol.hpp"
+#include "user.hpp"
+
+class MarketManager;
+
+enum class JournalDurability : boost::uint8_t {
+    // Records reach the segment files from the journal thread but are never synced until the journal is closed
+    NONE,
+    // Every batch the journal thread writes is synced, commands do not wait for it
+    BATCHED,
+    // Every command waits until its record is synced; commands journaled meanwhile share the sync
+    PER_COMMAND
+};
+
+enum class JournalRecordType : boost::uint8_t {
+    ADD_SYMBOL = 1,
+    DELETE_SYMBOL,
+    ADD_ORDER_BOOK,
+    DELETE_ORDER_BOOK,
+    ADD_ORDER,
+    DELETE_ORDER,
+    ADD_USER,
+    DELETE_USER,
+    ADD_ORDERS,
+    DELETE_ORDERS,
+    MODIFY_ORDER
+};
+
+// On-disk format of the journal. A journal is a directory of segments named after the sequence of their first record.
+// Every segment is preallocated to its full size and starts with a header block; records follow back to back, each
+// padded to RecordAlignment, and the data ends at a zero Size or at the first record that fails its checksum or breaks
+// the sequence. Segments are written in whole zero-padded blocks at block offsets. All integers are in host byte order.
+#pragma pack(push, 1)
+
+class JournalSegmentHeader {
+public:
+    static constexpr boost::uint64_t SegmentMagic = 0x314c4e524a584553;  // "SEXJRNL1"
+    static constexpr boost::uint32_t SegmentVersion = 1;
+
+    boost::uint64_t Magic;
+    boost::uint32_t Version;
+    boost::uint32_t BlockSize;
+    boost::uint64_t SegmentSize;
+    boost::uint64_t FirstSequence;
+};
+
+// Checksum is the CRC-32 of the whole padded record with the Checksum field zeroed
+class JournalRecordHeader {
+public:
+    boost::uint32_t Size;
+    boost::uint32_t Checksum;
+    boost::uint64_t Sequence;
+    JournalRecordType Type;
+    boost::uint8_t Reserved[7];
+};
+
+// Payload of DELETE_SYMBOL, DELETE_ORDER_BOOK, DELETE_ORDER and DELETE_USER
+class JournalIdRecord {
+public:
+    boost::uint64_t Id;
+};
+
+// Followed by NameSize bytes of the name
+class JournalSymbolRecord {
+public:
+    boost::uint64_t Id;
+    boost::uint16_t NameSize;
+};
+
+class JournalOrderBookRecord {
+public:
+    boost::uint64_t SymbolId;
+    OrderBookLayout Layout;
+    boost::uint64_t TickSize;
+    boost::uint64_t LadderSize;
+};
+
+class JournalOrderRecord {
+public:
+    boost::uint64_t Id;
+    boost::uint64_t SymbolId;
+    boost::uint64_t UserId;
+    OrderSide Side;
+    OrderType Type;
+    boost::uint64_t Price;
+    boost::uint64_t StopPrice;
+    boost::uint64_t Quantity;
+    boost::uint64_t ExecutedQuantity;
+    boost::uint64_t LeavesQuantity;
+    boost::uint64_t MaxVisibleQuantity;
+    boost::int64_t TrailingDistance;
+    boost::int64_t TrailingStep;
+};
+
+class JournalModifyRecord {
+public:
+    boost::uint64_t Id;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+};
+
+// Payload of ADD_ORDERS and DELETE_ORDERS, followed by Count JournalOrderRecord or JournalIdRecord. A batch is one
+// record so that it is replayed whole or not at all.
+class JournalBatchRecord {
+public:
+    boost::uint64_t Count;
+};
+
+// Followed by NameSize bytes of the name
+class JournalUserRecord {
+public:
+    boost::uint64_t Id;
+    boost::int64_t Balance;
+    boost::uint16_t NameSize;
+};
+
+#pragma pack(pop)
+
+// A decoded journal record, only the fields of its type are set. Batches fill Orders or Ids, modifications Id, Price
+// and Quantity.
+class JournalRecord {
+public:
+    JournalRecordType Type;
+    boost::uint64_t Sequence;
+    boost::uint64_t Id;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+    Symbol SymbolData;
+    OrderBookOptions Options;
+    Order OrderData;
+    User UserData{0};
+    boost::container::vector<Order> Orders;
+    boost::container::vector<boost::uint64_t> Ids;
+};
+
+// Write-ahead journal of the commands a market manager accepted. Commands are encoded into a pending buffer on the
+// calling thread and a dedicated journal thread writes whatever has accumulated as one batch, so many commands share
+// one write and one fdatasync (group commit). The pending and the written buffer are swapped rather than copied, and
+// a caller only blocks when the pending buffer is over MaxPendingBytes or, with PER_COMMAND durability, until its
+// record is synced. Every journal opens a new segment after the last record already in the directory, so the
+// directory should be replayed into the market manager before a journal is attached to it.
+class Journal {
+public:
+    static constexpr size_t BlockSize = 4096;
+    static constexpr size_t RecordAlignment = 8;
+    static constexpr size_t MaxNameSize = 0xffff;
+    static constexpr size_t DefaultSegmentSize = size_t(64) << 20;
+    static constexpr size_t MaxPendingBytes = size_t(4) << 20;
+
+    // Segments are made at least large enough for a header block and the largest record; I/O errors on opening the
+    // first segment are thrown as std::system_error
+    explicit Journal(std::string directory, JournalDurability durability = JournalDurability::BATCHED,
+                     size_t segment_size = DefaultSegmentSize);
+
+    Journal(const Journal &) = delete;
+
+    Journal(Journal &&) = delete;
+
+    ~Journal();
+
+    Journal &operator=(const Journal &) = delete;
+
+    Journal &operator=(Journal &&) = delete;
+
+    [[nodiscard]] const std::string &directory() const noexcept { return directory_; }
+
+    [[nodiscard]] JournalDurability durability() const noexcept { return durability_; }
+
+    [[nodiscard]] size_t segment_size() const noexcept { return segment_size_; }
+
+    // Sequence of the last record appended
+    [[nodiscard]] boost::uint64_t sequence() const;
+
+    // Sequence of the last record written, and synced unless durability is NONE
+    [[nodiscard]] boost::uint64_t durable_sequence() const;
+
+    // First I/O error of the journal thread; records appended after it are dropped
+    [[nodiscard]] std::error_code error() const;
+
+    void AddSymbol(const Symbol &symbol);
+
+    void DeleteSymbol(boost::uint64_t id);
+
+    void AddOrderBook(boost::uint64_t symbol_id, const OrderBookOptions &options);
+
+    void DeleteOrderBook(boost::uint64_t id);
+
+    void AddOrder(const Order &order);
+
+    void DeleteOrder(boost::uint64_t id);
+
+    void ModifyOrder(boost::uint64_t id, boost::uint64_t price, boost::uint64_t quantity);
+
+    // At most MarketManager::MaxBatchSize orders, journaled as one record
+    void AddOrders(std::span<const Order> orders);
+
+    void DeleteOrders(std::span<const boost::uint64_t> ids);
+
+    void AddUser(const User &user);
+
+    void DeleteUser(boost::uint64_t id);
+
+    // Deletes the segments that only hold records up to the given sequence, once a snapshot holds their commands. The
+    // last segment is always kept, it carries the sequence on.
+    static void RemoveSegments(const std::string &directory, boost::uint64_t sequence);
+
+    // Waits until every record appended so far is durable or the journal failed
+    void Flush();
+
+    // Writes and syncs everything appended, whatever the durability, and stops the journal thread
+    void Close();
+
+private:
+    std::string directory_;
+    JournalDurability durability_;
+    size_t segment_size_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable appended_;
+    std::condition_variable written_;
+    boost::container::vector<boost::uint8_t> pending_;
+    boost::uint64_t sequence_;
+    boost::uint64_t durable_sequence_;
+    std::error_code error_;
+    bool stopping_;
+
+    // Owned by the journal thread. The tail holds the data of the last partially written block, which is rewritten
+    // together with the next batch.
+    boost::container::vector<boost::uint8_t> writing_;
+    boost::container::vector<boost::uint8_t> tail_;
+    int segment_fd_;
+    size_t tail_offset_;
+    std::thread thread_;
+
+    // The tail, a name or the entries of a batch, follows the payload
+    void Append(JournalRecordType type, const void *payload, size_t payload_size, std::string_view tail = {});
+
+    void Run();
+
+    std::error_code Write(const boost::container::vector<boost::uint8_t> &batch);
+
+    std::error_code WriteTail(const boost::uint8_t *data, size_t size);
+
+    std::error_code OpenSegment(boost::uint64_t first_sequence);
+
+    std::error_code CloseSegment();
+};
+
+// Reads the records of a journal directory in sequence order. Segments are mapped one at a time; reading stops at the
+// end of the last segment or at the first torn, corrupt or out of sequence record. Records up to the skip sequence,
+// such as those a snapshot already holds, are passed over and the segments holding nothing else are not read at all.
+class JournalReader {
+public:
+    explicit JournalReader(const std::string &directory, boost::uint64_t skip_sequence = 0);
+
+    JournalReader(const JournalReader &) = delete;
+
+    JournalReader(JournalReader &&) = delete;
+
+    ~JournalReader();
+
+    JournalReader &operator=(const JournalReader &) = delete;
+
+    JournalReader &operator=(JournalReader &&) = delete;
+
+    [[nodiscard]] size_t segments() const noexcept { return segments_.size(); }
+
+    // Sequence of the last record read
+    [[nodiscard]] boost::uint64_t sequence() const noexcept { return sequence_; }
+
+    bool Next(JournalRecord &record);
+
+    // Applies every remaining record to the market manager and returns how many were read
+    size_t Replay(MarketManager &market_manager);
+
+    static ErrorCode Apply(MarketManager &market_manager, const JournalRecord &record);
+
+    static std::string SegmentName(boost::uint64_t first_sequence);
+
+    // Segment paths of the directory in sequence order
+    static std::vector<std::string> ListSegments(const std::string &directory);
+
+    static boost::uint64_t SegmentSequence(const std::string &path);
+
+private:
+    std::vector<std::string> segments_;
+    size_t next_segment_;
+    const boost::uint8_t *data_;
+    size_t size_;
+    size_t offset_;
+    boost::uint64_t sequence_;
+    boost::uint64_t skip_sequence_;
+    bool done_;
+
+    bool MapSegment(const std::string &path);
+
+    void UnmapSegment() noexcept;
+
+    bool Decode(const JournalRecordHeader &header, const boost::uint8_t *payload, size_t payload_size,
+                JournalRecord &record) const;
+};
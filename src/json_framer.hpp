@@ -0,0 +1,72 @@
+#pragma once
+
+#include <limits>
+
+#include <boost/cstdint.hpp>
+
+// Splits a byte stream into top-level JSON objects without parsing them, so that requests that arrive together or
+// split across reads are each handed to the parser whole. Whitespace between objects is skipped. The scan position is
+// kept between calls, so every byte is looked at once however many reads a message takes.
+class JsonFramer {
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    JsonFramer() noexcept: offset_(0), begin_(npos), depth_(0), in_string_(false), escape_(false) {
+    }
+
+    // Looks for the end of the first object in the unread bytes. Returns its end offset and sets begin to its start
+    // offset, or returns zero when the object is not complete yet, or npos when the stream holds something other than
+    // an object. The caller consumes the returned number of bytes after a complete object.
+    size_t Next(const boost::uint8_t *data, size_t size, size_t &begin) noexcept {
+        for (; offset_ < size; ++offset_) {
+            char c = char(data[offset_]);
+
+            if (depth_ == 0) {
+                if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+                    continue;
+                if (c != '{')
+                    return npos;
+                begin_ = offset_;
+                depth_ = 1;
+                continue;
+            }
+
+            if (in_string_) {
+                if (escape_)
+                    escape_ = false;
+                else if (c == '\\')
+                    escape_ = true;
+                else if (c == '"')
+                    in_string_ = false;
+                continue;
+            }
+
+            if (c == '"') {
+                in_string_ = true;
+            } else if ((c == '{') || (c == '[')) {
+                ++depth_;
+            } else if (((c == '}') || (c == ']')) && (--depth_ == 0)) {
+                begin = begin_;
+                size_t end = offset_ + 1;
+                Reset();
+                return end;
+            }
+        }
+        return 0;
+    }
+
+    void Reset() noexcept {
+        offset_ = 0;
+        begin_ = npos;
+        depth_ = 0;
+        in_string_ = false;
+        escape_ = false;
+    }
+
+private:
+    size_t offset_;
+    size_t begin_;
+    size_t depth_;
+    bool in_string_;
+    bool escape_;
+};
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#include "latency_stats.hpp"
+
+double TimestampTicksPerNanosecond() {
+    static const double ticks_per_nanosecond = []() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto start = std::chrono::steady_clock::now();
+        boost::uint64_t start_ticks = ReadTimestamp();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        boost::uint64_t ticks = ReadTimestamp() - start_ticks;
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        return (nanoseconds > 0) ? double(ticks) / double(nanoseconds) : 1.0;
+#else
+        return 1.0;
+#endif
+    }();
+    return ticks_per_nanosecond;
+}
+
+boost::uint64_t LatencyHistogram::Percentile(double percentile) const noexcept {
+    boost::uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    // Rank of the percentile among the recorded values, counting from one
+    auto rank = boost::uint64_t(percentile / 100.0 * double(total) + 0.5);
+    rank = std::max<boost::uint64_t>(rank, 1);
+
+    boost::uint64_t seen = 0;
+    for (size_t i = 0; i < Buckets; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(UpperBound(i), max());
+    }
+    return max();
+}
+
+LatencyStats::~LatencyStats() {
+    for (auto &histograms_ptr: symbols_)
+        delete histograms_ptr;
+}
+
+void LatencyStats::AddSymbol(boost::uint64_t symbol_id) {
+#if LATENCY_STATS
+    if (symbols_.size() <= symbol_id)
+        symbols_.resize(symbol_id + 1, nullptr);
+    if (symbols_[symbol_id] == nullptr)
+        symbols_[symbol_id] = new SymbolHistograms();
+#else
+    (void) symbol_id;
+#endif
+}
+
+void LatencyStats::Merge(const LatencyStats &other) {
+    for (size_t symbol_id = 0; symbol_id < other.symbols_.size(); ++symbol_id) {
+        if (other.symbols_[symbol_id] == nullptr)
+            continue;
+        AddSymbol(symbol_id);
+        if ((symbol_id >= symbols_.size()) || (symbols_[symbol_id] == nullptr))
+            continue;
+        for (size_t operation = 0; operation < Operations; ++operation)
+            (*symbols_[symbol_id])[operation].Merge((*other.symbols_[symbol_id])[operation]);
+    }
+}
+
+std::string LatencyStats::Format() const {
+    double ticks_per_nanosecond = TimestampTicksPerNanosecond();
+    std::string result;
+
+    auto line = [&](LatencyOperation operation, const char *symbol, const LatencyHistogram &histogram) {
+        auto nanoseconds = [&](boost::uint64_t ticks) {
+            return (unsigned long long) (double(ticks) / ticks_per_nanosecond + 0.5);
+        };
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer),
+                      "%s %s: count %llu, p50 %llu ns, p99 %llu ns, "
+                      "p99.9 %llu ns, max %llu ns\n",
+                      OperationName(operation), symbol, (unsigned long long) histogram.count(),
+                      nanoseconds(histogram.Percentile(50)), nanoseconds(histogram.Percentile(99)),
+                      nanoseconds(histogram.Percentile(99.9)), nanoseconds(histogram.max()));
+        result += buffer;
+    };
+
+    for (size_t operation = 0; operation < Operations; ++operation) {
+        LatencyHistogram total;
+        for (size_t symbol_id = 0; symbol_id < symbols_.size(); ++symbol_id) {
+            if (symbols_[symbol_id] == nullptr)
+                continue;
+            const LatencyHistogram &histogram = (*symbols_[symbol_id])[operation];
+            if (histogram.count() == 0)
+                continue;
+            line(LatencyOperation(operation), ("symbol " + std::to_string(symbol_id)).c_str(), histogram);
+            total.Merge(histogram);
+        }
+        if (total.count() > 0)
+            line(LatencyOperation(operation), "all", total);
+    }
+    return result;
+}
+
+const char *LatencyStats::OperationName(LatencyOperation operation) noexcept {
+    switch (operation) {
+        case LatencyOperation::ADD_ORDER:
+            return "AddOrder";
+        case LatencyOperation::DELETE_ORDER:
+            return "DeleteOrder";
+        case LatencyOperation::MODIFY_ORDER:
+            return "ModifyOrder";
+        case LatencyOperation::MATCH:
+            return "Match";
+        case LatencyOperation::ACTIVATE_STOP_ORDERS:
+            return "ActivateStopOrders";
+    }
+    return "Unknown";
+}
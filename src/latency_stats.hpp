@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <boost/container/vector.hpp>
+#include <boost/cstdint.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Set to 0 to compile the hot path timers out entirely, the stats then stay empty
+#if !defined(LATENCY_STATS)
+#define LATENCY_STATS 1
+#endif
+
+// Cheapest monotonic tick source: the TSC on x86, nanoseconds elsewhere
+inline boost::uint64_t ReadTimestamp() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return boost::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Ticks of ReadTimestamp per nanosecond, measured once against the steady clock. The first call sleeps for 10 ms.
+double TimestampTicksPerNanosecond();
+
+// Log-linear histogram in the manner of HdrHistogram: values below SubBuckets are counted exactly and every power of
+// two above is split into SubBuckets linear buckets, so a bucket is never wider than 1/SubBuckets of its values. Each
+// histogram has a single writer; the counters are relaxed atomics written with a plain load and store, so recording
+// costs no more than a plain increment while other threads may read and merge the histogram at any time.
+class LatencyHistogram {
+public:
+    static constexpr size_t SubBucketBits = 5;
+    static constexpr size_t SubBuckets = size_t(1) << SubBucketBits;
+    static constexpr size_t Buckets = (64 - SubBucketBits + 1) * SubBuckets;
+
+    LatencyHistogram() noexcept: counts_{}, count_(0), max_(0) {
+    }
+
+    LatencyHistogram(const LatencyHistogram &other) noexcept: LatencyHistogram() {
+        Merge(other);
+    }
+
+    LatencyHistogram(LatencyHistogram &&) = delete;
+
+    ~LatencyHistogram() noexcept = default;
+
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    LatencyHistogram &operator=(LatencyHistogram &&) = delete;
+
+    [[nodiscard]] boost::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] boost::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+    void Record(boost::uint64_t value) noexcept {
+        Increment(counts_[Index(value)], 1);
+        Increment(count_, 1);
+        if (value > max_.load(std::memory_order_relaxed))
+            max_.store(value, std::memory_order_relaxed);
+    }
+
+    // Adds the counts of another histogram, which may be recorded into meanwhile. Only the owner of this one may call
+    // it.
+    void Merge(const LatencyHistogram &other) noexcept {
+        for (size_t i = 0; i < Buckets; ++i)
+            Increment(counts_[i], other.counts_[i].load(std::memory_order_relaxed));
+        Increment(count_, other.count());
+        if (other.max() > max())
+            max_.store(other.max(), std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding the given percentile, zero when empty
+    [[nodiscard]] boost::uint64_t Percentile(double percentile) const noexcept;
+
+    static size_t Index(boost::uint64_t value) noexcept {
+        if (value < SubBuckets)
+            return size_t(value);
+        size_t magnitude = 63 - size_t(__builtin_clzll(value));
+        size_t shift = magnitude - SubBucketBits;
+        return (shift + 1) * SubBuckets + size_t((value >> shift) & (SubBuckets - 1));
+    }
+
+    static boost::uint64_t UpperBound(size_t index) noexcept {
+        if (index < SubBuckets)
+            return index;
+        size_t shift = index / SubBuckets - 1;
+        boost::uint64_t lower = boost::uint64_t(SubBuckets + index % SubBuckets) << shift;
+        return lower + ((boost::uint64_t(1) << shift) - 1);
+    }
+
+private:
+    std::array<std::atomic<boost::uint64_t>, Buckets> counts_;
+    std::atomic<boost::uint64_t> count_;
+    std::atomic<boost::uint64_t> max_;
+
+    static void Increment(std::atomic<boost::uint64_t> &counter, boost::uint64_t value) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+enum class LatencyOperation : boost::uint8_t {
+    ADD_ORDER,
+    DELETE_ORDER,
+    MODIFY_ORDER,
+    MATCH,
+    ACTIVATE_STOP_ORDERS
+};
+
+// Latency histograms of the matching hot path per operation and symbol, in timestamp ticks. A market manager records
+// into its own stats from the thread driving it; stats of several managers or threads are combined with Merge.
+// Histograms of a symbol are allocated when its book is added, so with the books set up before trading starts other
+// threads can read the stats while they are being recorded.
+class LatencyStats {
+public:
+    static constexpr size_t Operations = 5;
+
+    typedef std::array<LatencyHistogram, Operations> SymbolHistograms;
+
+    LatencyStats() = default;
+
+    LatencyStats(const LatencyStats &) = delete;
+
+    LatencyStats(LatencyStats &&) = delete;
+
+    ~LatencyStats();
+
+    LatencyStats &operator=(const LatencyStats &) = delete;
+
+    LatencyStats &operator=(LatencyStats &&) = delete;
+
+    [[nodiscard]] size_t symbols() const noexcept { return symbols_.size(); }
+
+    // Histogram of an operation on a symbol, null when nothing was recorded for the symbol
+    [[nodiscard]] const LatencyHistogram *Get(LatencyOperation operation, boost::uint64_t symbol_id) const noexcept {
+        if ((symbol_id >= symbols_.size()) || (symbols_[symbol_id] == nullptr))
+            return nullptr;
+        return &(*symbols_[symbol_id])[size_t(operation)];
+    }
+
+    void AddSymbol(boost::uint64_t symbol_id);
+
+    void Record(LatencyOperation operation, boost::uint64_t symbol_id, boost::uint64_t ticks) {
+#if LATENCY_STATS
+        if ((symbol_id >= symbols_.size()) || (symbols_[symbol_id] == nullptr))
+            AddSymbol(symbol_id);
+        (*symbols_[symbol_id])[size_t(operation)].Record(ticks);
+#else
+        (void) operation, (void) symbol_id, (void) ticks;
+#endif
+    }
+
+    void Merge(const LatencyStats &other);
+
+    // Count, p50, p99, p99.9 and max in nanoseconds of every operation per symbol and over all symbols, one line each
+    [[nodiscard]] std::string Format() const;
+
+    static const char *OperationName(LatencyOperation operation) noexcept;
+
+private:
+    boost::container::vector<SymbolHistograms *> symbols_;
+};
+
+// Records the ticks from its construction to its destruction; does nothing when LATENCY_STATS is 0
+class LatencyTimer {
+public:
+#if LATENCY_STATS
+    LatencyTimer(LatencyStats &stats, LatencyOperation operation, boost::uint64_t symbol_id) noexcept
+            : stats_(stats), operation_(operation), symbol_id_(symbol_id), start_(ReadTimestamp()) {
+    }
+
+    ~LatencyTimer() {
+        stats_.Record(operation_, symbol_id_, ReadTimestamp() - start_);
+    }
+#else
+    LatencyTimer(LatencyStats &, LatencyOperation, boost::uint64_t) noexcept {
+    }
+#endif
+
+    LatencyTimer(const LatencyTimer &) = delete;
+
+    LatencyTimer(LatencyTimer &&) = delete;
+
+    LatencyTimer &operator=(const LatencyTimer &) = delete;
+
+    LatencyTimer &operator=(LatencyTimer &&) = delete;
+
+#if LATENCY_STATS
+private:
+    LatencyStats &stats_;
+    LatencyOperation operation_;
+    boost::uint64_t symbol_id_;
+    boost::uint64_t start_;
+#endif
+};
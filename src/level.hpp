@@ -2,6 +2,7 @@
 
 #include <boost/intrusive/set.hpp>
 
+#include "memory_pool.hpp"
 #include "order.hpp"
 #include "update.hpp"
 
@@ -108,6 +109,16 @@ public:
 
 typedef boost::intrusive::set<LevelNode, boost::intrusive::member_hook<LevelNode, boost::intrusive::set_member_hook<>, &LevelNode::member_hook_>> LevelNodeSet;
 
+typedef MemoryPool<LevelNode> LevelNodePool;
+
+// Heterogeneous comparator that lets LevelNodeSet lookups take a bare price instead of a temporary LevelNode
+class LevelPriceCompare {
+public:
+    bool operator()(const LevelNode &level, boost::uint64_t price) const noexcept { return level.Price < price; }
+
+    bool operator()(boost::uint64_t price, const LevelNode &level) const noexcept { return price < level.Price; }
+};
+
 class LevelUpdate {
 public:
     UpdateType Type;
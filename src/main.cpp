@@ -1,56 +1,245 @@
+#include <filesystem>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <boost/bind/bind.hpp>
 #include <boost/asio.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/container/vector.hpp>
 #include <nlohmann/json.hpp>
 
+#include "binary_session.hpp"
 #include "common.hpp"
+#include "engine_reply.hpp"
+#include "engine_strand.hpp"
+#include "journal.hpp"
+#include "json_framer.hpp"
+#include "market_data.hpp"
 #include "market_manager.hpp"
+#include "receive_buffer.hpp"
+#include "reply_queue.hpp"
+#include "sharded_engine.hpp"
+#include "snapshot.hpp"
 
 using namespace boost::placeholders;
 
+// Latency stats of the manager, or merged over the shards when they do the matching
+static std::string FormatLatencyStats(const MarketManager &market_manager, const ShardedEngine *engine_ptr) {
+    if (engine_ptr == nullptr)
+        return market_manager.latency_stats().Format();
+
+    LatencyStats stats;
+    engine_ptr->MergeLatencyStats(stats);
+    return stats.Format();
+}
+
+// Session speaking the JSON protocol. The stream is split into top-level JSON objects, so requests may be sent back to
+// back without waiting for the replies. The connection is served by two coroutines: the reader handles every complete
+// request of a read before reading again and stops while all reply slots are taken, the partial tail waits in the
+// buffer; the writer sends the replies in request order, gathering all those that are ready into one write.
 class Session : public std::enable_shared_from_this<Session> {
 public:
-    Session(boost::asio::io_service &io_service, MarketManager &market_manager)
-            : socket_(io_service), market_manager_(market_manager),
-              user_id_(std::numeric_limits<boost::uint64_t>::max()) {}
+    Session(boost::asio::io_service &io_service, MarketManager &market_manager, ShardedEngine *engine_ptr,
+            EngineIds &engine_ids, IoStrand &engine_strand)
+            : strand_(boost::asio::make_strand(io_service)), socket_(strand_), market_manager_(market_manager),
+              engine_ptr_(engine_ptr), engine_ids_(engine_ids), engine_strand_(engine_strand),
+              reply_ready_(strand_, StrandTimer::time_point::max()),
+              reply_slots_free_(strand_, StrandTimer::time_point::max()), reading_(true),
+              writer_waiting_(false), reader_waiting_(false), user_id_(std::numeric_limits<boost::uint64_t>::max()) {
+        gather_.reserve(MaxGatheredReplies);
+    }
 
-    boost::asio::ip::tcp::socket &socket() {
+    StrandSocket &socket() {
         return socket_;
     }
 
     void Start() {
-        socket_.async_read_some(boost::asio::buffer(data_, max_length),
-                                boost::bind(&Session::HandleRead, shared_from_this(), _1, _2));
+        auto self = shared_from_this();
+        boost::asio::co_spawn(strand_, ReadLoop(self), boost::asio::detached);
+        boost::asio::co_spawn(strand_, WriteLoop(self), boost::asio::detached);
+    }
+
+    IoStrand &executor() {
+        return strand_;
+    }
+
+    void OnEngineReply(boost::uint64_t sequence, boost::uint8_t type, ErrorCode error, boost::uint64_t,
+                       boost::int64_t value) {
+        auto request = static_cast<Requests>(type);
+        if (request == Requests::Registration)
+            Reply(sequence,
+                  (error == ErrorCode::OK) ? "Registration is successful!\n" : "Registration is not successful!\n");
+        else if (request == Requests::ViewBalance)
+            Reply(sequence, "Your balance is: " + std::to_string(value) + "\n");
+        else
+            Reply(sequence, (error == ErrorCode::OK) ? "The order was successfully created\n"
+                                                     : "The order was not created successfully\n");
+    }
+
+    void Reply(boost::uint64_t sequence, std::string reply) {
+        replies_.Complete(sequence, std::move(reply));
+        if (writer_waiting_ && replies_.ready())
+            reply_ready_.cancel();
     }
 
 private:
-    void HandleRead(const boost::system::error_code &error, size_t bytes_transferred) {
-        if (!error) {
-            data_[bytes_transferred] = '\0';
-            auto j = nlohmann::json::parse(data_);
-            auto reqType = static_cast<Requests>(j["ReqType"]);
-            std::string reply;
-
-            if (reqType == Requests::Registration) {
-                reply = HandleRegistration(j);
-            } else if (reqType == Requests::ViewBalance) {
-                reply = HandleViewBalance(j);
-            } else if (reqType == Requests::AddOrder) {
-                reply = HandleAddOrder(j);
-            } else
-                reply = "Error! Unknown request type\n";
-
-            boost::asio::async_write(socket_,
-                                     boost::asio::buffer(reply, reply.size()),
-                                     boost::bind(&Session::HandleWrite, shared_from_this(), _1));
+    StrandAwaitable<> ReadLoop(std::shared_ptr<Session> self) {
+        boost::system::error_code error;
+        for (;;) {
+            bool valid = CollectRequests();
+            if (!batch_.empty()) {
+                co_await ExecuteOnEngine(engine_strand_, [this]() { ExecuteBatch(); }, use_strand_awaitable);
+                CompleteBatch();
+            }
+
+            // Anything but a JSON object closes the session
+            if (!valid) {
+                socket_.close();
+                break;
+            }
+
+            if (replies_.full()) {
+                reader_waiting_ = true;
+                co_await reply_slots_free_.async_wait(boost::asio::redirect_error(use_strand_awaitable, error));
+                reader_waiting_ = false;
+                if (!socket_.is_open())
+                    break;
+                continue;
+            }
+
+            // A request that does not fit is not going to become valid
+            if (buffer_.size() > max_request_size) {
+                socket_.close();
+                break;
+            }
+
+            size_t bytes_transferred = co_await socket_.async_read_some(
+                    boost::asio::buffer(buffer_.Prepare(read_size), buffer_.available()),
+                    boost::asio::redirect_error(use_strand_awaitable, error));
+            if (error)
+                break;
+            buffer_.Commit(bytes_transferred);
         }
+
+        // Cancel on disconnect: the orders of a user do not outlive its session
+        if (user_id_ != std::numeric_limits<boost::uint64_t>::max())
+            co_await ExecuteOnEngine(engine_strand_, [this]() { CancelAllOrders(); }, use_strand_awaitable);
+
+        // The writer still sends the replies the engine owes
+        reading_ = false;
+        if (writer_waiting_)
+            reply_ready_.cancel();
     }
 
-    void HandleWrite(const boost::system::error_code &error) {
-        if (!error)
-            Start();
+    StrandAwaitable<> WriteLoop(std::shared_ptr<Session> self) {
+        boost::system::error_code error;
+        for (;;) {
+            while (!replies_.ready()) {
+                if (!reading_ && (replies_.empty() || !socket_.is_open()))
+                    co_return;
+
+                writer_waiting_ = true;
+                co_await reply_ready_.async_wait(boost::asio::redirect_error(use_strand_awaitable, error));
+                writer_waiting_ = false;
+            }
+
+            gather_.clear();
+            size_t gathered = replies_.Gather([this](const std::string &reply) {
+                gather_.push_back(boost::asio::buffer(reply, reply.size()));
+            }, MaxGatheredReplies);
+
+            std::span<const boost::asio::const_buffer> buffers(gather_.data(), gather_.size());
+            co_await boost::asio::async_write(socket_, buffers,
+                                              boost::asio::redirect_error(use_strand_awaitable, error));
+            if (error) {
+                socket_.close();
+                if (reader_waiting_)
+                    reply_slots_free_.cancel();
+                co_return;
+            }
+
+            replies_.Pop(gathered);
+            if (reader_waiting_ && (replies_.size() < replies_.capacity() / 2))
+                reply_slots_free_.cancel();
+        }
+    }
+
+    // Parses the complete requests in the buffer into the batch while there are reply slots, false means the stream
+    // holds something other than JSON objects after them
+    bool CollectRequests() {
+        batch_.clear();
+        while (!replies_.full()) {
+            size_t begin = 0;
+            size_t end = framer_.Next(buffer_.data(), buffer_.size(), begin);
+            if (end == JsonFramer::npos)
+                return false;
+            if (end == 0)
+                break;
+
+            batch_.push_back(BatchRequest{replies_.Reserve(),
+                                          nlohmann::json::parse(buffer_.data() + begin, buffer_.data() + end, nullptr,
+                                                                false), false, std::string()});
+            buffer_.Consume(end);
+        }
+        return true;
+    }
+
+    // Runs on the engine strand
+    void ExecuteBatch() {
+        for (auto &request: batch_) {
+            if (request.Request.is_discarded()) {
+                request.Reply = "Error! Invalid request\n";
+                request.Replied = true;
+                continue;
+            }
+
+            try {
+                auto reqType = static_cast<Requests>(request.Request.at("ReqType"));
+                if ((engine_ptr_ != nullptr) && HandleEngineRequest(request.Sequence, reqType, request.Request))
+                    continue;
+
+                if (reqType == Requests::Registration) {
+                    request.Reply = HandleRegistration(request.Request);
+                } else if (reqType == Requests::ViewBalance) {
+                    request.Reply = HandleViewBalance(request.Request);
+                } else if (reqType == Requests::AddOrder) {
+                    request.Reply = HandleAddOrder(request.Request);
+                } else if (reqType == Requests::Stats) {
+                    request.Reply = HandleStats();
+                } else
+                    request.Reply = "Error! Unknown request type\n";
+            } catch (const nlohmann::json::exception &) {
+                request.Reply = "Error! Invalid request\n";
+            }
+            request.Replied = true;
+        }
+    }
+
+    // Queues the replies of the executed batch
+    void CompleteBatch() {
+        for (auto &request: batch_)
+            if (request.Replied)
+                replies_.Complete(request.Sequence, std::move(request.Reply));
+
+        if (writer_waiting_ && replies_.ready())
+            reply_ready_.cancel();
+    }
+
+    // Runs on the engine strand
+    void CancelAllOrders() {
+        if (engine_ptr_ != nullptr)
+            engine_ptr_->CancelAllOrders(0, user_id_);
+        else
+            market_manager_.CancelAllOrders(user_id_);
     }
 
     std::string HandleRegistration(const nlohmann::json &request) {
@@ -58,7 +247,7 @@ private:
             return "You are already registered\n";
 
         auto user_id = market_manager_.users().size();
-        std::string username = request["Username"];
+        std::string username = request.at("Username");
         auto error_code = market_manager_.AddUser(User(user_id, username));
         if (error_code != ErrorCode::OK)
             return "Registration is not successful!\n";
@@ -76,10 +265,13 @@ private:
     }
 
     std::string HandleAddOrder(const nlohmann::json &request) {
-        boost::uint64_t symbolId = request["SymbolId"];
-        OrderSide type = (request["Type"] == "Buy") ? OrderSide::BUY : OrderSide::SELL;
-        boost::uint64_t price = request["Price"];
-        boost::uint64_t quantity = request["Quantity"];
+        if (user_id_ == std::numeric_limits<boost::uint64_t>::max())
+            return "You are not registered\n";
+
+        boost::uint64_t symbolId = request.at("SymbolId");
+        OrderSide type = (request.at("Type") == "Buy") ? OrderSide::BUY : OrderSide::SELL;
+        boost::uint64_t price = request.at("Price");
+        boost::uint64_t quantity = request.at("Quantity");
 
         auto error_code = market_manager_.AddOrder(Order(market_manager_.GetOrdersCount(), symbolId, user_id_, type, price, 0, quantity));
         if (error_code != ErrorCode::OK)
@@ -88,28 +280,103 @@ private:
         return "The order was successfully created\n";
     }
 
-    boost::asio::ip::tcp::socket socket_;
+    std::string HandleStats() {
+        std::string stats = FormatLatencyStats(market_manager_, engine_ptr_);
+        return stats.empty() ? "No latency stats\n" : stats;
+    }
+
+    // Hands the request to the engine shards, the reply is sent once they report back. Returns false for the requests that
+    // are answered right away.
+    bool HandleEngineRequest(boost::uint64_t sequence, Requests type, const nlohmann::json &request) {
+        if (type == Requests::Registration) {
+            if (user_id_ != std::numeric_limits<boost::uint64_t>::max())
+                return false;
+
+            user_id_ = engine_ids_.NextUserId++;
+            engine_ptr_->AddUser(0, user_id_, &Pending::OnResult,
+                                 new Pending(shared_from_this(), sequence, boost::uint8_t(type), 0,
+                                             engine_ptr_->shards()));
+            return true;
+        }
+
+        if (user_id_ == std::numeric_limits<boost::uint64_t>::max())
+            return false;
+
+        if (type == Requests::ViewBalance) {
+            engine_ptr_->GetBalance(0, user_id_, &Pending::OnResult,
+                                    new Pending(shared_from_this(), sequence, boost::uint8_t(type), 0,
+                                                engine_ptr_->shards()));
+            return true;
+        }
+
+        if (type == Requests::AddOrder) {
+            boost::uint64_t symbolId = request.at("SymbolId");
+            OrderSide side = (request.at("Type") == "Buy") ? OrderSide::BUY : OrderSide::SELL;
+            boost::uint64_t price = request.at("Price");
+            boost::uint64_t quantity = request.at("Quantity");
+
+            boost::uint64_t order_id = engine_ids_.NextOrderId++;
+            engine_ptr_->AddOrder(0, Order(order_id, symbolId, user_id_, side, price, 0, quantity),
+                                  &Pending::OnResult,
+                                  new Pending(shared_from_this(), sequence, boost::uint8_t(type), order_id, 1));
+            return true;
+        }
+
+        return false;
+    }
+
+    // A parsed request of the batch being executed, with its reply when the engine phase produced one
+    class BatchRequest {
+    public:
+        boost::uint64_t Sequence;
+        nlohmann::json Request;
+        bool Replied;
+        std::string Reply;
+    };
+
+    IoStrand strand_;
+    StrandSocket socket_;
     MarketManager &market_manager_;
+    ShardedEngine *engine_ptr_;
+    EngineIds &engine_ids_;
+    IoStrand &engine_strand_;
+
+    typedef EngineReply<Session> Pending;
     enum {
-        max_length = 1024
+        read_size = 1024,
+        max_request_size = 65536
     };
-    char data_[max_length]{};
+    ReceiveBuffer buffer_;
+    JsonFramer framer_;
+    ReplyQueue<std::string> replies_;
+    boost::container::vector<boost::asio::const_buffer> gather_;
+    boost::container::vector<BatchRequest> batch_;
+
+    // Timers that never expire, cancelled to wake the coroutine waiting on them
+    StrandTimer reply_ready_;
+    StrandTimer reply_slots_free_;
+    bool reading_;
+    bool writer_waiting_;
+    bool reader_waiting_;
     boost::uint64_t user_id_;
 };
 
 class Server {
 public:
-    Server(boost::asio::io_service &io_service, MarketManager &market_manager)
+    Server(boost::asio::io_service &io_service, MarketManager &market_manager, ShardedEngine *engine_ptr,
+           EngineIds &engine_ids, IoStrand &engine_strand)
             : io_service_(io_service),
               acceptor_(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), PORT)),
-              market_manager_(market_manager) {
+              market_manager_(market_manager), engine_ptr_(engine_ptr), engine_ids_(engine_ids),
+              engine_strand_(engine_strand) {
         std::cout << "Server started! Listen " << PORT << " port" << std::endl;
         StartAccept();
     }
 
 private:
     void StartAccept() {
-        auto new_session = std::make_shared<Session>(io_service_, market_manager_);
+        auto new_session = std::make_shared<Session>(io_service_, market_manager_, engine_ptr_, engine_ids_,
+                                                     engine_strand_);
         acceptor_.async_accept(new_session->socket(),
                                boost::bind(&Server::HandleAccept, this, new_session, _1));
     }
@@ -124,17 +391,147 @@ private:
     boost::asio::io_service &io_service_;
     boost::asio::ip::tcp::acceptor acceptor_;
     MarketManager &market_manager_;
+    ShardedEngine *engine_ptr_;
+    EngineIds &engine_ids_;
+    IoStrand &engine_strand_;
 };
 
-int main() {
+// Prints the latency stats every STATS_DUMP_SECONDS. Runs on the engine strand, so the stats of a manager driven from
+// that strand are read between its commands.
+class StatsDump {
+public:
+    StatsDump(IoStrand &engine_strand, const MarketManager &market_manager, const ShardedEngine *engine_ptr)
+            : timer_(engine_strand), market_manager_(market_manager), engine_ptr_(engine_ptr) {
+        // The timestamp calibration sleeps, so it runs here at startup rather than on the engine strand of the first
+        // stats request or dump
+        TimestampTicksPerNanosecond();
+
+        if (STATS_DUMP_SECONDS > 0)
+            Schedule();
+    }
+
+private:
+    void Schedule() {
+        timer_.expires_after(std::chrono::seconds(STATS_DUMP_SECONDS));
+        timer_.async_wait([this](const boost::system::error_code &error) {
+            if (error)
+                return;
+            Dump();
+            Schedule();
+        });
+    }
+
+    void Dump() {
+        std::string stats = FormatLatencyStats(market_manager_, engine_ptr_);
+        if (!stats.empty())
+            std::cout << stats << std::flush;
+    }
+
+    StrandTimer timer_;
+    const MarketManager &market_manager_;
+    const ShardedEngine *engine_ptr_;
+};
+
+// Runs the I/O service on the given number of threads, the calling thread being one of them
+static void RunIoThreads(boost::asio::io_service &io_service, size_t io_threads) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < io_threads; ++i)
+        threads.emplace_back([&io_service]() { io_service.run(); });
+    io_service.run();
+    for (auto &thread: threads)
+        thread.join();
+}
+
+static JournalDurability ParseDurability(const std::string &name) {
+    if (name == "none")
+        return JournalDurability::NONE;
+    if (name == "per-command")
+        return JournalDurability::PER_COMMAND;
+    if (name == "batched")
+        return JournalDurability::BATCHED;
+    throw std::invalid_argument("Unknown journal durability " + name);
+}
+
+int main(int argc, char *argv[]) {
     try {
+        // An optional shard count moves the matching onto that many pinned engine threads, an optional I/O thread count
+        // spreads the sessions over that many threads. Without shards, an optional journal directory is replayed on
+        // start and journals every accepted command with the given durability, batched by default.
+        size_t shards = (argc > 1) ? std::stoul(argv[1]) : 0;
+        size_t io_threads = (argc > 2) ? std::max<size_t>(std::stoul(argv[2]), 1)
+                                       : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
         boost::asio::io_service io_service;
+        IoStrand engine_strand = boost::asio::make_strand(io_service);
         MarketManager market_manager;
+        EngineIds engine_ids;
         const Symbol symbol{0, "USDRUB"};
+
+        if (shards > 0) {
+            ShardedEngine engine(shards);
+            engine.AddSymbol(symbol);
+            engine.Start(true);
+
+            Server server(io_service, market_manager, &engine, engine_ids, engine_strand);
+            BinaryServer binary_server(io_service, BINARY_PORT, market_manager, &engine, engine_ids, engine_strand);
+            std::cout << "Binary order entry on " << BINARY_PORT << " port" << std::endl;
+            StatsDump stats_dump(engine_strand, market_manager, &engine);
+            RunIoThreads(io_service, io_threads);
+
+            engine.Stop();
+            return EXIT_SUCCESS;
+        }
+
+        std::unique_ptr<Journal> journal_ptr;
+        if (argc > 3) {
+            // The snapshot restores the state up to its sequence and the journal replays the commands after it. A
+            // new snapshot then replaces the replayed segments, so the next start replays nothing twice.
+            std::string directory = argv[3];
+            std::string snapshot_path = directory + "/snapshot";
+            boost::uint64_t snapshot_sequence = 0;
+            if (std::filesystem::exists(snapshot_path)) {
+                snapshot_sequence = Snapshot::Load(market_manager, snapshot_path);
+                std::cout << "Loaded snapshot of " << market_manager.orders().size() << " orders at sequence "
+                          << snapshot_sequence << std::endl;
+            }
+
+            JournalReader journal_reader(directory, snapshot_sequence);
+            size_t records = journal_reader.Replay(market_manager);
+            std::cout << "Replayed " << records << " journal records from " << directory << std::endl;
+            if (records > 0) {
+                snapshot_sequence = journal_reader.sequence();
+                Snapshot::Save(market_manager, snapshot_path, snapshot_sequence);
+            }
+
+            journal_ptr = std::make_unique<Journal>(directory, (argc > 4) ? ParseDurability(argv[4])
+                                                                          : JournalDurability::BATCHED);
+            if (journal_ptr->sequence() < snapshot_sequence)
+                throw std::runtime_error("Journal in " + directory + " ends before its snapshot");
+            Journal::RemoveSegments(directory, snapshot_sequence);
+            market_manager.AttachJournal(*journal_ptr);
+        }
+
+        // Both fail as duplicates when the journal already brought them back
         market_manager.AddSymbol(symbol);
         market_manager.AddOrderBook(symbol);
-        Server server(io_service, market_manager);
-        io_service.run();
+
+        ExecutionEventRing market_data_ring(MARKET_DATA_RING_SIZE);
+        market_manager.Subscribe(market_data_ring);
+        UdpMarketDataSink market_data_sink(io_service, boost::asio::ip::udp::endpoint(
+                boost::asio::ip::make_address(MARKET_DATA_GROUP), MARKET_DATA_PORT));
+        MarketDataPublisher market_data_publisher(market_data_ring, market_data_sink);
+        std::atomic<bool> running(true);
+        std::thread market_data_thread([&]() { market_data_publisher.Run(running); });
+
+        Server server(io_service, market_manager, nullptr, engine_ids, engine_strand);
+        BinaryServer binary_server(io_service, BINARY_PORT, market_manager, nullptr, engine_ids, engine_strand);
+        std::cout << "Binary order entry on " << BINARY_PORT << " port" << std::endl;
+        StatsDump stats_dump(engine_strand, market_manager, nullptr);
+        RunIoThreads(io_service, io_threads);
+
+        running = false;
+        market_data_thread.join();
+        market_manager.DetachJournal();
     } catch (std::exception &e) {
         std::cerr << "Exception: " << e.what() << "\n";
     }
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <boost/asio/ip/multicast.hpp>
+
+#include "market_data.hpp"
+
+UdpMarketDataSink::UdpMarketDataSink(boost::asio::io_context &io_context,
+                                     const boost::asio::ip::udp::endpoint &endpoint, int hops)
+        : socket_(io_context, endpoint.protocol()), endpoint_(endpoint) {
+    if (endpoint.address().is_multicast()) {
+        socket_.set_option(boost::asio::ip::multicast::hops(hops));
+        socket_.set_option(boost::asio::ip::multicast::enable_loopback(true));
+    }
+}
+
+void UdpMarketDataSink::Send(const boost::uint8_t *data, size_t size) {
+    // Market data is best effort, a datagram the kernel refuses is recovered by the next snapshot
+    boost::system::error_code error;
+    socket_.send_to(boost::asio::buffer(data, size), endpoint_, 0, error);
+}
+
+MarketDataPublisher::MarketDataPublisher(ExecutionEventRing &ring, MarketDataSink &sink,
+                                         std::chrono::milliseconds snapshot_interval)
+        : ring_(ring), sink_(sink), snapshot_interval_(snapshot_interval),
+          next_snapshot_(std::chrono::steady_clock::now() + snapshot_interval), header_() {
+}
+
+size_t MarketDataPublisher::Poll() {
+    size_t count = ring_.Drain([this](const ExecutionEvent &event) {
+        if (event.Type == ExecutionEventType::LEVEL_UPDATE)
+            OnLevelUpdate(event.LevelState);
+    });
+    Flush();
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_snapshot_) {
+        PublishSnapshots();
+        next_snapshot_ = now + snapshot_interval_;
+    }
+
+    return count;
+}
+
+void MarketDataPublisher::PublishSnapshots() {
+    Flush();
+
+    for (boost::uint64_t symbol_id = 0; symbol_id < symbols_.size(); ++symbol_id) {
+        const SymbolState &state = symbols_[symbol_id];
+        const L2Book &book = state.Book;
+
+        size_t levels = book.bids().size() + book.asks().size();
+        size_t parts = std::max<size_t>((levels + MaxMarketDataLevels - 1) / MaxMarketDataLevels, 1);
+
+        header_ = {symbol_id, state.Sequence, MarketDataMessageType::SNAPSHOT, 0, boost::uint16_t(parts), 0};
+
+        for (auto &level: book.bids()) {
+            Append({UpdateType::ADD, LevelType::BID, level.first, level.second.Volume, level.second.Orders});
+            if (header_.Count == MaxMarketDataLevels)
+                Flush();
+        }
+        for (auto &level: book.asks()) {
+            Append({UpdateType::ADD, LevelType::ASK, level.first, level.second.Volume, level.second.Orders});
+            if (header_.Count == MaxMarketDataLevels)
+                Flush();
+        }
+
+        Flush();
+
+        // An empty book still goes out as a single empty part so that receivers can sync on it
+        if (levels == 0) {
+            std::memcpy(datagram_.data(), &header_, sizeof(header_));
+            sink_.Send(datagram_.data(), sizeof(header_));
+        }
+    }
+}
+
+void MarketDataPublisher::Run(const std::atomic<bool> &running) {
+    while (running.load(std::memory_order_relaxed))
+        if (Poll() == 0)
+            std::this_thread::yield();
+
+    Poll();
+}
+
+void MarketDataPublisher::OnLevelUpdate(const LevelEvent &event) {
+    if (symbols_.size() <= event.SymbolId)
+        symbols_.resize(event.SymbolId + 1);
+
+    SymbolState &state = symbols_[event.SymbolId];
+
+    MarketDataLevel level{event.Update, event.Type, event.Price, event.VisibleVolume,
+                          boost::uint32_t(event.Orders)};
+    state.Book.Apply(level);
+
+    boost::uint64_t sequence = ++state.Sequence;
+
+    if ((header_.Count > 0) && ((header_.SymbolId != event.SymbolId) || (header_.Count == MaxMarketDataLevels)))
+        Flush();
+
+    if (header_.Count == 0)
+        header_ = {event.SymbolId, sequence, MarketDataMessageType::INCREMENTAL, 0, 1, 0};
+
+    Append(level);
+}
+
+void MarketDataPublisher::Append(const MarketDataLevel &level) {
+    std::memcpy(datagram_.data() + sizeof(header_) + header_.Count * sizeof(MarketDataLevel), &level, sizeof(level));
+    ++header_.Count;
+}
+
+void MarketDataPublisher::Flush() {
+    if (header_.Count == 0)
+        return;
+
+    std::memcpy(datagram_.data(), &header_, sizeof(header_));
+    sink_.Send(datagram_.data(), sizeof(header_) + header_.Count * sizeof(MarketDataLevel));
+
+    ++header_.Part;
+    header_.Count = 0;
+}
+
+bool MarketDataReceiver::OnDatagram(const boost::uint8_t *data, size_t size) {
+    if (size < sizeof(MarketDataHeader))
+        return false;
+
+    MarketDataHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if ((size != sizeof(header) + header.Count * sizeof(MarketDataLevel)) || (header.Part >= header.Parts))
+        return false;
+
+    if (symbols_.size() <= header.SymbolId)
+        symbols_.resize(header.SymbolId + 1);
+
+    SymbolState &state = symbols_[header.SymbolId];
+    if (header.Type == MarketDataMessageType::INCREMENTAL)
+        OnIncremental(state, header, data + sizeof(header));
+    else
+        OnSnapshot(state, header, data + sizeof(header));
+
+    return true;
+}
+
+void MarketDataReceiver::OnIncremental(SymbolState &state, const MarketDataHeader &header,
+                                       const boost::uint8_t *levels) {
+    if (!state.Synced)
+        return;
+
+    if (header.Sequence > state.NextSequence) {
+        state.Synced = false;
+        ++gaps_;
+        return;
+    }
+
+    // Skip the changes that were already applied, through an earlier copy or a newer snapshot
+    for (boost::uint64_t index = state.NextSequence - header.Sequence; index < header.Count; ++index) {
+        MarketDataLevel level;
+        std::memcpy(&level, levels + index * sizeof(level), sizeof(level));
+        state.Book.Apply(level);
+        ++state.NextSequence;
+    }
+}
+
+void MarketDataReceiver::OnSnapshot(SymbolState &state, const MarketDataHeader &header,
+                                    const boost::uint8_t *levels) {
+    if (header.Part == 0) {
+        state.Snapshot.clear();
+        state.SnapshotSequence = header.Sequence;
+        state.NextPart = 0;
+    }
+
+    // A lost or reordered part invalidates the snapshot being assembled
+    if ((header.Part != state.NextPart) || (header.Sequence != state.SnapshotSequence)) {
+        state.NextPart = 0;
+        return;
+    }
+
+    for (size_t index = 0; index < header.Count; ++index) {
+        MarketDataLevel level;
+        std::memcpy(&level, levels + index * sizeof(level), sizeof(level));
+        state.Snapshot.Apply(level);
+    }
+
+    if (++state.NextPart < header.Parts)
+        return;
+
+    state.NextPart = 0;
+
+    // A synced book that is already ahead of the snapshot has nothing to learn from it
+    if (state.Synced && (header.Sequence + 1 <= state.NextSequence))
+        return;
+
+    std::swap(state.Book, state.Snapshot);
+    state.Snapshot.clear();
+    state.NextSequence = header.Sequence + 1;
+    state.Synced = true;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#include <boost/asio/ip/udp.hpp>
+#include <boost/container/flat_map.hpp>
+#include <boost/container/vector.hpp>
+#include <boost/cstdint.hpp>
+
+#include "execution_event.hpp"
+#include "level.hpp"
+#include "update.hpp"
+
+enum class MarketDataMessageType : boost::uint8_t {
+    INCREMENTAL,
+    SNAPSHOT
+};
+
+// Wire format of the L2 feed. Every datagram is a header followed by Count level entries, all in host byte order and
+// without padding. Sequence numbers are per symbol and count level changes: an incremental datagram carries the
+// changes Sequence, Sequence + 1, ... Sequence + Count - 1, a snapshot carries the whole book as of change Sequence and
+// may be split into Parts datagrams.
+#pragma pack(push, 1)
+
+class MarketDataHeader {
+public:
+    boost::uint64_t SymbolId;
+    boost::uint64_t Sequence;
+    MarketDataMessageType Type;
+    boost::uint16_t Part;
+    boost::uint16_t Parts;
+    boost::uint16_t Count;
+};
+
+class MarketDataLevel {
+public:
+    UpdateType Update;
+    LevelType Type;
+    boost::uint64_t Price;
+    boost::uint64_t Volume;
+    boost::uint32_t Orders;
+};
+
+#pragma pack(pop)
+
+constexpr size_t MaxMarketDataDatagramSize = 1472;
+constexpr size_t MaxMarketDataLevels = (MaxMarketDataDatagramSize - sizeof(MarketDataHeader)) / sizeof(MarketDataLevel);
+
+class L2Level {
+public:
+    boost::uint64_t Volume;
+    boost::uint32_t Orders;
+};
+
+// Aggregated price levels of one symbol as seen by the feed, with visible volume only
+class L2Book {
+public:
+    typedef boost::container::flat_map<boost::uint64_t, L2Level> Levels;
+
+    [[nodiscard]] const Levels &bids() const noexcept { return bids_; }
+
+    [[nodiscard]] const Levels &asks() const noexcept { return asks_; }
+
+    [[nodiscard]] bool empty() const noexcept { return bids_.empty() && asks_.empty(); }
+
+    void Apply(const MarketDataLevel &level) {
+        Levels &levels = (level.Type == LevelType::BID) ? bids_ : asks_;
+        if (level.Update == UpdateType::DELETE)
+            levels.erase(level.Price);
+        else
+            levels[level.Price] = L2Level{level.Volume, level.Orders};
+    }
+
+    void clear() noexcept {
+        bids_.clear();
+        asks_.clear();
+    }
+
+private:
+    Levels bids_;
+    Levels asks_;
+};
+
+class MarketDataSink {
+public:
+    virtual ~MarketDataSink() = default;
+
+    virtual void Send(const boost::uint8_t *data, size_t size) = 0;
+};
+
+// Sends every datagram to one UDP endpoint. For a multicast group the datagrams stay on the host unless hops is raised.
+class UdpMarketDataSink : public MarketDataSink {
+public:
+    UdpMarketDataSink(boost::asio::io_context &io_context, const boost::asio::ip::udp::endpoint &endpoint,
+                      int hops = 0);
+
+    void Send(const boost::uint8_t *data, size_t size) override;
+
+private:
+    boost::asio::ip::udp::socket socket_;
+    boost::asio::ip::udp::endpoint endpoint_;
+};
+
+// Turns the level updates of an execution event ring into the L2 feed. It keeps its own copy of every book, so
+// snapshots for late joiners are built on the publisher thread without touching the engine.
+class MarketDataPublisher {
+public:
+    MarketDataPublisher(ExecutionEventRing &ring, MarketDataSink &sink,
+                        std::chrono::milliseconds snapshot_interval = std::chrono::milliseconds(1000));
+
+    MarketDataPublisher(const MarketDataPublisher &) = delete;
+
+    MarketDataPublisher(MarketDataPublisher &&) = delete;
+
+    ~MarketDataPublisher() = default;
+
+    MarketDataPublisher &operator=(const MarketDataPublisher &) = delete;
+
+    MarketDataPublisher &operator=(MarketDataPublisher &&) = delete;
+
+    [[nodiscard]] const L2Book *GetBook(boost::uint64_t symbol_id) const noexcept {
+        return (symbol_id < symbols_.size()) ? &symbols_[symbol_id].Book : nullptr;
+    }
+
+    // Publishes the level updates waiting in the ring and the snapshots that are due, returns the number of events
+    // taken from the ring
+    size_t Poll();
+
+    void PublishSnapshots();
+
+    void Run(const std::atomic<bool> &running);
+
+private:
+    class SymbolState {
+    public:
+        L2Book Book;
+        boost::uint64_t Sequence = 0;
+    };
+
+    ExecutionEventRing &ring_;
+    MarketDataSink &sink_;
+    std::chrono::milliseconds snapshot_interval_;
+    std::chrono::steady_clock::time_point next_snapshot_;
+
+    boost::container::vector<SymbolState> symbols_;
+
+    std::array<boost::uint8_t, MaxMarketDataDatagramSize> datagram_;
+    MarketDataHeader header_;
+
+    void OnLevelUpdate(const LevelEvent &event);
+
+    void Append(const MarketDataLevel &level);
+
+    void Flush();
+};
+
+// Rebuilds the books from the feed. A symbol is in sync once a complete snapshot has arrived; a gap in its sequence
+// numbers drops it out of sync until the next snapshot.
+class MarketDataReceiver {
+public:
+    [[nodiscard]] const L2Book *GetBook(boost::uint64_t symbol_id) const noexcept {
+        return ((symbol_id < symbols_.size()) && symbols_[symbol_id].Synced) ? &symbols_[symbol_id].Book : nullptr;
+    }
+
+    [[nodiscard]] size_t gaps() const noexcept { return gaps_; }
+
+    // Returns false for a malformed datagram
+    bool OnDatagram(const boost::uint8_t *data, size_t size);
+
+private:
+    class SymbolState {
+    public:
+        L2Book Book;
+        bool Synced = false;
+        boost::uint64_t NextSequence = 0;
+
+        L2Book Snapshot;
+        boost::uint64_t SnapshotSequence = 0;
+        boost::uint16_t NextPart = 0;
+    };
+
+    boost::container::vector<SymbolState> symbols_;
+    size_t gaps_ = 0;
+
+    void OnIncremental(SymbolState &state, const MarketDataHeader &header, const boost::uint8_t *levels);
+
+    void OnSnapshot(SymbolState &state, const MarketDataHeader &header, const boost::uint8_t *levels);
+};
@@ -1,14 +1,21 @@
+#include <algorithm>
+
+#include "journal.hpp"
 #include "market_manager.hpp"
 
 MarketManager::~MarketManager() {
-    for (auto &order: orders_)
-        delete order.second;
-    orders_.clear();
-
+    // Order books go first so that their levels unlink the resting orders before the orders are released
     for (auto &order_book_ptr: order_books_)
         delete order_book_ptr;
     order_books_.clear();
 
+    for (auto &user_orders_ptr: user_orders_)
+        delete user_orders_ptr;
+    user_orders_.clear();
+
+    orders_.ForEach([this](OrderNode *order_ptr) { order_pool_.Release(order_ptr); });
+    orders_.clear();
+
     for (auto &symbol_ptr: symbols_)
         delete symbol_ptr;
     symbols_.clear();
@@ -26,6 +33,9 @@ ErrorCode MarketManager::AddSymbol(const Symbol &symbol) {
     }
     symbols_[symbol.Id] = symbol_ptr;
 
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->AddSymbol(symbol);
+
     return ErrorCode::OK;
 }
 
@@ -39,10 +49,13 @@ ErrorCode MarketManager::DeleteSymbol(boost::uint64_t id) {
 
     delete symbol_ptr;
 
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->DeleteSymbol(id);
+
     return ErrorCode::OK;
 }
 
-ErrorCode MarketManager::AddOrderBook(const Symbol &symbol) {
+ErrorCode MarketManager::AddOrderBook(const Symbol &symbol, const OrderBookOptions &options) {
     if ((symbols_.size() <= symbol.Id) || (symbols_[symbol.Id] == nullptr))
         return ErrorCode::SYMBOL_NOT_FOUND;
 
@@ -51,7 +64,7 @@ ErrorCode MarketManager::AddOrderBook(const Symbol &symbol) {
     if (order_books_.size() <= symbol.Id)
         order_books_.resize(symbol.Id + 1, nullptr);
 
-    auto *order_book_ptr = new OrderBook(*symbol_ptr);
+    auto *order_book_ptr = new OrderBook(*symbol_ptr, level_pool_, options);
 
     if (order_books_[symbol.Id] != nullptr) {
         delete order_book_ptr;
@@ -59,6 +72,11 @@ ErrorCode MarketManager::AddOrderBook(const Symbol &symbol) {
     }
     order_books_[symbol.Id] = order_book_ptr;
 
+    latency_stats_.AddSymbol(symbol.Id);
+
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->AddOrderBook(symbol.Id, options);
+
     return ErrorCode::OK;
 }
 
@@ -72,6 +90,9 @@ ErrorCode MarketManager::DeleteOrderBook(boost::uint64_t id) {
 
     delete order_book_ptr;
 
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->DeleteOrderBook(id);
+
     return ErrorCode::OK;
 }
 
@@ -79,109 +100,399 @@ ErrorCode MarketManager::AddOrder(const Order &order) {
     auto *order_book_ptr = (OrderBook *) GetOrderBook(order.SymbolId);
     if (order_book_ptr == nullptr)
         return ErrorCode::ORDER_BOOK_NOT_FOUND;
+    if (GetUser(order.UserId) == nullptr)
+        return ErrorCode::USER_NOT_FOUND;
 
-    Order new_order(order);
+    LatencyTimer timer(latency_stats_, LatencyOperation::ADD_ORDER, order.SymbolId);
 
-    orders_count_++;
+    ErrorCode result = AddOrder(order_book_ptr, order);
+    if (result != ErrorCode::OK)
+        return result;
 
-    MatchLimit(order_book_ptr, &new_order);
+    Match(order_book_ptr);
 
-    if ((new_order.LeavesQuantity > 0)) {
-        auto *order_ptr = new OrderNode(new_order);
+    order_book_ptr->ResetMatchingPrice();
 
-        if (!orders_.insert(std::make_pair(order_ptr->Id, order_ptr)).second) {
-            delete order_ptr;
+    order_book_ptr->PublishTopOfBook();
 
-            return ErrorCode::ORDER_DUPLICATE;
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->AddOrder(order);
+
+    return ErrorCode::OK;
+}
+
+size_t MarketManager::AddOrders(std::span<const Order> orders, std::span<ErrorCode> results) {
+    size_t added = 0;
+    for (size_t begin = 0; begin < orders.size(); begin += MaxBatchSize) {
+        size_t end = std::min(begin + MaxBatchSize, orders.size());
+        batch_orders_.clear();
+
+        for (size_t i = begin; i < end; ++i) {
+            const Order &order = orders[i];
+            auto *order_book_ptr = (OrderBook *) GetOrderBook(order.SymbolId);
+            if (order_book_ptr == nullptr) {
+                results[i] = ErrorCode::ORDER_BOOK_NOT_FOUND;
+                continue;
+            }
+            if (GetUser(order.UserId) == nullptr) {
+                results[i] = ErrorCode::USER_NOT_FOUND;
+                continue;
+            }
+
+            LatencyTimer timer(latency_stats_, LatencyOperation::ADD_ORDER, order.SymbolId);
+
+            results[i] = AddOrder(order_book_ptr, order);
+            if (results[i] != ErrorCode::OK)
+                continue;
+
+            if (std::find(batch_books_.begin(), batch_books_.end(), order_book_ptr) == batch_books_.end())
+                batch_books_.push_back(order_book_ptr);
+            batch_orders_.push_back(order);
         }
 
-        order_book_ptr->AddOrder(order_ptr);
+        CompleteBatch();
+
+        if ((journal_ptr_ != nullptr) && !batch_orders_.empty())
+            journal_ptr_->AddOrders(std::span(batch_orders_.data(), batch_orders_.size()));
+        added += batch_orders_.size();
     }
+    return added;
+}
+
+size_t MarketManager::DeleteOrders(std::span<const boost::uint64_t> ids, std::span<ErrorCode> results) {
+    size_t deleted = 0;
+    for (size_t begin = 0; begin < ids.size(); begin += MaxBatchSize) {
+        size_t end = std::min(begin + MaxBatchSize, ids.size());
+        batch_ids_.clear();
+
+        for (size_t i = begin; i < end; ++i) {
+            boost::uint64_t id = ids[i];
+            if (id == 0) {
+                results[i] = ErrorCode::ORDER_ID_INVALID;
+                continue;
+            }
+
+            auto *order_ptr = orders_.Find(id);
+            if (order_ptr == nullptr) {
+                results[i] = ErrorCode::ORDER_NOT_FOUND;
+                continue;
+            }
+
+            auto *order_book_ptr = (OrderBook *) GetOrderBook(order_ptr->SymbolId);
+            if (order_book_ptr == nullptr) {
+                results[i] = ErrorCode::ORDER_BOOK_NOT_FOUND;
+                continue;
+            }
+
+            LatencyTimer timer(latency_stats_, LatencyOperation::DELETE_ORDER, order_ptr->SymbolId);
+
+            Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_CANCELLED, *order_ptr, 0));
+
+            DeleteOrder(order_book_ptr, order_ptr);
+
+            results[i] = ErrorCode::OK;
+            if (std::find(batch_books_.begin(), batch_books_.end(), order_book_ptr) == batch_books_.end())
+                batch_books_.push_back(order_book_ptr);
+            batch_ids_.push_back(id);
+        }
+
+        CompleteBatch();
+
+        if ((journal_ptr_ != nullptr) && !batch_ids_.empty())
+            journal_ptr_->DeleteOrders(std::span(batch_ids_.data(), batch_ids_.size()));
+        deleted += batch_ids_.size();
+    }
+    return deleted;
+}
+
+size_t MarketManager::CancelAllOrders(boost::uint64_t user_id, boost::uint64_t symbol_id) {
+    if ((user_id >= user_orders_.size()) || (user_orders_[user_id] == nullptr))
+        return 0;
+
+    UserOrderList &user_orders = *user_orders_[user_id];
+    size_t cancelled = 0;
+    for (;;) {
+        // Completing a batch can activate stop orders of the user and fill or release them, so every batch walks the
+        // list again from its front, where only the orders skipped for another symbol or a deleted book are left
+        batch_ids_.clear();
+        for (auto it = user_orders.begin(); (it != user_orders.end()) && (batch_ids_.size() < MaxBatchSize);) {
+            OrderNode *order_ptr = &*it++;
+            if ((symbol_id != AllSymbols) && (order_ptr->SymbolId != symbol_id))
+                continue;
+
+            auto *order_book_ptr = (OrderBook *) GetOrderBook(order_ptr->SymbolId);
+            if (order_book_ptr == nullptr)
+                continue;
+
+            LatencyTimer timer(latency_stats_, LatencyOperation::DELETE_ORDER, order_ptr->SymbolId);
+
+            Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_CANCELLED, *order_ptr, 0));
+
+            batch_ids_.push_back(order_ptr->Id);
+            if (std::find(batch_books_.begin(), batch_books_.end(), order_book_ptr) == batch_books_.end())
+                batch_books_.push_back(order_book_ptr);
+
+            DeleteOrder(order_book_ptr, order_ptr);
+        }
+
+        if (batch_ids_.empty())
+            return cancelled;
+
+        CompleteBatch();
+
+        if (journal_ptr_ != nullptr)
+            journal_ptr_->DeleteOrders(std::span(batch_ids_.data(), batch_ids_.size()));
+        cancelled += batch_ids_.size();
+    }
+}
+
+ErrorCode MarketManager::DeleteOrder(boost::uint64_t id) {
+    if (id == 0)
+        return ErrorCode::ORDER_ID_INVALID;
+
+    auto *order_ptr = orders_.Find(id);
+    if (order_ptr == nullptr)
+        return ErrorCode::ORDER_NOT_FOUND;
+
+    auto *order_book_ptr = (OrderBook *) GetOrderBook(order_ptr->SymbolId);
+    if (order_book_ptr == nullptr)
+        return ErrorCode::ORDER_BOOK_NOT_FOUND;
+
+    LatencyTimer timer(latency_stats_, LatencyOperation::DELETE_ORDER, order_ptr->SymbolId);
+
+    Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_CANCELLED, *order_ptr, 0));
+
+    DeleteOrder(order_book_ptr, order_ptr);
 
     Match(order_book_ptr);
 
     order_book_ptr->ResetMatchingPrice();
 
+    order_book_ptr->PublishTopOfBook();
+
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->DeleteOrder(id);
+
     return ErrorCode::OK;
 }
 
-ErrorCode MarketManager::ReduceOrder(boost::uint64_t id, boost::uint64_t quantity, bool recursive) {
+ErrorCode MarketManager::DeleteOrder(boost::uint64_t id, boost::uint64_t user_id) {
+    const Order *order_ptr = GetOrder(id);
+    if ((order_ptr == nullptr) || (order_ptr->UserId != user_id))
+        return ErrorCode::ORDER_NOT_FOUND;
+
+    return DeleteOrder(id);
+}
+
+ErrorCode MarketManager::ModifyOrder(boost::uint64_t id, boost::uint64_t new_price, boost::uint64_t new_quantity) {
     if (id == 0)
         return ErrorCode::ORDER_ID_INVALID;
 
-    if (quantity == 0)
+    if (new_quantity == 0)
         return ErrorCode::ORDER_QUANTITY_INVALID;
 
-    auto order_it = orders_.find(id);
-
-    if (order_it == orders_.end())
+    auto *order_ptr = orders_.Find(id);
+    if (order_ptr == nullptr)
         return ErrorCode::ORDER_NOT_FOUND;
-    auto *order_ptr = (OrderNode *) order_it->second;
 
     auto *order_book_ptr = (OrderBook *) GetOrderBook(order_ptr->SymbolId);
     if (order_book_ptr == nullptr)
         return ErrorCode::ORDER_BOOK_NOT_FOUND;
 
-    quantity = std::min(quantity, order_ptr->LeavesQuantity);
+    LatencyTimer timer(latency_stats_, LatencyOperation::MODIFY_ORDER, order_ptr->SymbolId);
 
-    boost::uint64_t hidden = order_ptr->HiddenQuantity();
-    boost::uint64_t visible = order_ptr->VisibleQuantity();
+    Order modified_order(*order_ptr);
+    modified_order.Price = new_price;
+    modified_order.Quantity = order_ptr->ExecutedQuantity + new_quantity;
+    Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_MODIFIED, modified_order, new_quantity));
 
-    order_ptr->LeavesQuantity -= quantity;
+    order_ptr->Quantity = modified_order.Quantity;
 
-    hidden -= order_ptr->HiddenQuantity();
-    visible -= order_ptr->VisibleQuantity();
+    if (!order_ptr->IsLimit()) {
+        order_ptr->Price = new_price;
+
+        if (new_quantity <= order_ptr->LeavesQuantity) {
+            order_book_ptr->ResizeOrder(order_ptr, new_quantity);
+        } else if (order_ptr->IsTrailingStopLimit()) {
+            order_book_ptr->DeleteTrailingStopOrder(order_ptr);
+            order_ptr->LeavesQuantity = new_quantity;
+            order_book_ptr->AddTrailingStopOrder(order_ptr);
+        } else {
+            order_book_ptr->DeleteStopOrder(order_ptr);
+            order_ptr->LeavesQuantity = new_quantity;
+            order_book_ptr->AddStopOrder(order_ptr);
+        }
+    } else if ((new_price == order_ptr->Price) && (new_quantity <= order_ptr->LeavesQuantity)) {
+        PublishLevel(order_book_ptr, order_book_ptr->ResizeOrder(order_ptr, new_quantity));
 
-    if (order_ptr->LeavesQuantity > 0) {
-        order_book_ptr->ReduceOrder(order_ptr, quantity, hidden, visible);
+        order_book_ptr->PublishTopOfBook();
     } else {
-        order_book_ptr->ReduceOrder(order_ptr, quantity, hidden, visible);
+        // The order node is unlinked and matched as if it just arrived, then queued at its new level
+        PublishLevel(order_book_ptr, order_book_ptr->DeleteOrder(order_ptr));
 
-        orders_.erase(order_it);
+        order_ptr->Price = new_price;
+        order_ptr->LeavesQuantity = new_quantity;
 
-        delete order_ptr;
-    }
+        MatchLimit(order_book_ptr, order_ptr);
+
+        if (order_ptr->LeavesQuantity > 0) {
+            PublishLevel(order_book_ptr, order_book_ptr->AddOrder(order_ptr));
+        } else {
+            ReleaseOrder(order_ptr);
+        }
 
-    if (!recursive)
         Match(order_book_ptr);
 
-    order_book_ptr->ResetMatchingPrice();
+        order_book_ptr->ResetMatchingPrice();
+
+        order_book_ptr->PublishTopOfBook();
+    }
+
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->ModifyOrder(id, new_price, new_quantity);
 
     return ErrorCode::OK;
 }
 
-ErrorCode MarketManager::DeleteOrder(boost::uint64_t id) {
-    return DeleteOrder(id, false);
+ErrorCode MarketManager::ModifyOrder(boost::uint64_t id, boost::uint64_t user_id, boost::uint64_t new_price,
+                                     boost::uint64_t new_quantity) {
+    const Order *order_ptr = GetOrder(id);
+    if ((order_ptr == nullptr) || (order_ptr->UserId != user_id))
+        return ErrorCode::ORDER_NOT_FOUND;
+
+    return ModifyOrder(id, new_price, new_quantity);
 }
 
-ErrorCode MarketManager::DeleteOrder(boost::uint64_t id, bool recursive) {
-    if (id == 0)
-        return ErrorCode::ORDER_ID_INVALID;
+ErrorCode MarketManager::AddOrder(OrderBook *order_book_ptr, const Order &order) {
+    if (orders_.Find(order.Id) != nullptr)
+        return ErrorCode::ORDER_DUPLICATE;
 
-    auto order_it = orders_.find(id);
+    Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_ACCEPTED, order, order.LeavesQuantity));
 
-    if (order_it == orders_.end())
-        return ErrorCode::ORDER_NOT_FOUND;
-    auto *order_ptr = (OrderNode *) order_it->second;
+    return order.IsLimit() ? AddLimitOrder(order_book_ptr, order) : AddStopOrder(order_book_ptr, order);
+}
 
-    auto *order_book_ptr = (OrderBook *) GetOrderBook(order_ptr->SymbolId);
-    if (order_book_ptr == nullptr)
-        return ErrorCode::ORDER_BOOK_NOT_FOUND;
+bool MarketManager::InsertOrder(OrderNode *order_ptr) {
+    if (!orders_.Insert(order_ptr))
+        return false;
 
-    order_book_ptr->DeleteOrder(order_ptr);
+    if (user_orders_.size() <= order_ptr->UserId)
+        user_orders_.resize(order_ptr->UserId + 1, nullptr);
+    if (user_orders_[order_ptr->UserId] == nullptr)
+        user_orders_[order_ptr->UserId] = new UserOrderList();
+    user_orders_[order_ptr->UserId]->push_back(*order_ptr);
 
-    orders_.erase(order_it);
+    return true;
+}
 
-    delete order_ptr;
+void MarketManager::ReleaseOrder(OrderNode *order_ptr) {
+    UserOrderList &user_orders = *user_orders_[order_ptr->UserId];
+    user_orders.erase(user_orders.iterator_to(*order_ptr));
 
-    if (!recursive)
-        Match(order_book_ptr);
+    orders_.Erase(order_ptr->Id);
 
-    order_book_ptr->ResetMatchingPrice();
+    order_pool_.Release(order_ptr);
+}
+
+ErrorCode MarketManager::AddLimitOrder(OrderBook *order_book_ptr, const Order &order) {
+    Order new_order(order);
+
+    orders_count_++;
+
+    MatchLimit(order_book_ptr, &new_order);
+
+    if ((new_order.LeavesQuantity > 0)) {
+        auto *order_ptr = order_pool_.Create(new_order);
+
+        if (!InsertOrder(order_ptr)) {
+            order_pool_.Release(order_ptr);
+
+            return ErrorCode::ORDER_DUPLICATE;
+        }
+
+        PublishLevel(order_book_ptr, order_book_ptr->AddOrder(order_ptr));
+    }
 
     return ErrorCode::OK;
 }
 
+ErrorCode MarketManager::AddStopOrder(OrderBook *order_book_ptr, const Order &order) {
+    Order new_order(order);
+
+    if (new_order.IsTrailingStopLimit())
+        new_order.StopPrice = order_book_ptr->CalculateTrailingStopPrice(new_order);
+
+    // A stop order that is already triggered by the current market goes straight to the limit order book
+    bool arbitrage = new_order.IsBuy() ? (new_order.StopPrice <= order_book_ptr->GetMarketPriceAsk())
+                                       : (new_order.StopPrice >= order_book_ptr->GetMarketPriceBid());
+    if (arbitrage) {
+        new_order.Type = OrderType::LIMIT;
+        new_order.StopPrice = 0;
+
+        return AddLimitOrder(order_book_ptr, new_order);
+    }
+
+    orders_count_++;
+
+    auto *order_ptr = order_pool_.Create(new_order);
+
+    if (!InsertOrder(order_ptr)) {
+        order_pool_.Release(order_ptr);
+
+        return ErrorCode::ORDER_DUPLICATE;
+    }
+
+    if (order_ptr->IsTrailingStopLimit())
+        order_book_ptr->AddTrailingStopOrder(order_ptr);
+    else
+        order_book_ptr->AddStopOrder(order_ptr);
+
+    return ErrorCode::OK;
+}
+
+void MarketManager::ReduceOrder(OrderBook *order_book_ptr, OrderNode *order_ptr, boost::uint64_t quantity) {
+    boost::uint64_t hidden = order_ptr->HiddenQuantity();
+    boost::uint64_t visible = order_ptr->VisibleQuantity();
+
+    order_ptr->LeavesQuantity -= quantity;
+
+    hidden -= order_ptr->HiddenQuantity();
+    visible -= order_ptr->VisibleQuantity();
+
+    Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_REDUCED, *order_ptr, order_ptr->LeavesQuantity));
+
+    PublishLevel(order_book_ptr, order_book_ptr->ReduceOrder(order_ptr, quantity, hidden, visible));
+
+    if (order_ptr->LeavesQuantity == 0) {
+        ReleaseOrder(order_ptr);
+    }
+}
+
+void MarketManager::DeleteOrder(OrderBook *order_book_ptr, OrderNode *order_ptr) {
+    switch (order_ptr->Type) {
+        case OrderType::LIMIT:
+            PublishLevel(order_book_ptr, order_book_ptr->DeleteOrder(order_ptr));
+            break;
+        case OrderType::STOP_LIMIT:
+            order_book_ptr->DeleteStopOrder(order_ptr);
+            break;
+        case OrderType::TRAILING_STOP_LIMIT:
+            order_book_ptr->DeleteTrailingStopOrder(order_ptr);
+            break;
+    }
+
+    ReleaseOrder(order_ptr);
+}
+
+void MarketManager::Subscribe(ExecutionEventRing &ring) {
+    if (std::find(event_rings_.begin(), event_rings_.end(), &ring) == event_rings_.end())
+        event_rings_.push_back(&ring);
+}
+
+void MarketManager::Unsubscribe(ExecutionEventRing &ring) {
+    event_rings_.erase(std::remove(event_rings_.begin(), event_rings_.end(), &ring), event_rings_.end());
+}
+
 ErrorCode MarketManager::AddUser(const User &user) {
     if (users_.size() <= user.Id)
         users_.resize(user.Id + 1, nullptr);
@@ -194,6 +505,9 @@ ErrorCode MarketManager::AddUser(const User &user) {
     }
     users_[user.Id] = user_ptr;
 
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->AddUser(user);
+
     return ErrorCode::OK;
 }
 
@@ -207,10 +521,15 @@ ErrorCode MarketManager::DeleteUser(boost::uint64_t id) {
 
     delete user_ptr;
 
+    if (journal_ptr_ != nullptr)
+        journal_ptr_->DeleteUser(id);
+
     return ErrorCode::OK;
 }
 
 void MarketManager::Match(OrderBook *order_book_ptr) {
+    LatencyTimer timer(latency_stats_, LatencyOperation::MATCH, order_book_ptr->symbol().Id);
+
     for (;;) {
         while ((order_book_ptr->best_bid_ != nullptr) &&
                (order_book_ptr->best_ask_ != nullptr) &&
@@ -243,7 +562,12 @@ void MarketManager::Match(OrderBook *order_book_ptr) {
                 else
                     users_[executing_order_ptr->UserId]->Balance += quantity * price;
 
-                DeleteOrder(executing_order_ptr->Id, true);
+                // The executing order sets the price, so it is reported as the maker of the trade
+                Publish(ExecutionEvent::MakeTrade(*executing_order_ptr, *reducing_order_ptr, price, quantity));
+                Publish(ExecutionEvent::MakeOrder(ExecutionEventType::ORDER_REDUCED, *executing_order_ptr, 0));
+
+                DeleteOrder(order_book_ptr, executing_order_ptr);
+                order_book_ptr->ResetMatchingPrice();
 
                 order_book_ptr->UpdateLastPrice(*reducing_order_ptr, price);
                 order_book_ptr->UpdateMatchingPrice(*reducing_order_ptr, price);
@@ -254,16 +578,12 @@ void MarketManager::Match(OrderBook *order_book_ptr) {
                 else
                     users_[reducing_order_ptr->UserId]->Balance += quantity * price;
 
-                ReduceOrder(reducing_order_ptr->Id, quantity, true);
+                ReduceOrder(order_book_ptr, reducing_order_ptr, quantity);
+                order_book_ptr->ResetMatchingPrice();
 
                 bid_order_ptr = next_bid_order_ptr;
                 ask_order_ptr = next_ask_order_ptr;
             }
-
-            ActivateStopOrders(order_book_ptr, (LevelNode *) order_book_ptr->best_buy_stop(),
-                               order_book_ptr->GetMarketPriceAsk());
-            ActivateStopOrders(order_book_ptr, (LevelNode *) order_book_ptr->best_sell_stop(),
-                               order_book_ptr->GetMarketPriceBid());
         }
 
         if (!ActivateStopOrders(order_book_ptr))
@@ -271,6 +591,17 @@ void MarketManager::Match(OrderBook *order_book_ptr) {
     }
 }
 
+void MarketManager::CompleteBatch() {
+    for (auto *order_book_ptr: batch_books_) {
+        Match(order_book_ptr);
+
+        order_book_ptr->ResetMatchingPrice();
+
+        order_book_ptr->PublishTopOfBook();
+    }
+    batch_books_.clear();
+}
+
 void MarketManager::MatchLimit(OrderBook *order_book_ptr, Order *order_ptr) {
     MatchOrder(order_book_ptr, order_ptr);
 }
@@ -301,7 +632,10 @@ void MarketManager::MatchOrder(OrderBook *order_book_ptr, Order *order_ptr) {
             else
                 users_[executing_order_ptr->UserId]->Balance += quantity * price;
 
-            ReduceOrder(executing_order_ptr->Id, quantity, true);
+            Publish(ExecutionEvent::MakeTrade(*executing_order_ptr, *order_ptr, price, quantity));
+
+            ReduceOrder(order_book_ptr, executing_order_ptr, quantity);
+            order_book_ptr->ResetMatchingPrice();
 
             order_book_ptr->UpdateLastPrice(*order_ptr, price);
             order_book_ptr->UpdateMatchingPrice(*order_ptr, price);
@@ -322,71 +656,70 @@ void MarketManager::MatchOrder(OrderBook *order_book_ptr, Order *order_ptr) {
 }
 
 bool MarketManager::ActivateStopOrders(OrderBook *order_book_ptr) {
-    bool result = false;
-    bool stop = false;
+    LatencyTimer timer(latency_stats_, LatencyOperation::ACTIVATE_STOP_ORDERS, order_book_ptr->symbol().Id);
 
-    while (!stop) {
-        stop = true;
-
-        if (ActivateStopOrders(order_book_ptr, (LevelNode *) order_book_ptr->best_buy_stop(),
-                               order_book_ptr->GetMarketPriceAsk()) ||
-            ActivateStopOrders(order_book_ptr, (LevelNode *) order_book_ptr->best_trailing_buy_stop(),
-                               order_book_ptr->GetMarketPriceAsk())) {
-            result = true;
-            stop = false;
+    bool result = false;
+    bool activated = true;
+
+    // The sides take turns and every turn activates at most one order, so that each activation sees the market and the
+    // trailing stop prices left by the previous one. A round of turns without activations means the market has settled.
+    while (activated) {
+        activated = false;
+
+        OrderNode *order_ptr = GetTriggeredStopOrder(order_book_ptr->best_buy_stop_,
+                                                     order_book_ptr->best_trailing_buy_stop_,
+                                                     order_book_ptr->GetMarketPriceAsk());
+        if (order_ptr != nullptr) {
+            ActivateStopOrder(order_book_ptr, order_ptr);
+            activated = true;
         }
 
         RecalculateTrailingStopPrice(order_book_ptr, order_book_ptr->best_ask_);
 
-        if (ActivateStopOrders(order_book_ptr, (LevelNode *) order_book_ptr->best_sell_stop(),
-                               order_book_ptr->GetMarketPriceBid()) ||
-            ActivateStopOrders(order_book_ptr, (LevelNode *) order_book_ptr->best_trailing_sell_stop(),
-                               order_book_ptr->GetMarketPriceBid())) {
-            result = true;
-            stop = false;
+        order_ptr = GetTriggeredStopOrder(order_book_ptr->best_sell_stop_, order_book_ptr->best_trailing_sell_stop_,
+                                          order_book_ptr->GetMarketPriceBid());
+        if (order_ptr != nullptr) {
+            ActivateStopOrder(order_book_ptr, order_ptr);
+            activated = true;
         }
 
         RecalculateTrailingStopPrice(order_book_ptr, order_book_ptr->best_bid_);
+
+        result = result || activated;
     }
 
     return result;
 }
 
-bool MarketManager::ActivateStopOrders(OrderBook *order_book_ptr, LevelNode *level_ptr, boost::uint64_t stop_price) {
-    bool result = false;
+OrderNode *MarketManager::GetTriggeredStopOrder(LevelNode *stop_level_ptr, LevelNode *trailing_stop_level_ptr,
+                                                boost::uint64_t stop_price) {
+    for (LevelNode *level_ptr: {stop_level_ptr, trailing_stop_level_ptr}) {
+        if (level_ptr == nullptr)
+            continue;
 
-    if (level_ptr != nullptr) {
         bool arbitrage = level_ptr->IsBid() ? (stop_price <= level_ptr->Price) : (stop_price >= level_ptr->Price);
-        if (!arbitrage)
-            return result;
-
-        OrderNode *activating_order_ptr = &level_ptr->OrderList.front();
-
-        while (activating_order_ptr != nullptr) {
-            auto *next_activating_order_ptr = static_cast<OrderNode *>(activating_order_ptr->next_);
-
-            result = ActivateStopOrder(order_book_ptr, activating_order_ptr);
-
-            activating_order_ptr = next_activating_order_ptr;
-        }
+        if (arbitrage)
+            return &level_ptr->OrderList.front();
     }
 
-    return result;
+    return nullptr;
 }
 
 bool MarketManager::ActivateStopOrder(OrderBook *order_book_ptr, OrderNode *order_ptr) {
-    order_book_ptr->DeleteStopOrder(order_ptr);
+    if (order_ptr->IsTrailingStopLimit())
+        order_book_ptr->DeleteTrailingStopOrder(order_ptr);
+    else
+        order_book_ptr->DeleteStopOrder(order_ptr);
 
+    order_ptr->Type = OrderType::LIMIT;
     order_ptr->StopPrice = 0;
 
     MatchLimit(order_book_ptr, order_ptr);
 
     if ((order_ptr->LeavesQuantity > 0)) {
-        order_book_ptr->AddOrder(order_ptr);
+        PublishLevel(order_book_ptr, order_book_ptr->AddOrder(order_ptr));
     } else {
-        orders_.erase(orders_.find(order_ptr->Id));
-
-        delete order_ptr;
+        ReleaseOrder(order_ptr);
     }
 
     return true;
@@ -413,38 +746,46 @@ void MarketManager::RecalculateTrailingStopPrice(OrderBook *order_book_ptr, Leve
             return;
     }
 
-    LevelNode *previous = nullptr;
-    LevelNode *current = (level_ptr->Type == LevelType::ASK) ? order_book_ptr->best_trailing_buy_stop_
-                                                             : order_book_ptr->best_trailing_sell_stop_;
-    while (current != nullptr) {
-        bool recalculated = false;
-
-        OrderNode *order_ptr = &current->OrderList.front();
-
-        while (order_ptr != nullptr) {
-            auto *next_order_ptr = static_cast<OrderNode *>(order_ptr->next_);
-
-            boost::uint64_t old_stop_price = order_ptr->StopPrice;
-            boost::uint64_t new_stop_price = order_book_ptr->CalculateTrailingStopPrice(*order_ptr);
-
-            if (new_stop_price != old_stop_price) {
-                order_book_ptr->DeleteTrailingStopOrder(order_ptr);
+    // Only the orders whose trailing key has been crossed by the new market price can move. They are repriced best
+    // level first and in queue order within a level, as a full scan of the levels would, so that they keep their
+    // relative priority.
+    trailing_orders_.clear();
+
+    if (level_ptr->IsAsk()) {
+        TrailingStopIndex &index = order_book_ptr->trailing_buy_index_;
+        for (auto it = index.lower_bound(new_trailing_price, TrailingKeyCompare()); it != index.end(); ++it)
+            trailing_orders_.push_back(&*it);
+
+        std::sort(trailing_orders_.begin(), trailing_orders_.end(),
+                  [](const OrderNode *order1_ptr, const OrderNode *order2_ptr) {
+                      return (order1_ptr->StopPrice != order2_ptr->StopPrice)
+                             ? (order1_ptr->StopPrice < order2_ptr->StopPrice)
+                             : (order1_ptr->TrailingSequence < order2_ptr->TrailingSequence);
+                  });
+    } else {
+        TrailingStopIndex &index = order_book_ptr->trailing_sell_index_;
+        auto end = index.upper_bound(new_trailing_price, TrailingKeyCompare());
+        for (auto it = index.begin(); it != end; ++it)
+            trailing_orders_.push_back(&*it);
+
+        std::sort(trailing_orders_.begin(), trailing_orders_.end(),
+                  [](const OrderNode *order1_ptr, const OrderNode *order2_ptr) {
+                      return (order1_ptr->StopPrice != order2_ptr->StopPrice)
+                             ? (order1_ptr->StopPrice > order2_ptr->StopPrice)
+                             : (order1_ptr->TrailingSequence < order2_ptr->TrailingSequence);
+                  });
+    }
 
-                order_book_ptr->AddTrailingStopOrder(order_ptr);
+    for (auto &order_ptr: trailing_orders_) {
+        boost::uint64_t old_stop_price = order_ptr->StopPrice;
+        boost::uint64_t new_stop_price = OrderBook::CalculateTrailingStopPrice(*order_ptr, new_trailing_price);
 
-                recalculated = true;
-            }
+        if (new_stop_price != old_stop_price) {
+            order_book_ptr->DeleteTrailingStopOrder(order_ptr);
 
-            order_ptr = next_order_ptr;
-        }
+            order_ptr->StopPrice = new_stop_price;
 
-        if (recalculated) {
-            current = (previous != nullptr) ? previous : ((level_ptr->Type == LevelType::ASK)
-                                                          ? order_book_ptr->best_trailing_buy_stop_
-                                                          : order_book_ptr->best_trailing_sell_stop_);
-        } else {
-            previous = current;
-            current = order_book_ptr->GetNextTrailingStopLevel(current);
+            order_book_ptr->AddTrailingStopOrder(order_ptr);
         }
     }
 }
@@ -1,24 +1,36 @@
 #pragma once
 
+#include <limits>
+#include <span>
+
 #include <boost/container/vector.hpp>
-#include <boost/unordered_map.hpp>
 
+#include "execution_event.hpp"
+#include "latency_stats.hpp"
 #include "level.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
+#include "order_table.hpp"
 #include "symbol.hpp"
 #include "user.hpp"
 
+class Journal;
+
 class MarketManager {
     friend class OrderBook;
+    friend class Snapshot;
 
 public:
     typedef boost::container::vector<Symbol *> Symbols;
     typedef boost::container::vector<OrderBook *> OrderBooks;
-    typedef boost::unordered_map<boost::uint64_t, OrderNode *> Orders;
+    typedef OrderTable Orders;
     typedef boost::container::vector<User *> Users;
 
-    MarketManager() : orders_count_(1) {
+    static constexpr size_t MaxBatchSize = 1024;
+    static constexpr boost::uint64_t AllSymbols = std::numeric_limits<boost::uint64_t>::max();
+
+    explicit MarketManager(OrderTablePolicy order_table_policy = OrderTablePolicy::PAGED) : orders_(
+            order_table_policy), orders_count_(1), event_sequence_(0), journal_ptr_(nullptr) {
 
     }
 
@@ -40,6 +52,13 @@ public:
 
     [[nodiscard]] const Users &users() const noexcept { return users_; }
 
+    // Hot path latencies recorded from the thread driving the manager, empty when built without LATENCY_STATS
+    [[nodiscard]] const LatencyStats &latency_stats() const noexcept { return latency_stats_; }
+
+    [[nodiscard]] PoolStats order_pool_stats() const noexcept { return order_pool_.stats(); }
+
+    [[nodiscard]] PoolStats level_pool_stats() const noexcept { return level_pool_.stats(); }
+
     [[nodiscard]] const Symbol *GetSymbol(boost::uint64_t id) const noexcept {
         return ((id < symbols_.size()) ? symbols_[id] : nullptr);
     }
@@ -48,18 +67,29 @@ public:
         return ((id < order_books_.size()) ? order_books_[id] : nullptr);
     }
 
+    // The record stays valid until the order book is deleted, so readers on other threads can look it up once and
+    // keep polling it
+    [[nodiscard]] const TopOfBookSeqLock *GetTopOfBook(boost::uint64_t id) const noexcept {
+        const OrderBook *order_book_ptr = GetOrderBook(id);
+        return (order_book_ptr != nullptr) ? &order_book_ptr->top_of_book() : nullptr;
+    }
+
     [[nodiscard]] const Order *GetOrder(boost::uint64_t id) const noexcept {
         if (id == 0)
             return nullptr;
 
-        auto it = orders_.find(id);
-        return ((it != orders_.end()) ? it->second : nullptr);
+        return orders_.Find(id);
     }
 
     [[nodiscard]] const User *GetUser(boost::uint64_t id) const noexcept {
         return ((id < users_.size()) ? users_[id] : nullptr);
     }
 
+    // Open orders of the user in the order they were entered, null when the user never had one
+    [[nodiscard]] const UserOrderList *GetUserOrders(boost::uint64_t user_id) const noexcept {
+        return ((user_id < user_orders_.size()) ? user_orders_[user_id] : nullptr);
+    }
+
     [[nodiscard]] boost::uint64_t GetOrdersCount() const noexcept {
         return orders_count_;
     }
@@ -68,39 +98,133 @@ public:
 
     ErrorCode DeleteSymbol(boost::uint64_t id);
 
-    ErrorCode AddOrderBook(const Symbol &symbol);
+    ErrorCode AddOrderBook(const Symbol &symbol, const OrderBookOptions &options = OrderBookOptions());
 
     ErrorCode DeleteOrderBook(boost::uint64_t id);
 
+    // Fails with USER_NOT_FOUND unless the order belongs to a registered user
     ErrorCode AddOrder(const Order &order);
 
     ErrorCode DeleteOrder(boost::uint64_t id);
 
+    // Deletes the order only when it belongs to the given user, orders of other users read as not found
+    ErrorCode DeleteOrder(boost::uint64_t id, boost::uint64_t user_id);
+
+    // Sets the limit price and the leaves quantity of a resting order, keeping its id. A smaller quantity at the same
+    // price is changed in place and keeps the time priority of the order. Any other change moves the same order node
+    // to the back of the queue of its new level, matching it first when the new price crosses the book. Stop orders
+    // are queued by their stop price, so a new limit price alone does not move them.
+    ErrorCode ModifyOrder(boost::uint64_t id, boost::uint64_t new_price, boost::uint64_t new_quantity);
+
+    // Modifies the order only when it belongs to the given user, orders of other users read as not found
+    ErrorCode ModifyOrder(boost::uint64_t id, boost::uint64_t user_id, boost::uint64_t new_price,
+                          boost::uint64_t new_quantity);
+
+    // Cancels every open order of the user, or only those on the given symbol, and returns how many were cancelled.
+    // Only the orders of the user are walked. The cancels run and are journaled as DeleteOrders batches, so every
+    // book is matched once per batch rather than once per order.
+    size_t CancelAllOrders(boost::uint64_t user_id, boost::uint64_t symbol_id = AllSymbols);
+
+    // Batch forms of AddOrder and DeleteOrder, writing the error code of every order to results, which must be at
+    // least as long as the batch, and returning how many succeeded. Added orders still match on arrival, but the stop
+    // activation, trailing stop repricing and top of book publication of every book the batch touches run once after
+    // its last order, so a stop triggered by one order of the batch activates after the rest of the batch is in.
+    // Batches longer than MaxBatchSize are processed in chunks of that size.
+    size_t AddOrders(std::span<const Order> orders, std::span<ErrorCode> results);
+
+    size_t DeleteOrders(std::span<const boost::uint64_t> ids, std::span<ErrorCode> results);
+
     ErrorCode AddUser(const User &user);
 
     ErrorCode DeleteUser(boost::uint64_t id);
 
+    // Every subscribed ring receives every event published from here on. Rings are filled from the thread that
+    // drives the manager, so subscriptions must not change while it is processing orders. A full ring stalls matching
+    // until its consumer catches up.
+    void Subscribe(ExecutionEventRing &ring);
+
+    void Unsubscribe(ExecutionEventRing &ring);
+
+    // Every command accepted from here on is appended to the journal, failed commands are not. Replay the journal
+    // before attaching it, replayed commands would be journaled again otherwise.
+    void AttachJournal(Journal &journal) noexcept { journal_ptr_ = &journal; }
+
+    void DetachJournal() noexcept { journal_ptr_ = nullptr; }
+
 private:
+    OrderNodePool order_pool_;
+    LevelNodePool level_pool_;
+
     Symbols symbols_;
     OrderBooks order_books_;
     Orders orders_;
     Users users_;
+    boost::container::vector<UserOrderList *> user_orders_;
 
     boost::uint64_t orders_count_;
 
-    ErrorCode ReduceOrder(boost::uint64_t id, boost::uint64_t quantity, bool recursive);
+    boost::container::vector<ExecutionEventRing *> event_rings_;
+    boost::uint64_t event_sequence_;
+
+    Journal *journal_ptr_;
+
+    LatencyStats latency_stats_;
+
+    // Scratch buffer for the trailing stops that move on a market price change, kept to avoid reallocations
+    boost::container::vector<OrderNode *> trailing_orders_;
+
+    // Scratch buffers for the books a batch touched and its accepted commands, which are journaled together
+    boost::container::vector<OrderBook *> batch_books_;
+    boost::container::vector<Order> batch_orders_;
+    boost::container::vector<boost::uint64_t> batch_ids_;
+
+    void Publish(ExecutionEvent event) noexcept {
+        if (event_rings_.empty())
+            return;
+
+        event.Sequence = ++event_sequence_;
+        for (auto &ring_ptr: event_rings_)
+            ring_ptr->Push(event);
+    }
+
+    void PublishLevel(const OrderBook *order_book_ptr, const LevelUpdate &update) noexcept {
+        if (!event_rings_.empty())
+            Publish(ExecutionEvent::MakeLevel(order_book_ptr->symbol().Id, update));
+    }
+
+    ErrorCode AddOrder(OrderBook *order_book_ptr, const Order &order);
+
+    // Adds an order to the order table and to the list of its user, false for a duplicate id
+    bool InsertOrder(OrderNode *order_ptr);
+
+    // Removes an order from the order table and from the list of its user and releases it
+    void ReleaseOrder(OrderNode *order_ptr);
 
-    ErrorCode DeleteOrder(boost::uint64_t id, bool recursive);
+    ErrorCode AddLimitOrder(OrderBook *order_book_ptr, const Order &order);
+
+    ErrorCode AddStopOrder(OrderBook *order_book_ptr, const Order &order);
+
+    // Fill and cancel primitives for callers that already hold the order and its book. They update the level and the
+    // order table only; matching and the matching price reset are left to the caller.
+    void ReduceOrder(OrderBook *order_book_ptr, OrderNode *order_ptr, boost::uint64_t quantity);
+
+    void DeleteOrder(OrderBook *order_book_ptr, OrderNode *order_ptr);
 
     void Match(OrderBook *order_book_ptr);
 
+    // Matches, resets the matching price and publishes the top of book of every book the batch touched
+    void CompleteBatch();
+
     void MatchLimit(OrderBook *order_book_ptr, Order *order_ptr);
 
     void MatchOrder(OrderBook *order_book_ptr, Order *order_ptr);
 
     bool ActivateStopOrders(OrderBook *order_book_ptr);
 
-    bool ActivateStopOrders(OrderBook *order_book_ptr, LevelNode *level_ptr, boost::uint64_t stop_price);
+    // Front of the best plain stop level when it is triggered by the given market price, otherwise the front of the
+    // best trailing stop level when that one is
+    static OrderNode *GetTriggeredStopOrder(LevelNode *stop_level_ptr, LevelNode *trailing_stop_level_ptr,
+                                            boost::uint64_t stop_price);
 
     bool ActivateStopOrder(OrderBook *order_book_ptr, OrderNode *order_ptr);
 
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include <boost/container/vector.hpp>
+
+class PoolStats {
+public:
+    size_t Capacity;
+    size_t Used;
+    size_t HighWaterMark;
+    size_t Chunks;
+
+    PoolStats(size_t capacity, size_t used, size_t high_water_mark, size_t chunks) noexcept: Capacity(capacity),
+                                                                                            Used(used),
+                                                                                            HighWaterMark(
+                                                                                                    high_water_mark),
+                                                                                            Chunks(chunks) {
+    }
+
+    PoolStats(const PoolStats &) noexcept = default;
+
+    PoolStats(PoolStats &&) noexcept = default;
+
+    ~PoolStats() noexcept = default;
+
+    PoolStats &operator=(const PoolStats &) noexcept = default;
+
+    PoolStats &operator=(PoolStats &&) noexcept = default;
+
+    [[nodiscard]] size_t Available() const noexcept { return Capacity - Used; }
+};
+
+// Fixed-size object pool. Slots are carved out of chunks of ChunkSize objects and recycled through an intrusive
+// free list, so once the pool has grown to the working set Create() and Release() never touch the heap.
+// Chunks are only returned to the system when the pool itself is destroyed.
+template<typename T, size_t ChunkSize = 4096>
+class MemoryPool {
+    static_assert(ChunkSize > 0, "Chunk size must be positive");
+
+public:
+    MemoryPool() noexcept: free_list_(nullptr), used_(0), high_water_mark_(0) {
+    }
+
+    explicit MemoryPool(size_t capacity) : MemoryPool() {
+        Reserve(capacity);
+    }
+
+    MemoryPool(const MemoryPool &) = delete;
+
+    MemoryPool(MemoryPool &&) = delete;
+
+    // Objects still alive at this point are not destroyed, only their storage is reclaimed
+    ~MemoryPool() {
+        for (auto &chunk_ptr: chunks_)
+            delete[] chunk_ptr;
+        chunks_.clear();
+    }
+
+    MemoryPool &operator=(const MemoryPool &) = delete;
+
+    MemoryPool &operator=(MemoryPool &&) = delete;
+
+    [[nodiscard]] PoolStats stats() const noexcept {
+        return {chunks_.size() * ChunkSize, used_, high_water_mark_, chunks_.size()};
+    }
+
+    template<typename... Args>
+    T *Create(Args &&... args) {
+        Slot *slot_ptr = Allocate();
+        return new(slot_ptr->Storage) T(std::forward<Args>(args)...);
+    }
+
+    void Release(T *ptr) noexcept {
+        ptr->~T();
+
+        auto *slot_ptr = reinterpret_cast<Slot *>(ptr);
+        slot_ptr->Next = free_list_;
+        free_list_ = slot_ptr;
+
+        --used_;
+    }
+
+    void Reserve(size_t capacity) {
+        while (chunks_.size() * ChunkSize < capacity)
+            AllocateChunk();
+    }
+
+private:
+    union Slot {
+        Slot *Next;
+        alignas(T) unsigned char Storage[sizeof(T)];
+    };
+
+    boost::container::vector<Slot *> chunks_;
+    Slot *free_list_;
+    size_t used_;
+    size_t high_water_mark_;
+
+    Slot *Allocate() {
+        if (free_list_ == nullptr)
+            AllocateChunk();
+
+        Slot *slot_ptr = free_list_;
+        free_list_ = slot_ptr->Next;
+
+        if (++used_ > high_water_mark_)
+            high_water_mark_ = used_;
+
+        return slot_ptr;
+    }
+
+    void AllocateChunk() {
+        auto *chunk_ptr = new Slot[ChunkSize];
+        chunks_.push_back(chunk_ptr);
+
+        // Thread the new slots in address order so consecutive allocations stay adjacent in memory
+        for (size_t i = ChunkSize; i > 0; --i) {
+            chunk_ptr[i - 1].Next = free_list_;
+            free_list_ = &chunk_ptr[i - 1];
+        }
+    }
+};
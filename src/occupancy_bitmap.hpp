@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+#include <boost/container/vector.hpp>
+#include <boost/cstdint.hpp>
+
+// Hierarchical bitset over a fixed range of indexes. Level 0 has one bit per index, every upper level has one bit per
+// non-zero word of the level below, up to a single summary word. Finding the closest set bit in either direction
+// touches at most two words per level, so the cost does not depend on the length of the gap being skipped.
+class OccupancyBitmap {
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    OccupancyBitmap() noexcept: size_(0) {
+    }
+
+    explicit OccupancyBitmap(size_t size) : size_(size) {
+        size_t bits = size;
+        do {
+            size_t words = (bits + 63) / 64;
+            levels_.emplace_back(std::max<size_t>(words, 1), 0);
+            bits = words;
+        } while (bits > 1);
+    }
+
+    OccupancyBitmap(const OccupancyBitmap &) = delete;
+
+    OccupancyBitmap(OccupancyBitmap &&) = delete;
+
+    ~OccupancyBitmap() = default;
+
+    OccupancyBitmap &operator=(const OccupancyBitmap &) = delete;
+
+    OccupancyBitmap &operator=(OccupancyBitmap &&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return levels_.empty() || (levels_.back()[0] == 0); }
+
+    [[nodiscard]] bool Test(size_t index) const noexcept {
+        return (levels_[0][index >> 6] & (1ULL << (index & 63))) != 0;
+    }
+
+    void Set(size_t index) noexcept {
+        for (auto &words: levels_) {
+            boost::uint64_t &word = words[index >> 6];
+            boost::uint64_t previous = word;
+            word |= 1ULL << (index & 63);
+            if (previous != 0)
+                return;
+            index >>= 6;
+        }
+    }
+
+    void Reset(size_t index) noexcept {
+        for (auto &words: levels_) {
+            boost::uint64_t &word = words[index >> 6];
+            word &= ~(1ULL << (index & 63));
+            if (word != 0)
+                return;
+            index >>= 6;
+        }
+    }
+
+    // Smallest set index that is greater than or equal to the given one
+    [[nodiscard]] size_t Next(size_t index) const noexcept {
+        if (index >= size_)
+            return npos;
+
+        size_t level = 0;
+        for (;;) {
+            size_t word = index >> 6;
+            boost::uint64_t bits = levels_[level][word] & (~0ULL << (index & 63));
+            if (bits != 0) {
+                index = (word << 6) + std::countr_zero(bits);
+                break;
+            }
+
+            if (++level == levels_.size())
+                return npos;
+
+            index = word + 1;
+            if ((index >> 6) >= levels_[level].size())
+                return npos;
+        }
+
+        while (level > 0) {
+            --level;
+            index = (index << 6) + std::countr_zero(levels_[level][index]);
+        }
+
+        return index;
+    }
+
+    // Largest set index that is less than or equal to the given one
+    [[nodiscard]] size_t Previous(size_t index) const noexcept {
+        if (size_ == 0)
+            return npos;
+
+        index = std::min(index, size_ - 1);
+
+        size_t level = 0;
+        for (;;) {
+            size_t word = index >> 6;
+            boost::uint64_t bits = levels_[level][word] & (~0ULL >> (63 - (index & 63)));
+            if (bits != 0) {
+                index = (word << 6) + 63 - std::countl_zero(bits);
+                break;
+            }
+
+            if ((++level == levels_.size()) || (word == 0))
+                return npos;
+
+            index = word - 1;
+        }
+
+        while (level > 0) {
+            --level;
+            index = (index << 6) + 63 - std::countl_zero(levels_[level][index]);
+        }
+
+        return index;
+    }
+
+private:
+    size_t size_;
+    boost::container::vector<boost::container::vector<boost::uint64_t>> levels_;
+};
@@ -5,20 +5,29 @@
 
 #include <boost/cstdint.hpp>
 #include <boost/intrusive/list.hpp>
+#include <boost/intrusive/set.hpp>
 
 #include "errors.hpp"
+#include "memory_pool.hpp"
 
 enum class OrderSide : boost::uint8_t {
     BUY,
     SELL
 };
 
+enum class OrderType : boost::uint8_t {
+    LIMIT,
+    STOP_LIMIT,
+    TRAILING_STOP_LIMIT
+};
+
 class Order {
 public:
     boost::uint64_t Id;
     boost::uint64_t SymbolId;
     boost::uint64_t UserId;
     OrderSide Side;
+    OrderType Type;
     boost::uint64_t Price;
     boost::uint64_t StopPrice;
 
@@ -49,6 +58,10 @@ public:
                                                       SymbolId(symbol),
                                                       UserId(user),
                                                       Side(side),
+                                                      Type((trailing_distance != 0) ? OrderType::TRAILING_STOP_LIMIT
+                                                                                    : ((stop_price != 0)
+                                                                                       ? OrderType::STOP_LIMIT
+                                                                                       : OrderType::LIMIT)),
                                                       Price(price),
                                                       StopPrice(stop_price),
                                                       Quantity(quantity),
@@ -73,6 +86,12 @@ public:
 
     [[nodiscard]] bool IsSell() const noexcept { return Side == OrderSide::SELL; }
 
+    [[nodiscard]] bool IsLimit() const noexcept { return Type == OrderType::LIMIT; }
+
+    [[nodiscard]] bool IsStopLimit() const noexcept { return Type == OrderType::STOP_LIMIT; }
+
+    [[nodiscard]] bool IsTrailingStopLimit() const noexcept { return Type == OrderType::TRAILING_STOP_LIMIT; }
+
     static Order Buy(boost::uint64_t id, boost::uint64_t symbol, boost::uint64_t user, boost::uint64_t price,
                      boost::uint64_t quantity,
                      boost::uint64_t max_visible_quantity = std::numeric_limits<boost::uint64_t>::max()) noexcept {
@@ -84,6 +103,33 @@ public:
                       boost::uint64_t max_visible_quantity = std::numeric_limits<boost::uint64_t>::max()) noexcept {
         return {id, symbol, user, OrderSide::SELL, price, 0, quantity, max_visible_quantity, 0, 0};
     }
+
+    static Order BuyStopLimit(boost::uint64_t id, boost::uint64_t symbol, boost::uint64_t user, boost::uint64_t price,
+                              boost::uint64_t stop_price, boost::uint64_t quantity,
+                              boost::uint64_t max_visible_quantity = std::numeric_limits<boost::uint64_t>::max()) noexcept {
+        return {id, symbol, user, OrderSide::BUY, price, stop_price, quantity, max_visible_quantity, 0, 0};
+    }
+
+    static Order SellStopLimit(boost::uint64_t id, boost::uint64_t symbol, boost::uint64_t user, boost::uint64_t price,
+                               boost::uint64_t stop_price, boost::uint64_t quantity,
+                               boost::uint64_t max_visible_quantity = std::numeric_limits<boost::uint64_t>::max()) noexcept {
+        return {id, symbol, user, OrderSide::SELL, price, stop_price, quantity, max_visible_quantity, 0, 0};
+    }
+
+    // Positive trailing distance and step are absolute price offsets, negative ones are in basis points of the market
+    static Order TrailingBuyStopLimit(boost::uint64_t id, boost::uint64_t symbol, boost::uint64_t user,
+                                      boost::uint64_t price, boost::uint64_t stop_price, boost::uint64_t quantity,
+                                      boost::int64_t trailing_distance, boost::int64_t trailing_step = 0) noexcept {
+        return {id, symbol, user, OrderSide::BUY, price, stop_price, quantity,
+                std::numeric_limits<boost::uint64_t>::max(), trailing_distance, trailing_step};
+    }
+
+    static Order TrailingSellStopLimit(boost::uint64_t id, boost::uint64_t symbol, boost::uint64_t user,
+                                       boost::uint64_t price, boost::uint64_t stop_price, boost::uint64_t quantity,
+                                       boost::int64_t trailing_distance, boost::int64_t trailing_step = 0) noexcept {
+        return {id, symbol, user, OrderSide::SELL, price, stop_price, quantity,
+                std::numeric_limits<boost::uint64_t>::max(), trailing_distance, trailing_step};
+    }
 };
 
 class LevelNode;
@@ -93,7 +139,16 @@ public:
     LevelNode *Level;
     boost::intrusive::list_member_hook<> member_hook_;
 
-    OrderNode(const Order &order) noexcept: Order(order), Level(nullptr) {
+    // Market price at which a resting trailing stop starts to move, see OrderBook::CalculateTrailingStopKey(), and the
+    // order in which it joined its stop level
+    boost::uint64_t TrailingKey;
+    boost::uint64_t TrailingSequence;
+    boost::intrusive::set_member_hook<> trailing_hook_;
+
+    // Links the open orders of the same user, see MarketManager::CancelAllOrders()
+    boost::intrusive::list_member_hook<> user_hook_;
+
+    OrderNode(const Order &order) noexcept: Order(order), Level(nullptr), TrailingKey(0), TrailingSequence(0) {
     }
 
     OrderNode(const OrderNode &) noexcept = default;
@@ -105,6 +160,8 @@ public:
     OrderNode &operator=(const Order &order) noexcept {
         Order::operator=(order);
         Level = nullptr;
+        TrailingKey = 0;
+        TrailingSequence = 0;
         return *this;
     }
 
@@ -114,3 +171,20 @@ public:
 };
 
 typedef boost::intrusive::list<OrderNode, boost::intrusive::member_hook<OrderNode, boost::intrusive::list_member_hook<>, &OrderNode::member_hook_>> OrderNodeList;
+
+class TrailingKeyCompare {
+public:
+    bool operator()(const OrderNode &order1, const OrderNode &order2) const noexcept {
+        return order1.TrailingKey < order2.TrailingKey;
+    }
+
+    bool operator()(const OrderNode &order, boost::uint64_t key) const noexcept { return order.TrailingKey < key; }
+
+    bool operator()(boost::uint64_t key, const OrderNode &order) const noexcept { return key < order.TrailingKey; }
+};
+
+typedef boost::intrusive::list<OrderNode, boost::intrusive::member_hook<OrderNode, boost::intrusive::list_member_hook<>, &OrderNode::user_hook_>> UserOrderList;
+
+typedef boost::intrusive::multiset<OrderNode, boost::intrusive::member_hook<OrderNode, boost::intrusive::set_member_hook<>, &OrderNode::trailing_hook_>, boost::intrusive::compare<TrailingKeyCompare>> TrailingStopIndex;
+
+typedef MemoryPool<OrderNode> OrderNodePool;
@@ -1,64 +1,66 @@
 #include "order_book.hpp"
 
-OrderBook::OrderBook(Symbol symbol)
+OrderBook::OrderBook(Symbol symbol, LevelNodePool &level_pool, const OrderBookOptions &options)
         : symbol_(std::move(symbol)),
+          options_(options),
+          level_pool_(level_pool),
           best_bid_(nullptr),
           best_ask_(nullptr),
+          bid_ladder_(options.TickSize, options.IndexedLevels()),
+          ask_ladder_(options.TickSize, options.IndexedLevels()),
           best_buy_stop_(nullptr),
           best_sell_stop_(nullptr),
+          buy_stop_ladder_(options.TickSize, options.IndexedLevels()),
+          sell_stop_ladder_(options.TickSize, options.IndexedLevels()),
           best_trailing_buy_stop_(nullptr),
           best_trailing_sell_stop_(nullptr),
+          trailing_buy_stop_ladder_(options.TickSize, options.IndexedLevels()),
+          trailing_sell_stop_ladder_(options.TickSize, options.IndexedLevels()),
+          trailing_sequence_(0),
           last_bid_price_(0),
           last_ask_price_(std::numeric_limits<boost::uint64_t>::max()),
           matching_bid_price_(0),
           matching_ask_price_(std::numeric_limits<boost::uint64_t>::max()),
           trailing_bid_price_(0),
-          trailing_ask_price_(std::numeric_limits<boost::uint64_t>::max()) {
+          trailing_ask_price_(std::numeric_limits<boost::uint64_t>::max()),
+          published_top_() {
 }
 
 OrderBook::~OrderBook() {
-    for (auto &bid: bids_)
-        delete &bid;
-    bids_.clear();
+    trailing_buy_index_.clear();
+    trailing_sell_index_.clear();
 
-    for (auto &ask: asks_)
-        delete &ask;
-    asks_.clear();
+    auto release = [this](LevelNode *level_ptr) { level_pool_.Release(level_ptr); };
 
-    for (auto &buy_stop: buy_stop_)
-        delete &buy_stop;
-    buy_stop_.clear();
-
-    for (auto &sell_stop: sell_stop_)
-        delete &sell_stop;
-    sell_stop_.clear();
-
-    for (auto &trailing_buy_stop: trailing_buy_stop_)
-        delete &trailing_buy_stop;
-    trailing_buy_stop_.clear();
-
-    for (auto &trailing_sell_stop: trailing_sell_stop_)
-        delete &trailing_sell_stop;
-    trailing_sell_stop_.clear();
+    bids_.clear_and_dispose(release);
+    asks_.clear_and_dispose(release);
+    buy_stop_.clear_and_dispose(release);
+    sell_stop_.clear_and_dispose(release);
+    trailing_buy_stop_.clear_and_dispose(release);
+    trailing_sell_stop_.clear_and_dispose(release);
 }
 
 LevelNode *OrderBook::AddLevel(OrderNode *order_ptr) {
     LevelNode *level_ptr;
 
     if (order_ptr->IsBuy()) {
-        level_ptr = new LevelNode(LevelType::BID, order_ptr->Price);
+        level_ptr = level_pool_.Create(LevelType::BID, order_ptr->Price);
 
         bids_.insert(*level_ptr);
 
         if ((best_bid_ == nullptr) || (level_ptr->Price > best_bid_->Price))
             best_bid_ = level_ptr;
+
+        IndexLevel(bids_, bid_ladder_, level_ptr, best_bid_);
     } else {
-        level_ptr = new LevelNode(LevelType::ASK, order_ptr->Price);
+        level_ptr = level_pool_.Create(LevelType::ASK, order_ptr->Price);
 
         asks_.insert(*level_ptr);
 
         if ((best_ask_ == nullptr) || (level_ptr->Price < best_ask_->Price))
             best_ask_ = level_ptr;
+
+        IndexLevel(asks_, ask_ladder_, level_ptr, best_ask_);
     }
 
     return level_ptr;
@@ -72,14 +74,18 @@ LevelNode *OrderBook::DeleteLevel(OrderNode *order_ptr) {
             best_bid_ = GetNextLevel(best_bid_);
 
         bids_.erase(LevelNodeSet::iterator(LevelNodeSet::s_iterator_to(*level_ptr)));
+
+        UnindexLevel(bids_, bid_ladder_, level_ptr, best_bid_);
     } else {
         if (level_ptr == best_ask_)
             best_ask_ = GetNextLevel(best_ask_);
 
         asks_.erase(LevelNodeSet::iterator(LevelNodeSet::s_iterator_to(*level_ptr)));
+
+        UnindexLevel(asks_, ask_ladder_, level_ptr, best_ask_);
     }
 
-    delete level_ptr;
+    level_pool_.Release(level_ptr);
 
     return nullptr;
 }
@@ -154,23 +160,43 @@ LevelUpdate OrderBook::DeleteOrder(OrderNode *order_ptr) {
                             (order_ptr->Level == (order_ptr->IsBuy() ? best_bid_ : best_ask_)))};
 }
 
+LevelUpdate OrderBook::ResizeOrder(OrderNode *order_ptr, boost::uint64_t quantity) {
+    LevelNode *level_ptr = order_ptr->Level;
+
+    level_ptr->TotalVolume -= order_ptr->LeavesQuantity;
+    level_ptr->HiddenVolume -= order_ptr->HiddenQuantity();
+    level_ptr->VisibleVolume -= order_ptr->VisibleQuantity();
+
+    order_ptr->LeavesQuantity = quantity;
+
+    level_ptr->TotalVolume += order_ptr->LeavesQuantity;
+    level_ptr->HiddenVolume += order_ptr->HiddenQuantity();
+    level_ptr->VisibleVolume += order_ptr->VisibleQuantity();
+
+    return {UpdateType::UPDATE, *level_ptr, (level_ptr == (order_ptr->IsBuy() ? best_bid_ : best_ask_))};
+}
+
 LevelNode *OrderBook::AddStopLevel(OrderNode *order_ptr) {
     LevelNode *level_ptr;
 
     if (order_ptr->IsBuy()) {
-        level_ptr = new LevelNode(LevelType::ASK, order_ptr->StopPrice);
+        level_ptr = level_pool_.Create(LevelType::ASK, order_ptr->StopPrice);
 
         buy_stop_.insert(*level_ptr);
 
         if ((best_buy_stop_ == nullptr) || (level_ptr->Price < best_buy_stop_->Price))
             best_buy_stop_ = level_ptr;
+
+        IndexLevel(buy_stop_, buy_stop_ladder_, level_ptr, best_buy_stop_);
     } else {
-        level_ptr = new LevelNode(LevelType::BID, order_ptr->StopPrice);
+        level_ptr = level_pool_.Create(LevelType::BID, order_ptr->StopPrice);
 
         sell_stop_.insert(*level_ptr);
 
         if ((best_sell_stop_ == nullptr) || (level_ptr->Price > best_sell_stop_->Price))
             best_sell_stop_ = level_ptr;
+
+        IndexLevel(sell_stop_, sell_stop_ladder_, level_ptr, best_sell_stop_);
     }
 
     return level_ptr;
@@ -184,18 +210,39 @@ LevelNode *OrderBook::DeleteStopLevel(OrderNode *order_ptr) {
             best_buy_stop_ = GetNextStopLevel(best_buy_stop_);
 
         buy_stop_.erase(LevelNodeSet::iterator(LevelNodeSet::s_iterator_to(*level_ptr)));
+
+        UnindexLevel(buy_stop_, buy_stop_ladder_, level_ptr, best_buy_stop_);
     } else {
         if (level_ptr == best_sell_stop_)
             best_sell_stop_ = GetNextStopLevel(best_sell_stop_);
 
         sell_stop_.erase(LevelNodeSet::iterator(LevelNodeSet::s_iterator_to(*level_ptr)));
+
+        UnindexLevel(sell_stop_, sell_stop_ladder_, level_ptr, best_sell_stop_);
     }
 
-    delete level_ptr;
+    level_pool_.Release(level_ptr);
 
     return nullptr;
 }
 
+void OrderBook::AddStopOrder(OrderNode *order_ptr) {
+    LevelNode *level_ptr = order_ptr->IsBuy() ? (LevelNode *) GetBuyStopLevel(order_ptr->StopPrice)
+                                              : (LevelNode *) GetSellStopLevel(order_ptr->StopPrice);
+
+    if (level_ptr == nullptr)
+        level_ptr = AddStopLevel(order_ptr);
+
+    level_ptr->TotalVolume += order_ptr->LeavesQuantity;
+    level_ptr->HiddenVolume += order_ptr->HiddenQuantity();
+    level_ptr->VisibleVolume += order_ptr->VisibleQuantity();
+
+    level_ptr->OrderList.push_back(*order_ptr);
+    ++level_ptr->Orders;
+
+    order_ptr->Level = level_ptr;
+}
+
 void OrderBook::DeleteStopOrder(OrderNode *order_ptr) {
     LevelNode *level_ptr = order_ptr->Level;
 
@@ -215,19 +262,23 @@ LevelNode *OrderBook::AddTrailingStopLevel(OrderNode *order_ptr) {
     LevelNode *level_ptr;
 
     if (order_ptr->IsBuy()) {
-        level_ptr = new LevelNode(LevelType::ASK, order_ptr->StopPrice);
+        level_ptr = level_pool_.Create(LevelType::ASK, order_ptr->StopPrice);
 
         trailing_buy_stop_.insert(*level_ptr);
 
         if ((best_trailing_buy_stop_ == nullptr) || (level_ptr->Price < best_trailing_buy_stop_->Price))
             best_trailing_buy_stop_ = level_ptr;
+
+        IndexLevel(trailing_buy_stop_, trailing_buy_stop_ladder_, level_ptr, best_trailing_buy_stop_);
     } else {
-        level_ptr = new LevelNode(LevelType::BID, order_ptr->StopPrice);
+        level_ptr = level_pool_.Create(LevelType::BID, order_ptr->StopPrice);
 
         trailing_sell_stop_.insert(*level_ptr);
 
         if ((best_trailing_sell_stop_ == nullptr) || (level_ptr->Price > best_trailing_sell_stop_->Price))
             best_trailing_sell_stop_ = level_ptr;
+
+        IndexLevel(trailing_sell_stop_, trailing_sell_stop_ladder_, level_ptr, best_trailing_sell_stop_);
     }
 
     return level_ptr;
@@ -241,14 +292,18 @@ LevelNode *OrderBook::DeleteTrailingStopLevel(OrderNode *order_ptr) {
             best_trailing_buy_stop_ = GetNextTrailingStopLevel(best_trailing_buy_stop_);
 
         trailing_buy_stop_.erase(LevelNodeSet::iterator(LevelNodeSet::s_iterator_to(*level_ptr)));
+
+        UnindexLevel(trailing_buy_stop_, trailing_buy_stop_ladder_, level_ptr, best_trailing_buy_stop_);
     } else {
         if (level_ptr == best_trailing_sell_stop_)
             best_trailing_sell_stop_ = GetNextTrailingStopLevel(best_trailing_sell_stop_);
 
         trailing_sell_stop_.erase(LevelNodeSet::iterator(LevelNodeSet::s_iterator_to(*level_ptr)));
+
+        UnindexLevel(trailing_sell_stop_, trailing_sell_stop_ladder_, level_ptr, best_trailing_sell_stop_);
     }
 
-    delete level_ptr;
+    level_pool_.Release(level_ptr);
 
     return nullptr;
 }
@@ -268,11 +323,20 @@ void OrderBook::AddTrailingStopOrder(OrderNode *order_ptr) {
     ++level_ptr->Orders;
 
     order_ptr->Level = level_ptr;
+    order_ptr->TrailingSequence = trailing_sequence_++;
+
+    if (CalculateTrailingStopKey(*order_ptr, order_ptr->TrailingKey))
+        (order_ptr->IsBuy() ? trailing_buy_index_ : trailing_sell_index_).insert(*order_ptr);
 }
 
 void OrderBook::DeleteTrailingStopOrder(OrderNode *order_ptr) {
     LevelNode *level_ptr = order_ptr->Level;
 
+    if (order_ptr->trailing_hook_.is_linked()) {
+        TrailingStopIndex &index = order_ptr->IsBuy() ? trailing_buy_index_ : trailing_sell_index_;
+        index.erase(index.iterator_to(*order_ptr));
+    }
+
     level_ptr->TotalVolume -= order_ptr->LeavesQuantity;
     level_ptr->HiddenVolume -= order_ptr->HiddenQuantity();
     level_ptr->VisibleVolume -= order_ptr->VisibleQuantity();
@@ -285,8 +349,7 @@ void OrderBook::DeleteTrailingStopOrder(OrderNode *order_ptr) {
     }
 }
 
-boost::uint64_t OrderBook::CalculateTrailingStopPrice(const Order &order) const noexcept {
-    boost::uint64_t market_price = order.IsBuy() ? GetMarketTrailingStopPriceAsk() : GetMarketTrailingStopPriceBid();
+boost::uint64_t OrderBook::CalculateTrailingStopPrice(const Order &order, boost::uint64_t market_price) noexcept {
     boost::int64_t trailing_distance = order.TrailingDistance;
     boost::int64_t trailing_step = order.TrailingStep;
 
@@ -315,3 +378,67 @@ boost::uint64_t OrderBook::CalculateTrailingStopPrice(const Order &order) const
 
     return old_price;
 }
+
+// A trailing stop is keyed by the market price at which its stop price starts to move: a buy stop moves once the
+// market ask drops to the key or below, a sell stop once the market bid rises to the key or above. Returns false for
+// orders whose stop price can never move.
+bool OrderBook::CalculateTrailingStopKey(const Order &order, boost::uint64_t &key) noexcept {
+    const boost::uint64_t max_price = std::numeric_limits<boost::uint64_t>::max();
+    boost::uint64_t old_price = order.StopPrice;
+
+    if ((order.TrailingDistance > 0) && (order.TrailingStep >= 0)) {
+        auto distance = (boost::uint64_t) order.TrailingDistance;
+        auto step = (boost::uint64_t) std::max<boost::int64_t>(order.TrailingStep, 1);
+
+        if (order.IsBuy()) {
+            if (old_price < (distance + step))
+                return false;
+            key = old_price - distance - step;
+        } else {
+            if (old_price > (max_price - distance - step))
+                return false;
+            key = old_price + distance + step;
+        }
+
+        return true;
+    }
+
+    // Distances in basis points scale with the market price, but whether the stop moves is still monotonic in it,
+    // so the boundary is found by bisection within the range where the calculation cannot overflow
+    boost::uint64_t scale = std::max<boost::uint64_t>({(boost::uint64_t) -std::min<boost::int64_t>(order.TrailingDistance, 0),
+                                                       (boost::uint64_t) -std::min<boost::int64_t>(order.TrailingStep, 0),
+                                                       1});
+    boost::uint64_t low = 0;
+    boost::uint64_t high = max_price / scale;
+
+    auto moves = [&order, old_price](boost::uint64_t market_price) {
+        return CalculateTrailingStopPrice(order, market_price) != old_price;
+    };
+
+    if (order.IsBuy()) {
+        high = std::min(high, old_price);
+        if (!moves(low))
+            return false;
+        while (low < high) {
+            boost::uint64_t middle = low + (high - low + 1) / 2;
+            if (moves(middle))
+                low = middle;
+            else
+                high = middle - 1;
+        }
+        key = low;
+    } else {
+        if (!moves(high))
+            return false;
+        while (low < high) {
+            boost::uint64_t middle = low + (high - low) / 2;
+            if (moves(middle))
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        key = high;
+    }
+
+    return true;
+}
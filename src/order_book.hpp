@@ -1,15 +1,61 @@
 #pragma once
 
 #include "level.hpp"
+#include "price_ladder.hpp"
 #include "symbol.hpp"
+#include "top_of_book.hpp"
 
 class MarketManager;
 
+enum class OrderBookLayout : boost::uint8_t {
+    TREE,
+    LADDER
+};
+
+class OrderBookOptions {
+public:
+    OrderBookLayout Layout;
+    boost::uint64_t TickSize;
+    size_t LadderSize;
+
+    OrderBookOptions() noexcept: Layout(OrderBookLayout::TREE), TickSize(1), LadderSize(0) {
+    }
+
+    OrderBookOptions(OrderBookLayout layout, boost::uint64_t tick_size, size_t ladder_size) noexcept: Layout(layout),
+                                                                                                     TickSize(tick_size),
+                                                                                                     LadderSize(
+                                                                                                             ladder_size) {
+    }
+
+    OrderBookOptions(const OrderBookOptions &) noexcept = default;
+
+    OrderBookOptions(OrderBookOptions &&) noexcept = default;
+
+    ~OrderBookOptions() noexcept = default;
+
+    OrderBookOptions &operator=(const OrderBookOptions &) noexcept = default;
+
+    OrderBookOptions &operator=(OrderBookOptions &&) noexcept = default;
+
+    [[nodiscard]] bool IsLadder() const noexcept { return Layout == OrderBookLayout::LADDER; }
+
+    [[nodiscard]] size_t IndexedLevels() const noexcept { return IsLadder() ? LadderSize : 0; }
+
+    static OrderBookOptions Tree() noexcept {
+        return {};
+    }
+
+    static OrderBookOptions Ladder(boost::uint64_t tick_size, size_t ladder_size = 4096) noexcept {
+        return {OrderBookLayout::LADDER, tick_size, ladder_size};
+    }
+};
+
 class OrderBook {
     friend class MarketManager;
+    friend class Snapshot;
 
 public:
-    OrderBook(Symbol symbol);
+    OrderBook(Symbol symbol, LevelNodePool &level_pool, const OrderBookOptions &options = OrderBookOptions());
 
     OrderBook(const OrderBook &) = delete;
 
@@ -32,12 +78,17 @@ public:
 
     [[nodiscard]] const Symbol &symbol() const noexcept { return symbol_; }
 
+    [[nodiscard]] const OrderBookOptions &options() const noexcept { return options_; }
+
     [[nodiscard]] const LevelNode *best_bid() const noexcept { return best_bid_; }
 
     [[nodiscard]] const LevelNode *best_ask() const noexcept { return best_ask_; }
 
     [[nodiscard]] const LevelNodeSet &bids() const noexcept { return bids_; }
 
+    // Safe to load from any thread for as long as the book exists
+    [[nodiscard]] const TopOfBookSeqLock &top_of_book() const noexcept { return top_of_book_; }
+
     [[nodiscard]] const LevelNodeSet &asks() const noexcept { return asks_; }
 
     [[nodiscard]] const LevelNode *best_buy_stop() const noexcept { return best_buy_stop_; }
@@ -57,57 +108,86 @@ public:
     [[nodiscard]] const LevelNodeSet &trailing_sell_stop() const noexcept { return trailing_sell_stop_; }
 
     [[nodiscard]] const LevelNode *GetBid(boost::uint64_t price) const noexcept {
-        auto it = bids_.find(LevelNode(LevelType::BID, price));
-        return (it != bids_.end()) ? it.operator->() : nullptr;
+        return FindLevel(bids_, bid_ladder_, price);
     }
 
     [[nodiscard]] const LevelNode *GetAsk(boost::uint64_t price) const noexcept {
-        auto it = asks_.find(LevelNode(LevelType::ASK, price));
-        return (it != asks_.end()) ? it.operator->() : nullptr;
+        return FindLevel(asks_, ask_ladder_, price);
     }
 
     [[nodiscard]] const LevelNode *GetBuyStopLevel(boost::uint64_t price) const noexcept {
-        auto it = buy_stop_.find(LevelNode(LevelType::ASK, price));
-        return (it != buy_stop_.end()) ? it.operator->() : nullptr;
+        return FindLevel(buy_stop_, buy_stop_ladder_, price);
     }
 
     [[nodiscard]] const LevelNode *GetSellStopLevel(boost::uint64_t price) const noexcept {
-        auto it = sell_stop_.find(LevelNode(LevelType::BID, price));
-        return (it != sell_stop_.end()) ? it.operator->() : nullptr;
+        return FindLevel(sell_stop_, sell_stop_ladder_, price);
     }
 
     [[nodiscard]] const LevelNode *GetTrailingBuyStopLevel(boost::uint64_t price) const noexcept {
-        auto it = trailing_buy_stop_.find(LevelNode(LevelType::ASK, price));
-        return (it != trailing_buy_stop_.end()) ? it.operator->() : nullptr;
+        return FindLevel(trailing_buy_stop_, trailing_buy_stop_ladder_, price);
     }
 
     [[nodiscard]] const LevelNode *GetTrailingSellStopLevel(boost::uint64_t price) const noexcept {
-        auto it = trailing_sell_stop_.find(LevelNode(LevelType::BID, price));
-        return (it != trailing_sell_stop_.end()) ? it.operator->() : nullptr;
+        return FindLevel(trailing_sell_stop_, trailing_sell_stop_ladder_, price);
     }
 
 private:
     Symbol symbol_;
+    OrderBookOptions options_;
+    LevelNodePool &level_pool_;
 
-    LevelNode *best_bid_;
-    LevelNode *best_ask_;
-    LevelNodeSet bids_;
-    LevelNodeSet asks_;
+    [[nodiscard]] static const LevelNode *
+    FindLevel(const LevelNodeSet &levels, const PriceLadder &ladder, boost::uint64_t price) noexcept {
+        if (ladder.Covers(price))
+            return ladder.Get(price);
 
-    LevelNode *GetNextLevel(LevelNode *level) noexcept {
+        auto it = levels.find(price, LevelPriceCompare());
+        return (it != levels.end()) ? it.operator->() : nullptr;
+    }
+
+    // Bid-typed sets are walked from the highest price down, ask-typed sets from the lowest price up
+    static LevelNode *NextLevel(LevelNodeSet &levels, const PriceLadder &ladder, LevelNode *level) noexcept {
+        if (ladder.exact() && ladder.Covers(level->Price)) {
+            LevelNode *next = level->IsBid() ? ladder.Lower(level->Price) : ladder.Higher(level->Price);
+            if (next != nullptr)
+                return next;
+        }
+
+        LevelNodeSet::iterator it(LevelNodeSet::s_iterator_to(*level));
         if (level->IsBid()) {
-            LevelNodeSet::reverse_iterator it(LevelNodeSet::s_iterator_to(*level));
-            if (it == bids_.rend())
+            if (it == levels.begin())
                 return nullptr;
-            ++it;
-            return it.operator->();
+            --it;
         } else {
-            LevelNodeSet::iterator it(LevelNodeSet::s_iterator_to(*level));
             ++it;
-            if (it == asks_.end())
+            if (it == levels.end())
                 return nullptr;
-            return it.operator->();
         }
+        return it.operator->();
+    }
+
+    static void
+    IndexLevel(LevelNodeSet &levels, PriceLadder &ladder, LevelNode *level, const LevelNode *best) noexcept {
+        if (!ladder.Insert(level) && (level == best) && !ladder.InWindow(level->Price))
+            ladder.Recenter(level->Price, levels);
+    }
+
+    static void
+    UnindexLevel(LevelNodeSet &levels, PriceLadder &ladder, LevelNode *level, const LevelNode *best) noexcept {
+        ladder.Erase(level);
+        if ((best != nullptr) && !ladder.InWindow(best->Price))
+            ladder.Recenter(best->Price, levels);
+    }
+
+    LevelNode *best_bid_;
+    LevelNode *best_ask_;
+    LevelNodeSet bids_;
+    LevelNodeSet asks_;
+    PriceLadder bid_ladder_;
+    PriceLadder ask_ladder_;
+
+    LevelNode *GetNextLevel(LevelNode *level) noexcept {
+        return level->IsBid() ? NextLevel(bids_, bid_ladder_, level) : NextLevel(asks_, ask_ladder_, level);
     }
 
     LevelNode *AddLevel(OrderNode *order_ptr);
@@ -121,63 +201,62 @@ private:
 
     LevelUpdate DeleteOrder(OrderNode *order_ptr);
 
+    // Sets the leaves quantity of an order of any kind in place, keeping its place in the queue of its level
+    LevelUpdate ResizeOrder(OrderNode *order_ptr, boost::uint64_t quantity);
+
     LevelNode *best_buy_stop_;
     LevelNode *best_sell_stop_;
     LevelNodeSet buy_stop_;
     LevelNodeSet sell_stop_;
+    PriceLadder buy_stop_ladder_;
+    PriceLadder sell_stop_ladder_;
 
     LevelNode *GetNextStopLevel(LevelNode *level) noexcept {
-        if (level->IsBid()) {
-            LevelNodeSet::reverse_iterator it(LevelNodeSet::s_iterator_to(*level));
-            if (it == buy_stop_.rend())
-                return nullptr;
-            ++it;
-            return it.operator->();
-        } else {
-            LevelNodeSet::iterator it(LevelNodeSet::s_iterator_to(*level));
-            ++it;
-            if (it == sell_stop_.end())
-                return nullptr;
-            return it.operator->();
-        }
+        return level->IsBid() ? NextLevel(sell_stop_, sell_stop_ladder_, level)
+                              : NextLevel(buy_stop_, buy_stop_ladder_, level);
     }
 
     LevelNode *AddStopLevel(OrderNode *order_ptr);
 
     LevelNode *DeleteStopLevel(OrderNode *order_ptr);
 
+    void AddStopOrder(OrderNode *order_ptr);
+
     void DeleteStopOrder(OrderNode *order_ptr);
 
     LevelNode *best_trailing_buy_stop_;
     LevelNode *best_trailing_sell_stop_;
     LevelNodeSet trailing_buy_stop_;
     LevelNodeSet trailing_sell_stop_;
+    PriceLadder trailing_buy_stop_ladder_;
+    PriceLadder trailing_sell_stop_ladder_;
 
     LevelNode *GetNextTrailingStopLevel(LevelNode *level) noexcept {
-        if (level->IsBid()) {
-            LevelNodeSet::reverse_iterator it(LevelNodeSet::s_iterator_to(*level));
-            if (it == trailing_buy_stop_.rend())
-                return nullptr;
-            ++it;
-            return it.operator->();
-        } else {
-            LevelNodeSet::iterator it(LevelNodeSet::s_iterator_to(*level));
-            ++it;
-            if (it == trailing_sell_stop_.end())
-                return nullptr;
-            return it.operator->();
-        }
+        return level->IsBid() ? NextLevel(trailing_sell_stop_, trailing_sell_stop_ladder_, level)
+                              : NextLevel(trailing_buy_stop_, trailing_buy_stop_ladder_, level);
     }
 
     LevelNode *AddTrailingStopLevel(OrderNode *order_ptr);
 
     LevelNode *DeleteTrailingStopLevel(OrderNode *order_ptr);
 
+    TrailingStopIndex trailing_buy_index_;
+    TrailingStopIndex trailing_sell_index_;
+    boost::uint64_t trailing_sequence_;
+
     void AddTrailingStopOrder(OrderNode *order_ptr);
 
     void DeleteTrailingStopOrder(OrderNode *order_ptr);
 
-    [[nodiscard]] boost::uint64_t CalculateTrailingStopPrice(const Order &order) const noexcept;
+    [[nodiscard]] boost::uint64_t CalculateTrailingStopPrice(const Order &order) const noexcept {
+        return CalculateTrailingStopPrice(order, order.IsBuy() ? GetMarketTrailingStopPriceAsk()
+                                                               : GetMarketTrailingStopPriceBid());
+    }
+
+    [[nodiscard]] static boost::uint64_t
+    CalculateTrailingStopPrice(const Order &order, boost::uint64_t market_price) noexcept;
+
+    [[nodiscard]] static bool CalculateTrailingStopKey(const Order &order, boost::uint64_t &key) noexcept;
 
     boost::uint64_t last_bid_price_;
     boost::uint64_t last_ask_price_;
@@ -230,4 +309,30 @@ private:
         matching_bid_price_ = 0;
         matching_ask_price_ = std::numeric_limits<boost::uint64_t>::max();
     }
+
+    TopOfBook published_top_;
+    TopOfBookSeqLock top_of_book_;
+
+    // Stores the current top of book for readers on other threads, skipping the store when nothing has changed
+    void PublishTopOfBook() noexcept {
+        TopOfBook top{};
+        if (best_bid_ != nullptr) {
+            top.BidPrice = best_bid_->Price;
+            top.BidVolume = best_bid_->VisibleVolume;
+            top.BidOrders = best_bid_->Orders;
+        }
+        if (best_ask_ != nullptr) {
+            top.AskPrice = best_ask_->Price;
+            top.AskVolume = best_ask_->VisibleVolume;
+            top.AskOrders = best_ask_->Orders;
+        }
+        top.LastBidPrice = last_bid_price_;
+        top.LastAskPrice = (last_ask_price_ != std::numeric_limits<boost::uint64_t>::max()) ? last_ask_price_ : 0;
+
+        if (top == published_top_)
+            return;
+
+        published_top_ = top;
+        top_of_book_.Store(top);
+    }
 };
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+
+#include <boost/container/deque.hpp>
+#include <boost/container/vector.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "order.hpp"
+
+enum class OrderTablePolicy : boost::uint8_t {
+    HASH,
+    PAGED
+};
+
+// Order lookup table for mostly sequential ids. Ids map directly to a slot in a page of PageSize entries, pages are
+// kept in a directory that starts at the lowest page still in use. A page whose orders are all gone is recycled and
+// its directory entry is left as a tombstone; leading tombstones are trimmed so the directory follows the live id
+// range. The last page is the exception while new ids still land on it, and is recycled once they move past it. Ids
+// too far away from that range are kept in a small overflow hash map instead of growing the directory.
+class PagedOrderTable {
+public:
+    static constexpr size_t PageBits = 12;
+    static constexpr size_t PageSize = size_t(1) << PageBits;
+    static constexpr size_t MaxGapPages = 1024;
+
+    PagedOrderTable() noexcept: base_page_(0), size_(0) {
+    }
+
+    PagedOrderTable(const PagedOrderTable &) = delete;
+
+    PagedOrderTable(PagedOrderTable &&) = delete;
+
+    ~PagedOrderTable() {
+        for (auto &page_ptr: directory_)
+            delete page_ptr;
+        for (auto &page_ptr: free_pages_)
+            delete page_ptr;
+    }
+
+    PagedOrderTable &operator=(const PagedOrderTable &) = delete;
+
+    PagedOrderTable &operator=(PagedOrderTable &&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] size_t pages() const noexcept { return directory_.size(); }
+
+    [[nodiscard]] OrderNode *Find(boost::uint64_t id) const noexcept {
+        boost::uint64_t page = id >> PageBits;
+        if ((page >= base_page_) && ((page - base_page_) < directory_.size())) {
+            Page *page_ptr = directory_[page - base_page_];
+            if ((page_ptr != nullptr) && (page_ptr->Slots[id & (PageSize - 1)] != nullptr))
+                return page_ptr->Slots[id & (PageSize - 1)];
+        }
+
+        if (overflow_.empty())
+            return nullptr;
+
+        auto it = overflow_.find(id);
+        return (it != overflow_.end()) ? it->second : nullptr;
+    }
+
+    bool Insert(OrderNode *order_ptr) {
+        boost::uint64_t id = order_ptr->Id;
+
+        if (!overflow_.empty() && (overflow_.find(id) != overflow_.end()))
+            return false;
+
+        Page *page_ptr = MapPage(id >> PageBits);
+        if (page_ptr == nullptr) {
+            if (!overflow_.insert(std::make_pair(id, order_ptr)).second)
+                return false;
+            ++size_;
+            return true;
+        }
+
+        OrderNode *&slot = page_ptr->Slots[id & (PageSize - 1)];
+        if (slot != nullptr)
+            return false;
+
+        slot = order_ptr;
+        ++page_ptr->Live;
+        ++size_;
+        return true;
+    }
+
+    bool Erase(boost::uint64_t id) noexcept {
+        boost::uint64_t page = id >> PageBits;
+        if ((page >= base_page_) && ((page - base_page_) < directory_.size())) {
+            size_t index = page - base_page_;
+            Page *page_ptr = directory_[index];
+            if ((page_ptr != nullptr) && (page_ptr->Slots[id & (PageSize - 1)] != nullptr)) {
+                page_ptr->Slots[id & (PageSize - 1)] = nullptr;
+                --size_;
+
+                // The last page is where new sequential ids land, so it stays mapped even when it runs empty
+                if ((--page_ptr->Live == 0) && (index + 1 < directory_.size()))
+                    RecyclePage(index);
+
+                return true;
+            }
+        }
+
+        if (overflow_.erase(id) == 0)
+            return false;
+
+        --size_;
+        return true;
+    }
+
+    template<typename Function>
+    void ForEach(Function function) const {
+        for (auto &page_ptr: directory_) {
+            if (page_ptr == nullptr)
+                continue;
+            for (auto &order_ptr: page_ptr->Slots)
+                if (order_ptr != nullptr)
+                    function(order_ptr);
+        }
+
+        for (auto &order: overflow_)
+            function(order.second);
+    }
+
+    void clear() noexcept {
+        for (size_t index = 0; index < directory_.size(); ++index) {
+            Page *page_ptr = directory_[index];
+            if (page_ptr == nullptr)
+                continue;
+            std::fill(std::begin(page_ptr->Slots), std::end(page_ptr->Slots), nullptr);
+            page_ptr->Live = 0;
+            free_pages_.push_back(page_ptr);
+        }
+        directory_.clear();
+        overflow_.clear();
+        base_page_ = 0;
+        size_ = 0;
+    }
+
+private:
+    class Page {
+    public:
+        OrderNode *Slots[PageSize];
+        size_t Live;
+    };
+
+    boost::container::deque<Page *> directory_;
+    boost::container::vector<Page *> free_pages_;
+    boost::unordered_map<boost::uint64_t, OrderNode *> overflow_;
+    boost::uint64_t base_page_;
+    size_t size_;
+
+    Page *AllocatePage() {
+        if (free_pages_.empty())
+            return new Page();
+
+        Page *page_ptr = free_pages_.back();
+        free_pages_.pop_back();
+        return page_ptr;
+    }
+
+    // Returns the page that holds the given page number, growing the directory when the page is close enough to the
+    // mapped range, or nullptr when the id belongs in the overflow map
+    Page *MapPage(boost::uint64_t page) {
+        if (directory_.empty()) {
+            base_page_ = page;
+            directory_.push_back(AllocatePage());
+            return directory_.front();
+        }
+
+        if (page < base_page_) {
+            if ((base_page_ - page) > MaxGapPages)
+                return nullptr;
+            while (base_page_ > page) {
+                directory_.push_front(nullptr);
+                --base_page_;
+            }
+        } else if ((page - base_page_) >= directory_.size()) {
+            if ((page - base_page_ - directory_.size()) >= MaxGapPages)
+                return nullptr;
+
+            if (RecycleEmptyLastPage())
+                return MapPage(page);
+            directory_.resize(page - base_page_ + 1, nullptr);
+        }
+
+        Page *&page_ptr = directory_[page - base_page_];
+        if (page_ptr == nullptr)
+            page_ptr = AllocatePage();
+        return page_ptr;
+    }
+
+    // Erase keeps the last page mapped for new ids even when it runs empty; once new ids move past it, nothing
+    // would ever recycle it, so it is dropped here before the directory grows
+    bool RecycleEmptyLastPage() noexcept {
+        if ((directory_.back() == nullptr) || (directory_.back()->Live != 0))
+            return false;
+
+        RecyclePage(directory_.size() - 1);
+        return true;
+    }
+
+    void RecyclePage(size_t index) noexcept {
+        free_pages_.push_back(directory_[index]);
+        directory_[index] = nullptr;
+
+        while (!directory_.empty() && (directory_.front() == nullptr)) {
+            directory_.pop_front();
+            ++base_page_;
+        }
+    }
+};
+
+// Order id to OrderNode map. The paged table serves engine-assigned sequential ids, the hash map serves sparse
+// client-supplied ids; the policy is fixed for the lifetime of the table.
+class OrderTable {
+public:
+    explicit OrderTable(OrderTablePolicy policy = OrderTablePolicy::PAGED) noexcept: policy_(policy) {
+    }
+
+    OrderTable(const OrderTable &) = delete;
+
+    OrderTable(OrderTable &&) = delete;
+
+    ~OrderTable() = default;
+
+    OrderTable &operator=(const OrderTable &) = delete;
+
+    OrderTable &operator=(OrderTable &&) = delete;
+
+    [[nodiscard]] OrderTablePolicy policy() const noexcept { return policy_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    [[nodiscard]] size_t size() const noexcept {
+        return (policy_ == OrderTablePolicy::PAGED) ? paged_.size() : hash_.size();
+    }
+
+    [[nodiscard]] OrderNode *Find(boost::uint64_t id) const noexcept {
+        if (policy_ == OrderTablePolicy::PAGED)
+            return paged_.Find(id);
+
+        auto it = hash_.find(id);
+        return (it != hash_.end()) ? it->second : nullptr;
+    }
+
+    bool Insert(OrderNode *order_ptr) {
+        if (policy_ == OrderTablePolicy::PAGED)
+            return paged_.Insert(order_ptr);
+
+        return hash_.insert(std::make_pair(order_ptr->Id, order_ptr)).second;
+    }
+
+    bool Erase(boost::uint64_t id) noexcept {
+        if (policy_ == OrderTablePolicy::PAGED)
+            return paged_.Erase(id);
+
+        return hash_.erase(id) != 0;
+    }
+
+    template<typename Function>
+    void ForEach(Function function) const {
+        if (policy_ == OrderTablePolicy::PAGED) {
+            paged_.ForEach(function);
+            return;
+        }
+
+        for (auto &order: hash_)
+            function(order.second);
+    }
+
+    void clear() noexcept {
+        paged_.clear();
+        hash_.clear();
+    }
+
+private:
+    OrderTablePolicy policy_;
+    PagedOrderTable paged_;
+    boost::unordered_map<boost::uint64_t, OrderNode *> hash_;
+};
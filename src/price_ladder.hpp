@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+
+#include <boost/container/vector.hpp>
+
+#include "level.hpp"
+#include "occupancy_bitmap.hpp"
+
+// Dense price-indexed view over one side of a book. Slot i holds the level with price base + i * tick, so a lookup
+// is a subtraction and a division instead of a tree walk, and an occupancy bitmap over the slots finds the closest
+// populated neighbour however sparse the window is. Prices outside the window or off the tick grid are not indexed
+// and must be resolved through the owning LevelNodeSet. A default constructed ladder is disabled and covers no prices
+// at all.
+class PriceLadder {
+public:
+    PriceLadder() noexcept: tick_size_(1), base_(0), off_grid_(0) {
+    }
+
+    PriceLadder(boost::uint64_t tick_size, size_t size) : tick_size_(std::max<boost::uint64_t>(tick_size, 1)),
+                                                          base_(0),
+                                                          levels_(size, nullptr),
+                                                          occupied_(size),
+                                                          off_grid_(0) {
+    }
+
+    PriceLadder(const PriceLadder &) = delete;
+
+    PriceLadder(PriceLadder &&) = delete;
+
+    ~PriceLadder() = default;
+
+    PriceLadder &operator=(const PriceLadder &) = delete;
+
+    PriceLadder &operator=(PriceLadder &&) = delete;
+
+    [[nodiscard]] bool enabled() const noexcept { return !levels_.empty(); }
+
+    [[nodiscard]] boost::uint64_t tick_size() const noexcept { return tick_size_; }
+
+    [[nodiscard]] boost::uint64_t base() const noexcept { return base_; }
+
+    [[nodiscard]] size_t size() const noexcept { return levels_.size(); }
+
+    // Neighbour searches are only exact while every level of the side sits on the tick grid
+    [[nodiscard]] bool exact() const noexcept { return off_grid_ == 0; }
+
+    [[nodiscard]] bool InWindow(boost::uint64_t price) const noexcept {
+        return (price >= base_) && (((price - base_) / tick_size_) < levels_.size());
+    }
+
+    [[nodiscard]] bool Covers(boost::uint64_t price) const noexcept {
+        return InWindow(price) && (((price - base_) % tick_size_) == 0);
+    }
+
+    [[nodiscard]] LevelNode *Get(boost::uint64_t price) const noexcept { return levels_[Index(price)]; }
+
+    bool Insert(LevelNode *level_ptr) noexcept {
+        if (!enabled())
+            return false;
+
+        if ((level_ptr->Price % tick_size_) != 0) {
+            ++off_grid_;
+            return false;
+        }
+
+        if (!InWindow(level_ptr->Price))
+            return false;
+
+        size_t index = Index(level_ptr->Price);
+        levels_[index] = level_ptr;
+        occupied_.Set(index);
+        return true;
+    }
+
+    void Erase(LevelNode *level_ptr) noexcept {
+        if (!enabled())
+            return;
+
+        if ((level_ptr->Price % tick_size_) != 0) {
+            --off_grid_;
+            return;
+        }
+
+        if (InWindow(level_ptr->Price)) {
+            size_t index = Index(level_ptr->Price);
+            levels_[index] = nullptr;
+            occupied_.Reset(index);
+        }
+    }
+
+    // Closest indexed level strictly below the given covered price
+    [[nodiscard]] LevelNode *Lower(boost::uint64_t price) const noexcept {
+        size_t index = Index(price);
+        if (index == 0)
+            return nullptr;
+
+        index = occupied_.Previous(index - 1);
+        return (index != OccupancyBitmap::npos) ? levels_[index] : nullptr;
+    }
+
+    // Closest indexed level strictly above the given covered price
+    [[nodiscard]] LevelNode *Higher(boost::uint64_t price) const noexcept {
+        size_t index = occupied_.Next(Index(price) + 1);
+        return (index != OccupancyBitmap::npos) ? levels_[index] : nullptr;
+    }
+
+    // Moves the window so that it is centered around the given price and re-indexes the levels that fall into it
+    void Recenter(boost::uint64_t price, LevelNodeSet &levels) noexcept {
+        if (!enabled())
+            return;
+
+        for (size_t index = occupied_.Next(0); index != OccupancyBitmap::npos; index = occupied_.Next(index + 1)) {
+            levels_[index] = nullptr;
+            occupied_.Reset(index);
+        }
+
+        boost::uint64_t half = (levels_.size() / 2) * tick_size_;
+        boost::uint64_t center = price - (price % tick_size_);
+        base_ = (center > half) ? (center - half) : 0;
+
+        for (auto it = levels.lower_bound(base_, LevelPriceCompare()); it != levels.end(); ++it) {
+            if (!InWindow(it->Price))
+                break;
+            if (((it->Price - base_) % tick_size_) == 0) {
+                size_t index = Index(it->Price);
+                levels_[index] = it.operator->();
+                occupied_.Set(index);
+            }
+        }
+    }
+
+private:
+    boost::uint64_t tick_size_;
+    boost::uint64_t base_;
+    boost::container::vector<LevelNode *> levels_;
+    OccupancyBitmap occupied_;
+    size_t off_grid_;
+
+    [[nodiscard]] size_t Index(boost::uint64_t price) const noexcept { return (price - base_) / tick_size_; }
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstring>
+
+#include <boost/container/vector.hpp>
+#include <boost/cstdint.hpp>
+
+// Contiguous receive buffer for a byte stream. Reads are appended at the end, complete messages are consumed from the
+// front, and the partial tail of the last message stays in place until the rest of it arrives. The unread bytes are
+// moved back to the front only when the free space at the end runs out, and the storage grows only when the unread
+// bytes themselves do not leave room for the next read.
+class ReceiveBuffer {
+public:
+    explicit ReceiveBuffer(size_t capacity = 4096) : begin_(0), end_(0) {
+        buffer_.resize(capacity, boost::container::default_init);
+    }
+
+    ReceiveBuffer(const ReceiveBuffer &) = delete;
+
+    ReceiveBuffer(ReceiveBuffer &&) = delete;
+
+    ~ReceiveBuffer() = default;
+
+    ReceiveBuffer &operator=(const ReceiveBuffer &) = delete;
+
+    ReceiveBuffer &operator=(ReceiveBuffer &&) = delete;
+
+    [[nodiscard]] const boost::uint8_t *data() const noexcept { return buffer_.data() + begin_; }
+
+    [[nodiscard]] size_t size() const noexcept { return end_ - begin_; }
+
+    [[nodiscard]] bool empty() const noexcept { return begin_ == end_; }
+
+    [[nodiscard]] size_t capacity() const noexcept { return buffer_.size(); }
+
+    // Free space after the unread bytes
+    [[nodiscard]] size_t available() const noexcept { return buffer_.size() - end_; }
+
+    // Makes room for at least the given number of bytes after the unread ones and returns where they go
+    boost::uint8_t *Prepare(size_t size) {
+        if (available() < size) {
+            if (begin_ > 0) {
+                std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+                end_ -= begin_;
+                begin_ = 0;
+            }
+            if (available() < size)
+                buffer_.resize(std::max(buffer_.size() * 2, end_ + size), boost::container::default_init);
+        }
+        return buffer_.data() + end_;
+    }
+
+    void Commit(size_t size) noexcept { end_ += size; }
+
+    void Consume(size_t size) noexcept {
+        begin_ += size;
+        if (begin_ == end_)
+            begin_ = end_ = 0;
+    }
+
+private:
+    boost::container::vector<boost::uint8_t> buffer_;
+    size_t begin_;
+    size_t end_;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+
+#include <boost/container/vector.hpp>
+#include <boost/cstdint.hpp>
+
+// Replies handed to one gathered write, well below IOV_MAX
+constexpr size_t MaxGatheredReplies = 64;
+
+// Unanswered requests a session keeps; once they are all taken it stops handling requests until the client catches up
+// with its replies
+constexpr size_t MaxPendingReplies = 1024;
+
+// Keeps the replies of pipelined requests in request order. Every request reserves a slot when it is read; the reply
+// fills the slot whenever it is ready, which with engine shards may be out of order, and only the replies at the front
+// are handed to the socket. The slots form a fixed ring, so queued replies never move and the ready front can be written
+// straight from the queue in one gathered write, and a steady stream of requests does not allocate.
+template<typename T>
+class ReplyQueue {
+public:
+    explicit ReplyQueue(size_t capacity = MaxPendingReplies)
+            : slots_(std::bit_ceil(std::max<size_t>(capacity, 2))), mask_(slots_.size() - 1), first_(0), size_(0) {
+    }
+
+    ReplyQueue(const ReplyQueue &) = delete;
+
+    ReplyQueue(ReplyQueue &&) = delete;
+
+    ~ReplyQueue() = default;
+
+    ReplyQueue &operator=(const ReplyQueue &) = delete;
+
+    ReplyQueue &operator=(ReplyQueue &&) = delete;
+
+    [[nodiscard]] size_t capacity() const noexcept { return slots_.size(); }
+
+    // Requests read and not yet answered on the socket
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] bool full() const noexcept { return size_ == slots_.size(); }
+
+    [[nodiscard]] bool ready() const noexcept { return (size_ > 0) && slots_[first_ & mask_].Ready; }
+
+    [[nodiscard]] const T &front() const noexcept { return slots_[first_ & mask_].Reply; }
+
+    // Slot of a reserved sequence, no other request maps to it until its reply has been popped
+    [[nodiscard]] size_t Index(boost::uint64_t sequence) const noexcept { return sequence & mask_; }
+
+    // Only called while the queue is not full
+    boost::uint64_t Reserve() noexcept {
+        return first_ + size_++;
+    }
+
+    void Complete(boost::uint64_t sequence, T reply) {
+        Slot &slot = slots_[sequence & mask_];
+        slot.Reply = std::move(reply);
+        slot.Ready = true;
+    }
+
+    // Calls the function with every ready reply at the front, at most limit of them, and returns how many there were
+    template<typename Function>
+    size_t Gather(Function &&function, size_t limit) const {
+        size_t count = 0;
+        for (; (count < std::min(limit, size_)) && slots_[(first_ + count) & mask_].Ready; ++count)
+            function(slots_[(first_ + count) & mask_].Reply);
+        return count;
+    }
+
+    void Pop(size_t count = 1) noexcept {
+        for (size_t i = 0; i < count; ++i)
+            slots_[(first_ + i) & mask_].Ready = false;
+        first_ += count;
+        size_ -= count;
+    }
+
+private:
+    class Slot {
+    public:
+        T Reply{};
+        bool Ready = false;
+    };
+
+    boost::container::vector<Slot> slots_;
+    size_t mask_;
+    boost::uint64_t first_;
+    size_t size_;
+};
@@ -0,0 +1,193 @@
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include "sharded_engine.hpp"
+
+ShardedEngine::ShardedEngine(size_t shards, size_t producers, size_t queue_size,
+                             OrderTablePolicy order_table_policy) : producers_(std::max<size_t>(producers, 1)),
+                                                                    running_(false) {
+    for (size_t shard = 0; shard < std::max<size_t>(shards, 1); ++shard) {
+        auto *shard_ptr = new Shard(order_table_policy);
+        for (size_t producer = 0; producer < producers_; ++producer)
+            shard_ptr->Queues.push_back(new EngineCommandQueue(queue_size));
+        shards_.push_back(shard_ptr);
+    }
+}
+
+ShardedEngine::~ShardedEngine() {
+    Stop();
+
+    for (auto &shard_ptr: shards_) {
+        for (auto &queue_ptr: shard_ptr->Queues)
+            delete queue_ptr;
+        delete shard_ptr;
+    }
+    shards_.clear();
+}
+
+ErrorCode ShardedEngine::AddSymbol(const Symbol &symbol, const OrderBookOptions &options) {
+    MarketManager &market_manager = shards_[GetShard(symbol.Id)]->Manager;
+
+    ErrorCode result = market_manager.AddSymbol(symbol);
+    if (result != ErrorCode::OK)
+        return result;
+
+    return market_manager.AddOrderBook(symbol, options);
+}
+
+void ShardedEngine::Start(bool pin) {
+    if (running_.exchange(true))
+        return;
+
+    unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        Shard *shard_ptr = shards_[shard];
+        shard_ptr->Thread = std::thread(&ShardedEngine::Run, this, shard_ptr);
+
+#if defined(__linux__)
+        if (pin) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(shard % cores, &cpus);
+            pthread_setaffinity_np(shard_ptr->Thread.native_handle(), sizeof(cpus), &cpus);
+        }
+#endif
+    }
+}
+
+void ShardedEngine::Stop() {
+    if (!running_.exchange(false))
+        return;
+
+    for (auto &shard_ptr: shards_)
+        shard_ptr->Thread.join();
+}
+
+void ShardedEngine::AddOrder(size_t producer, const Order &order, EngineCallback callback, void *context) {
+    EngineCommand command{EngineCommandType::ADD_ORDER, order, order.Id, order.SymbolId, order.UserId, 0, 0, 0,
+                          callback, context};
+    Submit(producer, GetShard(order.SymbolId), command);
+}
+
+void ShardedEngine::DeleteOrder(size_t producer, boost::uint64_t symbol_id, boost::uint64_t order_id,
+                                boost::uint64_t user_id, EngineCallback callback, void *context) {
+    EngineCommand command{EngineCommandType::DELETE_ORDER, Order(), order_id, symbol_id, user_id, 0, 0, 0, callback,
+                          context};
+    Submit(producer, GetShard(symbol_id), command);
+}
+
+void ShardedEngine::ReplaceOrder(size_t producer, boost::uint64_t symbol_id, boost::uint64_t order_id,
+                                 boost::uint64_t user_id, boost::uint64_t new_order_id, boost::uint64_t price,
+                                 boost::uint64_t quantity, EngineCallback callback, void *context) {
+    EngineCommand command{EngineCommandType::REPLACE_ORDER, Order(), order_id, symbol_id, user_id, new_order_id,
+                          price, quantity, callback, context};
+    Submit(producer, GetShard(symbol_id), command);
+}
+
+void ShardedEngine::ModifyOrder(size_t producer, boost::uint64_t symbol_id, boost::uint64_t order_id,
+                                boost::uint64_t user_id, boost::uint64_t price, boost::uint64_t quantity,
+                                EngineCallback callback, void *context) {
+    EngineCommand command{EngineCommandType::MODIFY_ORDER, Order(), order_id, symbol_id, user_id, 0, price, quantity,
+                          callback, context};
+    Submit(producer, GetShard(symbol_id), command);
+}
+
+void ShardedEngine::CancelAllOrders(size_t producer, boost::uint64_t user_id, EngineCallback callback,
+                                    void *context) {
+    Broadcast(producer, {EngineCommandType::CANCEL_ALL_ORDERS, Order(), 0, 0, user_id, 0, 0, 0, callback, context});
+}
+
+void ShardedEngine::AddUser(size_t producer, boost::uint64_t user_id, EngineCallback callback, void *context) {
+    Broadcast(producer, {EngineCommandType::ADD_USER, Order(), 0, 0, user_id, 0, 0, 0, callback, context});
+}
+
+void ShardedEngine::GetBalance(size_t producer, boost::uint64_t user_id, EngineCallback callback, void *context) {
+    Broadcast(producer, {EngineCommandType::GET_BALANCE, Order(), 0, 0, user_id, 0, 0, 0, callback, context});
+}
+
+void ShardedEngine::Run(Shard *shard_ptr) {
+    MarketManager &market_manager = shard_ptr->Manager;
+    auto execute = [&market_manager](const EngineCommand &command) { Execute(market_manager, command); };
+
+    size_t idle = 0;
+    while (running_.load(std::memory_order_acquire)) {
+        size_t count = 0;
+        for (auto &queue_ptr: shard_ptr->Queues)
+            count += queue_ptr->Drain(execute);
+
+        if (count > 0) {
+            idle = 0;
+        } else if (++idle < EngineCommandQueue::MaxSpins) {
+            CpuPause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto &queue_ptr: shard_ptr->Queues)
+        queue_ptr->Drain(execute);
+}
+
+void ShardedEngine::Execute(MarketManager &market_manager, const EngineCommand &command) {
+    ErrorCode result = ErrorCode::OK;
+    boost::int64_t value = 0;
+
+    switch (command.Type) {
+        case EngineCommandType::ADD_ORDER:
+            result = market_manager.AddOrder(command.OrderData);
+            break;
+        case EngineCommandType::DELETE_ORDER: {
+            const Order *order_ptr = market_manager.GetOrder(command.OrderId);
+            if ((order_ptr == nullptr) || (order_ptr->SymbolId != command.SymbolId)) {
+                result = ErrorCode::ORDER_NOT_FOUND;
+                break;
+            }
+
+            result = market_manager.DeleteOrder(command.OrderId, command.UserId);
+            break;
+        }
+        case EngineCommandType::REPLACE_ORDER: {
+            const Order *order_ptr = market_manager.GetOrder(command.OrderId);
+            if ((order_ptr == nullptr) || (order_ptr->UserId != command.UserId) ||
+                (order_ptr->SymbolId != command.SymbolId)) {
+                result = ErrorCode::ORDER_NOT_FOUND;
+                break;
+            }
+
+            OrderSide side = order_ptr->Side;
+            market_manager.DeleteOrder(command.OrderId);
+            result = market_manager.AddOrder(Order(command.NewOrderId, command.SymbolId, command.UserId, side,
+                                                   command.Price, 0, command.Quantity));
+            break;
+        }
+        case EngineCommandType::MODIFY_ORDER: {
+            const Order *order_ptr = market_manager.GetOrder(command.OrderId);
+            if ((order_ptr == nullptr) || (order_ptr->SymbolId != command.SymbolId)) {
+                result = ErrorCode::ORDER_NOT_FOUND;
+                break;
+            }
+
+            result = market_manager.ModifyOrder(command.OrderId, command.UserId, command.Price, command.Quantity);
+            break;
+        }
+        case EngineCommandType::CANCEL_ALL_ORDERS:
+            value = boost::int64_t(market_manager.CancelAllOrders(command.UserId));
+            break;
+        case EngineCommandType::ADD_USER:
+            result = market_manager.AddUser(User(command.UserId));
+            break;
+        case EngineCommandType::GET_BALANCE: {
+            const User *user_ptr = market_manager.GetUser(command.UserId);
+            if (user_ptr != nullptr)
+                value = user_ptr->Balance;
+            else
+                result = ErrorCode::USER_NOT_FOUND;
+            break;
+        }
+    }
+
+    if (command.Callback != nullptr)
+        command.Callback(command.Context, result, value);
+}
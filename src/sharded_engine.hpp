@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include <boost/container/vector.hpp>
+
+#include "market_manager.hpp"
+#include "spsc_ring.hpp"
+
+enum class EngineCommandType : boost::uint8_t {
+    ADD_ORDER,
+    DELETE_ORDER,
+    REPLACE_ORDER,
+    MODIFY_ORDER,
+    CANCEL_ALL_ORDERS,
+    ADD_USER,
+    GET_BALANCE
+};
+
+// Called on the shard thread once the command has been executed. Value carries the user balance held by the shard
+// for GET_BALANCE, the number of orders the shard cancelled for CANCEL_ALL_ORDERS and is zero otherwise.
+typedef void (*EngineCallback)(void *context, ErrorCode result, boost::int64_t value);
+
+// MODIFY_ORDER carries the new price and quantity in Price and Quantity. REPLACE_ORDER carries the id, price and
+// quantity of the new order in NewOrderId, Price and Quantity; the shard builds it once it knows the side of the
+// replaced order.
+class EngineCommand {
+public:
+    EngineCommandType Type;
+    Order OrderData;
+    boost::uint64_t OrderId;
+    boost::uint64_t SymbolId;
+    boost::uint64_t UserId;
+    boost::uint64_t NewOrderId;
+    boost::uint64_t Price;
+    boost::uint64_t Quantity;
+    EngineCallback Callback;
+    void *Context;
+};
+
+typedef SpscRing<EngineCommand> EngineCommandQueue;
+
+// Matching engine partitioned by symbol. Every shard runs on its own thread with a private MarketManager, so the
+// books, the order table and the pools of a symbol are only ever touched by one thread. Commands reach a shard through
+// one SPSC queue per producer thread and shard, which keeps submission lock-free as long as every producer uses its
+// own index. Users exist on every shard: ADD_USER, GET_BALANCE and CANCEL_ALL_ORDERS are broadcast, their callback
+// fires once per shard, and a user balance is the sum of the per-shard values.
+class ShardedEngine {
+public:
+    ShardedEngine(size_t shards, size_t producers = 1, size_t queue_size = 65536,
+                  OrderTablePolicy order_table_policy = OrderTablePolicy::PAGED);
+
+    ShardedEngine(const ShardedEngine &) = delete;
+
+    ShardedEngine(ShardedEngine &&) = delete;
+
+    ~ShardedEngine();
+
+    ShardedEngine &operator=(const ShardedEngine &) = delete;
+
+    ShardedEngine &operator=(ShardedEngine &&) = delete;
+
+    [[nodiscard]] size_t shards() const noexcept { return shards_.size(); }
+
+    [[nodiscard]] size_t producers() const noexcept { return producers_; }
+
+    [[nodiscard]] size_t GetShard(boost::uint64_t symbol_id) const noexcept { return symbol_id % shards_.size(); }
+
+    // Only safe to inspect while the engine is stopped
+    [[nodiscard]] const MarketManager &market_manager(size_t shard) const noexcept {
+        return shards_[shard]->Manager;
+    }
+
+    // Adds the latency stats of every shard, safe while the engine runs since each shard records into its own stats
+    // and their symbols are all set up before it starts
+    void MergeLatencyStats(LatencyStats &stats) const {
+        for (auto &shard_ptr: shards_)
+            stats.Merge(shard_ptr->Manager.latency_stats());
+    }
+
+    // Symbols are set up before the engine starts
+    ErrorCode AddSymbol(const Symbol &symbol, const OrderBookOptions &options = OrderBookOptions());
+
+    // Starts one matching thread per shard, pinned to cores in shard order when requested
+    void Start(bool pin = false);
+
+    // Executes everything already queued and joins the matching threads
+    void Stop();
+
+    void AddOrder(size_t producer, const Order &order, EngineCallback callback = nullptr, void *context = nullptr);
+
+    // Fails with ORDER_NOT_FOUND unless the order belongs to the given user and symbol
+    void DeleteOrder(size_t producer, boost::uint64_t symbol_id, boost::uint64_t order_id, boost::uint64_t user_id,
+                     EngineCallback callback = nullptr, void *context = nullptr);
+
+    // Deletes an order of the user and adds a new limit order on the same side in its place. Fails with
+    // ORDER_NOT_FOUND unless the order belongs to the given user and symbol.
+    void ReplaceOrder(size_t producer, boost::uint64_t symbol_id, boost::uint64_t order_id, boost::uint64_t user_id,
+                      boost::uint64_t new_order_id, boost::uint64_t price, boost::uint64_t quantity,
+                      EngineCallback callback = nullptr, void *context = nullptr);
+
+    // Fails with ORDER_NOT_FOUND unless the order belongs to the given user and symbol
+    void ModifyOrder(size_t producer, boost::uint64_t symbol_id, boost::uint64_t order_id, boost::uint64_t user_id,
+                     boost::uint64_t price, boost::uint64_t quantity, EngineCallback callback = nullptr,
+                     void *context = nullptr);
+
+    // Cancels every open order of the user on every shard
+    void CancelAllOrders(size_t producer, boost::uint64_t user_id, EngineCallback callback = nullptr,
+                         void *context = nullptr);
+
+    void AddUser(size_t producer, boost::uint64_t user_id, EngineCallback callback = nullptr,
+                 void *context = nullptr);
+
+    void GetBalance(size_t producer, boost::uint64_t user_id, EngineCallback callback, void *context);
+
+private:
+    class Shard {
+    public:
+        MarketManager Manager;
+        boost::container::vector<EngineCommandQueue *> Queues;
+        std::thread Thread;
+
+        explicit Shard(OrderTablePolicy order_table_policy) : Manager(order_table_policy) {
+        }
+    };
+
+    boost::container::vector<Shard *> shards_;
+    size_t producers_;
+    std::atomic<bool> running_;
+
+    void Submit(size_t producer, size_t shard, const EngineCommand &command) noexcept {
+        shards_[shard]->Queues[producer]->Push(command);
+    }
+
+    void Broadcast(size_t producer, const EngineCommand &command) noexcept {
+        for (size_t shard = 0; shard < shards_.size(); ++shard)
+            Submit(producer, shard, command);
+    }
+
+    void Run(Shard *shard_ptr);
+
+    static void Execute(MarketManager &market_manager, const EngineCommand &command);
+};
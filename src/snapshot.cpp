@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/container/vector.hpp>
+
+#include "market_manager.hpp"
+#include "snapshot.hpp"
+
+namespace {
+
+constexpr size_t Padding(size_t size) noexcept {
+    return (Snapshot::RecordAlignment - size % Snapshot::RecordAlignment) % Snapshot::RecordAlignment;
+}
+
+// Buffered sequential writer, a failed write is thrown
+class SnapshotWriter {
+public:
+    static constexpr size_t BufferSize = size_t(1) << 20;
+
+    explicit SnapshotWriter(int fd) : fd_(fd), buffer_(BufferSize, boost::container::default_init), used_(0),
+                                      size_(0) {
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    template<typename T>
+    void Write(const T &value) {
+        Write(&value, sizeof(value));
+    }
+
+    void Write(const void *data, size_t size) {
+        if (used_ + size > buffer_.size())
+            Flush();
+
+        if (size > buffer_.size()) {
+            WriteFully(static_cast<const boost::uint8_t *>(data), size);
+        } else {
+            std::memcpy(buffer_.data() + used_, data, size);
+            used_ += size;
+        }
+        size_ += size;
+    }
+
+    void WriteName(const std::string &name) {
+        static const boost::uint8_t zeros[Snapshot::RecordAlignment] = {};
+        Write(name.data(), name.size());
+        Write(zeros, Padding(name.size()));
+    }
+
+    void Flush() {
+        WriteFully(buffer_.data(), used_);
+        used_ = 0;
+    }
+
+private:
+    int fd_;
+    boost::container::vector<boost::uint8_t> buffer_;
+    size_t used_;
+    size_t size_;
+
+    void WriteFully(const boost::uint8_t *data, size_t size) {
+        while (size > 0) {
+            ssize_t written = write(fd_, data, size);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::system_category(), "Cannot write snapshot");
+            }
+            data += written;
+            size -= size_t(written);
+        }
+    }
+};
+
+template<typename T>
+T Read(const boost::uint8_t *&data, const boost::uint8_t *end) {
+    if (size_t(end - data) < sizeof(T))
+        throw std::runtime_error("Truncated snapshot");
+
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return value;
+}
+
+std::string ReadName(const boost::uint8_t *&data, const boost::uint8_t *end, size_t size) {
+    if ((size > size_t(end - data)) || (Padding(size) > size_t(end - data) - size))
+        throw std::runtime_error("Truncated snapshot");
+
+    std::string name(reinterpret_cast<const char *>(data), size);
+    data += size + Padding(size);
+    return name;
+}
+
+void SyncDirectory(const std::string &path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot open snapshot directory");
+
+    int result = fsync(fd);
+    int error = errno;
+    close(fd);
+    if (result != 0)
+        throw std::system_error(error, std::system_category(), "Cannot sync snapshot directory");
+}
+
+}
+
+void Snapshot::Save(const MarketManager &market_manager, const std::string &path, boost::uint64_t sequence) {
+    std::string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot create snapshot " + temporary_path);
+
+    try {
+        SnapshotHeader header{SnapshotHeader::SnapshotMagic, SnapshotHeader::SnapshotVersion, 0, sequence,
+                              market_manager.GetOrdersCount(), 0, 0, 0, 0, market_manager.orders().size()};
+        for (auto &symbol_ptr: market_manager.symbols())
+            header.Symbols += (symbol_ptr != nullptr);
+        for (auto &user_ptr: market_manager.users())
+            header.Users += (user_ptr != nullptr);
+        for (auto &order_book_ptr: market_manager.order_books()) {
+            if (order_book_ptr == nullptr)
+                continue;
+            ++header.OrderBooks;
+            header.Levels += order_book_ptr->bids().size() + order_book_ptr->asks().size() +
+                             order_book_ptr->buy_stop().size() + order_book_ptr->sell_stop().size() +
+                             order_book_ptr->trailing_buy_stop().size() + order_book_ptr->trailing_sell_stop().size();
+        }
+
+        SnapshotWriter writer(fd);
+        writer.Write(header);
+
+        for (auto &symbol_ptr: market_manager.symbols()) {
+            if (symbol_ptr == nullptr)
+                continue;
+            writer.Write(SnapshotSymbol{symbol_ptr->Id, symbol_ptr->Name.size()});
+            writer.WriteName(symbol_ptr->Name);
+        }
+
+        for (auto &user_ptr: market_manager.users()) {
+            if (user_ptr == nullptr)
+                continue;
+            writer.Write(SnapshotUser{user_ptr->Id, user_ptr->Balance, user_ptr->Name.size()});
+            writer.WriteName(user_ptr->Name);
+        }
+
+        for (auto &order_book_ptr: market_manager.order_books()) {
+            if (order_book_ptr == nullptr)
+                continue;
+
+            const LevelNodeSet *sides[SnapshotOrderBook::Sides] = {
+                    &order_book_ptr->bids(), &order_book_ptr->asks(), &order_book_ptr->buy_stop(),
+                    &order_book_ptr->sell_stop(), &order_book_ptr->trailing_buy_stop(),
+                    &order_book_ptr->trailing_sell_stop()};
+
+            const OrderBookOptions &options = order_book_ptr->options();
+            SnapshotOrderBook book{order_book_ptr->symbol().Id, options.Layout, options.TickSize, options.LadderSize,
+                                   order_book_ptr->last_bid_price_, order_book_ptr->last_ask_price_,
+                                   order_book_ptr->trailing_bid_price_, order_book_ptr->trailing_ask_price_,
+                                   order_book_ptr->trailing_sequence_, {}};
+            for (size_t side = 0; side < SnapshotOrderBook::Sides; ++side)
+                book.Levels[side] = sides[side]->size();
+            writer.Write(book);
+
+            for (auto &levels: sides) {
+                for (auto &level: *levels) {
+                    writer.Write(SnapshotLevel{level.Price, level.Orders});
+                    for (auto &order: level.OrderList)
+                        writer.Write(SnapshotOrder{order.Id, order.UserId, order.Side, order.Type, order.Price,
+                                                   order.StopPrice, order.Quantity, order.ExecutedQuantity,
+                                                   order.LeavesQuantity, order.MaxVisibleQuantity,
+                                                   order.TrailingDistance, order.TrailingStep,
+                                                   order.TrailingSequence});
+                }
+            }
+        }
+
+        writer.Write(SnapshotTrailer{SnapshotHeader::SnapshotMagic, writer.size() + sizeof(SnapshotTrailer)});
+        writer.Flush();
+
+        if (fdatasync(fd) != 0)
+            throw std::system_error(errno, std::system_category(), "Cannot sync snapshot");
+    } catch (...) {
+        close(fd);
+        unlink(temporary_path.c_str());
+        throw;
+    }
+
+    if (close(fd) != 0)
+        throw std::system_error(errno, std::system_category(), "Cannot close snapshot");
+
+    if (rename(temporary_path.c_str(), path.c_str()) != 0)
+        throw std::system_error(errno, std::system_category(), "Cannot replace snapshot " + path);
+
+    SyncDirectory(path);
+}
+
+boost::uint64_t Snapshot::Load(MarketManager &market_manager, const std::string &path) {
+    auto is_set = [](const auto *ptr) { return ptr != nullptr; };
+    if (std::any_of(market_manager.symbols_.begin(), market_manager.symbols_.end(), is_set) ||
+        std::any_of(market_manager.users_.begin(), market_manager.users_.end(), is_set) ||
+        !market_manager.orders_.empty())
+        throw std::logic_error("Snapshots are only loaded into an empty market manager");
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot open snapshot " + path);
+
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::system_category(), "Cannot open snapshot " + path);
+    }
+
+    auto size = size_t(status.st_size);
+    if (size < sizeof(SnapshotHeader) + sizeof(SnapshotTrailer)) {
+        close(fd);
+        throw std::runtime_error("Truncated snapshot " + path);
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw std::system_error(error, std::system_category(), "Cannot map snapshot " + path);
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    class Unmap {
+    public:
+        void *Mapping;
+        size_t Size;
+
+        ~Unmap() { munmap(Mapping, Size); }
+    } unmap{mapping, size};
+
+    const auto *data = static_cast<const boost::uint8_t *>(mapping);
+    const boost::uint8_t *end = data + size - sizeof(SnapshotTrailer);
+
+    auto header = Read<SnapshotHeader>(data, end);
+    SnapshotTrailer trailer{};
+    std::memcpy(&trailer, end, sizeof(trailer));
+    if ((header.Magic != SnapshotHeader::SnapshotMagic) || (header.Version != SnapshotHeader::SnapshotVersion) ||
+        (trailer.Magic != SnapshotHeader::SnapshotMagic) || (trailer.Size != size))
+        throw std::runtime_error("Invalid snapshot " + path);
+
+    market_manager.order_pool_.Reserve(market_manager.order_pool_stats().Used + header.Orders);
+    market_manager.level_pool_.Reserve(market_manager.level_pool_stats().Used + header.Levels);
+
+    for (boost::uint64_t i = 0; i < header.Symbols; ++i) {
+        auto symbol = Read<SnapshotSymbol>(data, end);
+        std::string name = ReadName(data, end, symbol.NameSize);
+        if (market_manager.GetSymbol(symbol.Id) != nullptr)
+            throw std::runtime_error("Duplicate symbol in snapshot " + path);
+        if (market_manager.symbols_.size() <= symbol.Id)
+            market_manager.symbols_.resize(symbol.Id + 1, nullptr);
+        market_manager.symbols_[symbol.Id] = new Symbol(symbol.Id, std::move(name));
+    }
+
+    for (boost::uint64_t i = 0; i < header.Users; ++i) {
+        auto user = Read<SnapshotUser>(data, end);
+        std::string name = ReadName(data, end, user.NameSize);
+        if (market_manager.GetUser(user.Id) != nullptr)
+            throw std::runtime_error("Duplicate user in snapshot " + path);
+        if (market_manager.users_.size() <= user.Id)
+            market_manager.users_.resize(user.Id + 1, nullptr);
+        auto *user_ptr = new User(user.Id, std::move(name));
+        user_ptr->Balance = user.Balance;
+        market_manager.users_[user.Id] = user_ptr;
+    }
+
+    for (boost::uint64_t i = 0; i < header.OrderBooks; ++i)
+        LoadOrderBook(market_manager, data, end);
+
+    // The books link the orders of every user in book order; ids are handed out as orders are entered, so sorting by
+    // id restores the entry order the user lists keep
+    for (auto &user_orders_ptr: market_manager.user_orders_)
+        if (user_orders_ptr != nullptr)
+            user_orders_ptr->sort([](const OrderNode &order1, const OrderNode &order2) {
+                return order1.Id < order2.Id;
+            });
+
+    if ((data != end) || (market_manager.orders_.size() != header.Orders))
+        throw std::runtime_error("Invalid snapshot " + path);
+
+    market_manager.orders_count_ = header.OrdersCount;
+
+    return header.Sequence;
+}
+
+void Snapshot::LoadOrderBook(MarketManager &market_manager, const boost::uint8_t *&data, const boost::uint8_t *end) {
+    auto book = Read<SnapshotOrderBook>(data, end);
+
+    const Symbol *symbol_ptr = market_manager.GetSymbol(book.SymbolId);
+    if ((symbol_ptr == nullptr) || (market_manager.GetOrderBook(book.SymbolId) != nullptr))
+        throw std::runtime_error("Invalid order book in snapshot");
+
+    auto *order_book_ptr = new OrderBook(*symbol_ptr, market_manager.level_pool_,
+                                         OrderBookOptions(book.Layout, book.TickSize, size_t(book.LadderSize)));
+    if (market_manager.order_books_.size() <= book.SymbolId)
+        market_manager.order_books_.resize(book.SymbolId + 1, nullptr);
+    market_manager.order_books_[book.SymbolId] = order_book_ptr;
+    market_manager.latency_stats_.AddSymbol(book.SymbolId);
+
+    order_book_ptr->last_bid_price_ = book.LastBidPrice;
+    order_book_ptr->last_ask_price_ = book.LastAskPrice;
+    order_book_ptr->trailing_bid_price_ = book.TrailingBidPrice;
+    order_book_ptr->trailing_ask_price_ = book.TrailingAskPrice;
+    order_book_ptr->trailing_sequence_ = book.TrailingSequence;
+
+    LevelNodeSet *sides[SnapshotOrderBook::Sides] = {
+            &order_book_ptr->bids_, &order_book_ptr->asks_, &order_book_ptr->buy_stop_, &order_book_ptr->sell_stop_,
+            &order_book_ptr->trailing_buy_stop_, &order_book_ptr->trailing_sell_stop_};
+    PriceLadder *ladders[SnapshotOrderBook::Sides] = {
+            &order_book_ptr->bid_ladder_, &order_book_ptr->ask_ladder_, &order_book_ptr->buy_stop_ladder_,
+            &order_book_ptr->sell_stop_ladder_, &order_book_ptr->trailing_buy_stop_ladder_,
+            &order_book_ptr->trailing_sell_stop_ladder_};
+    LevelNode **bests[SnapshotOrderBook::Sides] = {
+            &order_book_ptr->best_bid_, &order_book_ptr->best_ask_, &order_book_ptr->best_buy_stop_,
+            &order_book_ptr->best_sell_stop_, &order_book_ptr->best_trailing_buy_stop_,
+            &order_book_ptr->best_trailing_sell_stop_};
+    // Bids and sell stops are bid levels, best at their highest price; the other sides are best at their lowest
+    const LevelType level_types[SnapshotOrderBook::Sides] = {LevelType::BID, LevelType::ASK, LevelType::ASK,
+                                                             LevelType::BID, LevelType::ASK, LevelType::BID};
+    const OrderType types[SnapshotOrderBook::Sides] = {OrderType::LIMIT, OrderType::LIMIT, OrderType::STOP_LIMIT,
+                                                       OrderType::STOP_LIMIT, OrderType::TRAILING_STOP_LIMIT,
+                                                       OrderType::TRAILING_STOP_LIMIT};
+
+    for (size_t side = 0; side < SnapshotOrderBook::Sides; ++side) {
+        LevelNodeSet &levels = *sides[side];
+        OrderSide order_side = ((side % 2) == 0) ? OrderSide::BUY : OrderSide::SELL;
+        LevelType level_type = level_types[side];
+
+        for (boost::uint64_t i = 0; i < book.Levels[side]; ++i) {
+            auto level = Read<SnapshotLevel>(data, end);
+            if ((level.Orders == 0) || (!levels.empty() && (level.Price <= levels.rbegin()->Price)))
+                throw std::runtime_error("Invalid level in snapshot");
+
+            LevelNode *level_ptr = market_manager.level_pool_.Create(level_type, level.Price);
+            levels.push_back(*level_ptr);
+            ladders[side]->Insert(level_ptr);
+
+            for (boost::uint64_t j = 0; j < level.Orders; ++j) {
+                auto order = Read<SnapshotOrder>(data, end);
+                boost::uint64_t level_price = (types[side] == OrderType::LIMIT) ? order.Price : order.StopPrice;
+                if ((order.Side != order_side) || (order.Type != types[side]) || (level_price != level.Price) ||
+                    (order.LeavesQuantity == 0) || (market_manager.GetUser(order.UserId) == nullptr))
+                    throw std::runtime_error("Invalid order in snapshot");
+
+                Order new_order(order.Id, book.SymbolId, order.UserId, order.Side, order.Price, order.StopPrice,
+                                order.Quantity, order.MaxVisibleQuantity, order.TrailingDistance, order.TrailingStep);
+                new_order.Type = order.Type;
+                new_order.ExecutedQuantity = order.ExecutedQuantity;
+                new_order.LeavesQuantity = order.LeavesQuantity;
+
+                OrderNode *order_ptr = market_manager.order_pool_.Create(new_order);
+                if (!market_manager.InsertOrder(order_ptr)) {
+                    market_manager.order_pool_.Release(order_ptr);
+                    throw std::runtime_error("Duplicate order in snapshot");
+                }
+
+                level_ptr->TotalVolume += order_ptr->LeavesQuantity;
+                level_ptr->HiddenVolume += order_ptr->HiddenQuantity();
+                level_ptr->VisibleVolume += order_ptr->VisibleQuantity();
+                level_ptr->OrderList.push_back(*order_ptr);
+                ++level_ptr->Orders;
+                order_ptr->Level = level_ptr;
+                order_ptr->TrailingSequence = order.TrailingSequence;
+
+                if (order_ptr->IsTrailingStopLimit() &&
+                    OrderBook::CalculateTrailingStopKey(*order_ptr, order_ptr->TrailingKey))
+                    (order_ptr->IsBuy() ? order_book_ptr->trailing_buy_index_
+                                        : order_book_ptr->trailing_sell_index_).insert(*order_ptr);
+            }
+        }
+
+        if (levels.empty())
+            continue;
+
+        *bests[side] = (level_type == LevelType::BID) ? &*levels.rbegin() : &*levels.begin();
+        ladders[side]->Recenter((*bests[side])->Price, levels);
+    }
+
+    order_book_ptr->PublishTopOfBook();
+}
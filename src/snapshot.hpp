@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include "order.hpp"
+#include "order_book.hpp"
+
+class MarketManager;
+
+// On-disk format of a market manager snapshot: a header, the symbols, the users and then every order book, all in
+// host byte order and without padding between the fixed parts. Names follow their record and are padded to
+// RecordAlignment. A book lists the levels of its six sides (bids, asks, buy stops, sell stops, trailing buy stops,
+// trailing sell stops) in ascending price order, each level followed by its orders in time priority. The file ends
+// with the trailer.
+#pragma pack(push, 1)
+
+class SnapshotHeader {
+public:
+    static constexpr boost::uint64_t SnapshotMagic = 0x31504e5358584553;  // "SEXXSNP1"
+    static constexpr boost::uint32_t SnapshotVersion = 1;
+
+    boost::uint64_t Magic;
+    boost::uint32_t Version;
+    boost::uint32_t Reserved;
+    // Journal sequence of the last command the snapshot contains
+    boost::uint64_t Sequence;
+    boost::uint64_t OrdersCount;
+    boost::uint64_t Symbols;
+    boost::uint64_t Users;
+    boost::uint64_t OrderBooks;
+    boost::uint64_t Levels;
+    boost::uint64_t Orders;
+};
+
+class SnapshotSymbol {
+public:
+    boost::uint64_t Id;
+    boost::uint64_t NameSize;
+};
+
+class SnapshotUser {
+public:
+    boost::uint64_t Id;
+    boost::int64_t Balance;
+    boost::uint64_t NameSize;
+};
+
+class SnapshotOrderBook {
+public:
+    static constexpr size_t Sides = 6;
+
+    boost::uint64_t SymbolId;
+    OrderBookLayout Layout;
+    boost::uint64_t TickSize;
+    boost::uint64_t LadderSize;
+    boost::uint64_t LastBidPrice;
+    boost::uint64_t LastAskPrice;
+    boost::uint64_t TrailingBidPrice;
+    boost::uint64_t TrailingAskPrice;
+    boost::uint64_t TrailingSequence;
+    boost::uint64_t Levels[Sides];
+};
+
+class SnapshotLevel {
+public:
+    boost::uint64_t Price;
+    boost::uint64_t Orders;
+};
+
+class SnapshotOrder {
+public:
+    boost::uint64_t Id;
+    boost::uint64_t UserId;
+    OrderSide Side;
+    OrderType Type;
+    boost::uint64_t Price;
+    boost::uint64_t StopPrice;
+    boost::uint64_t Quantity;
+    boost::uint64_t ExecutedQuantity;
+    boost::uint64_t LeavesQuantity;
+    boost::uint64_t MaxVisibleQuantity;
+    boost::int64_t TrailingDistance;
+    boost::int64_t TrailingStep;
+    boost::uint64_t TrailingSequence;
+};
+
+class SnapshotTrailer {
+public:
+    boost::uint64_t Magic;
+    boost::uint64_t Size;
+};
+
+#pragma pack(pop)
+
+// Point-in-time copy of the symbols, order books, orders and users of a market manager. Saving streams the state out
+// through one buffer into a temporary file that replaces the snapshot once it is synced. Loading maps the file and
+// rebuilds every book in bulk: levels are appended to the level sets in price order and orders to their queues in time
+// priority straight from the pools, without matching, so restoring millions of resting orders is a single pass over
+// the file. The per-user order lists are put back in entry order by sorting them by id once the books are built.
+// I/O errors are thrown as std::system_error, malformed snapshots as std::runtime_error.
+class Snapshot {
+public:
+    static constexpr size_t RecordAlignment = 8;
+
+    // Sequence is stored as the journal sequence the state corresponds to
+    static void Save(const MarketManager &market_manager, const std::string &path, boost::uint64_t sequence = 0);
+
+    // Loads into a market manager that has no symbols, users or orders yet and returns the stored sequence
+    static boost::uint64_t Load(MarketManager &market_manager, const std::string &path);
+
+private:
+    static void LoadOrderBook(MarketManager &market_manager, const boost::uint8_t *&data, const boost::uint8_t *end);
+};
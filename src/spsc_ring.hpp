@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <thread>
+#include <type_traits>
+
+#include <boost/container/vector.hpp>
+
+constexpr size_t CacheLineSize = 64;
+
+// Spin-wait hint for busy loops
+inline void CpuPause() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Bounded single-producer/single-consumer queue. The capacity is rounded up to a power of two and fixed at
+// construction, so pushing and popping never allocate. Each side keeps its own index on a separate cache line
+// together with a cached copy of the other side's index, and only reloads the shared one when the cached copy says
+// the ring is full (producer) or empty (consumer).
+template<typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>, "Ring elements must be trivially copyable");
+
+public:
+    static constexpr size_t MaxSpins = 1024;
+
+    explicit SpscRing(size_t capacity) : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+                                         write_index_(0),
+                                         cached_read_index_(0),
+                                         read_index_(0),
+                                         cached_write_index_(0),
+                                         slots_(mask_ + 1) {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+
+    SpscRing(SpscRing &&) = delete;
+
+    ~SpscRing() = default;
+
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    SpscRing &operator=(SpscRing &&) = delete;
+
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Approximate when called concurrently with the other side
+    [[nodiscard]] size_t size() const noexcept {
+        return write_index_.load(std::memory_order_acquire) - read_index_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Producer side
+    bool TryPush(const T &value) noexcept {
+        size_t write_index = write_index_.load(std::memory_order_relaxed);
+        if ((write_index - cached_read_index_) > mask_) {
+            cached_read_index_ = read_index_.load(std::memory_order_acquire);
+            if ((write_index - cached_read_index_) > mask_)
+                return false;
+        }
+
+        slots_[write_index & mask_] = value;
+        write_index_.store(write_index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side, waits for the consumer while the ring is full. The wait spins for a while and then gives up the
+    // time slice, so that a consumer sharing the core can make progress.
+    void Push(const T &value) noexcept {
+        for (size_t spins = 0; !TryPush(value); ++spins) {
+            if (spins < MaxSpins)
+                CpuPause();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // Consumer side
+    bool TryPop(T &value) noexcept {
+        size_t read_index = read_index_.load(std::memory_order_relaxed);
+        if (read_index == cached_write_index_) {
+            cached_write_index_ = write_index_.load(std::memory_order_acquire);
+            if (read_index == cached_write_index_)
+                return false;
+        }
+
+        value = slots_[read_index & mask_];
+        read_index_.store(read_index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, hands every element available right now to the function and frees their slots at once
+    template<typename Function>
+    size_t Drain(Function function, size_t limit = std::numeric_limits<size_t>::max()) {
+        size_t read_index = read_index_.load(std::memory_order_relaxed);
+        cached_write_index_ = write_index_.load(std::memory_order_acquire);
+
+        size_t count = std::min(cached_write_index_ - read_index, limit);
+        for (size_t i = 0; i < count; ++i)
+            function(slots_[(read_index + i) & mask_]);
+
+        if (count > 0)
+            read_index_.store(read_index + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    const size_t mask_;
+
+    alignas(CacheLineSize) std::atomic<size_t> write_index_;
+    size_t cached_read_index_;
+
+    alignas(CacheLineSize) std::atomic<size_t> read_index_;
+    size_t cached_write_index_;
+
+    alignas(CacheLineSize) boost::container::vector<T> slots_;
+};
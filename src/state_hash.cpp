@@ -0,0 +1,70 @@
+#include "market_manager.hpp"
+#include "state_hash.hpp"
+
+namespace {
+
+class Fnv1a {
+public:
+    static constexpr boost::uint64_t OffsetBasis = 0xcbf29ce484222325;
+    static constexpr boost::uint64_t Prime = 0x100000001b3;
+
+    [[nodiscard]] boost::uint64_t value() const noexcept { return value_; }
+
+    void Add(boost::uint64_t value) noexcept {
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            value_ ^= (value >> (i * 8)) & 0xff;
+            value_ *= Prime;
+        }
+    }
+
+private:
+    boost::uint64_t value_ = OffsetBasis;
+};
+
+void AddLevels(Fnv1a &hash, const LevelNodeSet &levels) {
+    hash.Add(levels.size());
+    for (const LevelNode &level: levels) {
+        hash.Add(level.Price);
+        hash.Add(level.TotalVolume);
+        hash.Add(level.VisibleVolume);
+        hash.Add(level.Orders);
+        for (const OrderNode &order: level.OrderList) {
+            hash.Add(order.Id);
+            hash.Add(order.UserId);
+            hash.Add(order.StopPrice);
+            hash.Add(order.ExecutedQuantity);
+            hash.Add(order.LeavesQuantity);
+        }
+    }
+}
+
+}
+
+boost::uint64_t StateHash::Compute(const MarketManager &market_manager) {
+    Fnv1a hash;
+    hash.Add(market_manager.GetOrdersCount());
+    hash.Add(market_manager.orders().size());
+
+    // Deleted users and books leave null slots, they hash as their index only
+    const MarketManager::Users &users = market_manager.users();
+    for (size_t i = 0; i < users.size(); ++i) {
+        hash.Add(i);
+        if (users[i] != nullptr)
+            hash.Add(boost::uint64_t(users[i]->Balance));
+    }
+
+    const MarketManager::OrderBooks &order_books = market_manager.order_books();
+    for (size_t i = 0; i < order_books.size(); ++i) {
+        hash.Add(i);
+        const OrderBook *order_book_ptr = order_books[i];
+        if (order_book_ptr == nullptr)
+            continue;
+        AddLevels(hash, order_book_ptr->bids());
+        AddLevels(hash, order_book_ptr->asks());
+        AddLevels(hash, order_book_ptr->buy_stop());
+        AddLevels(hash, order_book_ptr->sell_stop());
+        AddLevels(hash, order_book_ptr->trailing_buy_stop());
+        AddLevels(hash, order_book_ptr->trailing_sell_stop());
+    }
+    return hash.value();
+}
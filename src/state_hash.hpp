@@ -0,0 +1,13 @@
+#pragma once
+
+#include <boost/cstdint.hpp>
+
+class MarketManager;
+
+// FNV-1a hash of the state of a market manager that fills can change: the orders count, every user balance and every
+// level of the six sides of each order book with its orders in time priority. Two managers fed the same commands hash
+// the same, so the hash tells whether an engine change altered any fill.
+class StateHash {
+public:
+    static boost::uint64_t Compute(const MarketManager &market_manager);
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+
+#include <boost/cstdint.hpp>
+
+#include "spsc_ring.hpp"
+
+// Best bid and ask of a book with their visible volume and order count, and the price of the last trade on each side.
+// A missing level or a side that has not traded yet reads as zero.
+class TopOfBook {
+public:
+    boost::uint64_t BidPrice;
+    boost::uint64_t BidVolume;
+    boost::uint64_t BidOrders;
+    boost::uint64_t AskPrice;
+    boost::uint64_t AskVolume;
+    boost::uint64_t AskOrders;
+    boost::uint64_t LastBidPrice;
+    boost::uint64_t LastAskPrice;
+
+    friend bool operator==(const TopOfBook &top1, const TopOfBook &top2) noexcept = default;
+};
+
+// Sequence lock around a TopOfBook. One writer stores, any number of readers load without blocking it: a reader that
+// overlaps a store sees the sequence move or find it odd and simply reads again.
+class alignas(CacheLineSize) TopOfBookSeqLock {
+public:
+    TopOfBookSeqLock() noexcept: sequence_(0), bid_price_(0), bid_volume_(0), bid_orders_(0), ask_price_(0),
+                                 ask_volume_(0), ask_orders_(0), last_bid_price_(0), last_ask_price_(0) {
+    }
+
+    TopOfBookSeqLock(const TopOfBookSeqLock &) = delete;
+
+    TopOfBookSeqLock(TopOfBookSeqLock &&) = delete;
+
+    ~TopOfBookSeqLock() = default;
+
+    TopOfBookSeqLock &operator=(const TopOfBookSeqLock &) = delete;
+
+    TopOfBookSeqLock &operator=(TopOfBookSeqLock &&) = delete;
+
+    // Number of stores so far
+    [[nodiscard]] boost::uint64_t version() const noexcept { return sequence_.load(std::memory_order_acquire) / 2; }
+
+    void Store(const TopOfBook &top) noexcept {
+        boost::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        bid_price_.store(top.BidPrice, std::memory_order_relaxed);
+        bid_volume_.store(top.BidVolume, std::memory_order_relaxed);
+        bid_orders_.store(top.BidOrders, std::memory_order_relaxed);
+        ask_price_.store(top.AskPrice, std::memory_order_relaxed);
+        ask_volume_.store(top.AskVolume, std::memory_order_relaxed);
+        ask_orders_.store(top.AskOrders, std::memory_order_relaxed);
+        last_bid_price_.store(top.LastBidPrice, std::memory_order_relaxed);
+        last_ask_price_.store(top.LastAskPrice, std::memory_order_relaxed);
+
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Single attempt, fails when a store is in progress or lands in the middle of the read
+    bool TryLoad(TopOfBook &top) const noexcept {
+        boost::uint64_t sequence = sequence_.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0)
+            return false;
+
+        top.BidPrice = bid_price_.load(std::memory_order_relaxed);
+        top.BidVolume = bid_volume_.load(std::memory_order_relaxed);
+        top.BidOrders = bid_orders_.load(std::memory_order_relaxed);
+        top.AskPrice = ask_price_.load(std::memory_order_relaxed);
+        top.AskVolume = ask_volume_.load(std::memory_order_relaxed);
+        top.AskOrders = ask_orders_.load(std::memory_order_relaxed);
+        top.LastBidPrice = last_bid_price_.load(std::memory_order_relaxed);
+        top.LastAskPrice = last_ask_price_.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence_.load(std::memory_order_relaxed) == sequence;
+    }
+
+    [[nodiscard]] TopOfBook Load() const noexcept {
+        TopOfBook top;
+        while (!TryLoad(top))
+            CpuPause();
+        return top;
+    }
+
+private:
+    std::atomic<boost::uint64_t> sequence_;
+    std::atomic<boost::uint64_t> bid_price_;
+    std::atomic<boost::uint64_t> bid_volume_;
+    std::atomic<boost::uint64_t> bid_orders_;
+    std::atomic<boost::uint64_t> ask_price_;
+    std::atomic<boost::uint64_t> ask_volume_;
+    std::atomic<boost::uint64_t> ask_orders_;
+    std::atomic<boost::uint64_t> last_bid_price_;
+    std::atomic<boost::uint64_t> last_ask_price_;
+};
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../src/market_manager.hpp"
+#include "../src/state_hash.hpp"
+
+class MarketManagerBatchTest : public ::testing::Test {
+protected:
+    const Symbol test_symbol0{0, "USDRUB"};
+    const Symbol test_symbol1{1, "EURRUB"};
+
+    void Setup(MarketManager &market_manager) const {
+        market_manager.AddSymbol(test_symbol0);
+        market_manager.AddOrderBook(test_symbol0);
+        market_manager.AddSymbol(test_symbol1);
+        market_manager.AddOrderBook(test_symbol1, OrderBookOptions::Ladder(1, 64));
+        for (boost::uint64_t user_id = 0; user_id < 4; ++user_id)
+            market_manager.AddUser(User(user_id, "user" + std::to_string(user_id)));
+    }
+};
+
+TEST_F(MarketManagerBatchTest, LimitOrdersMatchLikeSingleOrders) {
+    MarketManager single;
+    MarketManager batched;
+    Setup(single);
+    Setup(batched);
+
+    std::mt19937 random(7);
+    std::vector<Order> orders;
+    for (boost::uint64_t id = 1; id <= 3000; ++id) {
+        boost::uint64_t symbol_id = random() % 2;
+        boost::uint64_t user_id = random() % 4;
+        boost::uint64_t price = 90 + random() % 20;
+        boost::uint64_t quantity = 1 + random() % 10;
+        orders.push_back((random() % 2) ? Order::Buy(id, symbol_id, user_id, price, quantity)
+                                        : Order::Sell(id, symbol_id, user_id, price, quantity));
+    }
+
+    for (const Order &order: orders)
+        EXPECT_EQ(ErrorCode::OK, single.AddOrder(order));
+
+    // Spans over MaxBatchSize are cut into chunks
+    std::vector<ErrorCode> results(orders.size(), ErrorCode::ORDER_NOT_FOUND);
+    EXPECT_EQ(orders.size(), batched.AddOrders(orders, results));
+    for (ErrorCode result: results)
+        EXPECT_EQ(ErrorCode::OK, result);
+    EXPECT_EQ(StateHash::Compute(single), StateHash::Compute(batched));
+    EXPECT_EQ(single.GetOrderBook(0)->top_of_book().Load(), batched.GetOrderBook(0)->top_of_book().Load());
+    EXPECT_EQ(single.GetOrderBook(1)->top_of_book().Load(), batched.GetOrderBook(1)->top_of_book().Load());
+
+    std::vector<boost::uint64_t> ids;
+    for (boost::uint64_t id = 1; id <= 3000; id += 3)
+        ids.push_back(id);
+    for (boost::uint64_t id: ids)
+        single.DeleteOrder(id);
+    results.assign(ids.size(), ErrorCode::OK);
+    size_t deleted = batched.DeleteOrders(ids, results);
+    EXPECT_EQ(deleted, size_t(std::count(results.begin(), results.end(), ErrorCode::OK)));
+    EXPECT_EQ(StateHash::Compute(single), StateHash::Compute(batched));
+}
+
+TEST_F(MarketManagerBatchTest, ResultsPerOrder) {
+    MarketManager market_manager;
+    Setup(market_manager);
+
+    const Order orders[] = {Order::Buy(1, test_symbol0.Id, 0, 100, 10), Order::Buy(2, 7, 0, 100, 10),
+                            Order::Sell(1, test_symbol0.Id, 1, 105, 10), Order::Sell(3, test_symbol1.Id, 1, 105, 10)};
+    ErrorCode results[4];
+    EXPECT_EQ(2, market_manager.AddOrders(orders, results));
+    EXPECT_EQ(ErrorCode::OK, results[0]);
+    EXPECT_EQ(ErrorCode::ORDER_BOOK_NOT_FOUND, results[1]);
+    EXPECT_EQ(ErrorCode::ORDER_DUPLICATE, results[2]);
+    EXPECT_EQ(ErrorCode::OK, results[3]);
+    EXPECT_EQ(100, market_manager.GetOrderBook(test_symbol0.Id)->top_of_book().Load().BidPrice);
+    EXPECT_EQ(105, market_manager.GetOrderBook(test_symbol1.Id)->top_of_book().Load().AskPrice);
+
+    const boost::uint64_t ids[] = {0, 3, 42, 3};
+    EXPECT_EQ(1, market_manager.DeleteOrders(ids, results));
+    EXPECT_EQ(ErrorCode::ORDER_ID_INVALID, results[0]);
+    EXPECT_EQ(ErrorCode::OK, results[1]);
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, results[2]);
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, results[3]);
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol1.Id)->best_ask());
+}
+
+TEST_F(MarketManagerBatchTest, StopsActivateAfterTheBatch) {
+    MarketManager market_manager;
+    Setup(market_manager);
+    market_manager.AddOrder(Order::Sell(1, test_symbol0.Id, 0, 100, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol0.Id, 0, 103, 10));
+    market_manager.AddOrder(Order::BuyStopLimit(3, test_symbol0.Id, 2, 105, 102, 5));
+
+    // Taken one by one, the buy lifts the offer to 103 and triggers the stop before the new offer at 101 arrives. In a
+    // batch the stop is only checked once the 101 offer is in, which keeps the market below it.
+    const Order orders[] = {Order::Buy(4, test_symbol0.Id, 1, 100, 10), Order::Sell(5, test_symbol0.Id, 0, 101, 5)};
+    ErrorCode results[2];
+    EXPECT_EQ(2, market_manager.AddOrders(orders, results));
+
+    EXPECT_NE(nullptr, market_manager.GetOrder(3));
+    EXPECT_EQ(102, market_manager.GetOrderBook(test_symbol0.Id)->best_buy_stop()->Price);
+    EXPECT_EQ(101, market_manager.GetOrderBook(test_symbol0.Id)->best_ask()->Price);
+}
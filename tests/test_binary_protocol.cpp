@@ -0,0 +1,346 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../src/binary_session.hpp"
+
+TEST(BinaryProtocolTest, LayoutTest) {
+    EXPECT_EQ(3, sizeof(BinaryHeader));
+    EXPECT_EQ(3 + 32, sizeof(RegisterRequest));
+    EXPECT_EQ(3 + 8 + 1 + 8 + 8, sizeof(AddOrderRequest));
+    EXPECT_EQ(3 + 16, sizeof(CancelOrderRequest));
+    EXPECT_EQ(3 + 32, sizeof(ReplaceOrderRequest));
+    EXPECT_EQ(3 + 32, sizeof(ModifyOrderRequest));
+    EXPECT_EQ(3 + 2 + 16, sizeof(AckMessage));
+
+    EXPECT_EQ(sizeof(AddOrderRequest), GetBinaryMessageSize(BinaryMessageType::ADD_ORDER));
+    EXPECT_EQ(0, GetBinaryMessageSize(BinaryMessageType(0)));
+}
+
+TEST(BinaryProtocolTest, EncodeDecodeTest) {
+    AddOrderRequest request{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 3, OrderSide::SELL, 101, 7};
+
+    boost::uint8_t buffer[sizeof(AddOrderRequest)];
+    EncodeBinaryMessage(request, buffer);
+
+    // Little endian on the wire
+    EXPECT_EQ(sizeof(AddOrderRequest), buffer[0]);
+    EXPECT_EQ(0, buffer[1]);
+    EXPECT_EQ(boost::uint8_t(BinaryMessageType::ADD_ORDER), buffer[2]);
+    EXPECT_EQ(3, buffer[3]);
+
+    auto decoded = DecodeBinaryMessage<AddOrderRequest>(buffer);
+    EXPECT_EQ(3, decoded.SymbolId);
+    EXPECT_EQ(OrderSide::SELL, decoded.Side);
+    EXPECT_EQ(101, decoded.Price);
+    EXPECT_EQ(7, decoded.Quantity);
+}
+
+class BinarySessionTest : public ::testing::TestWithParam<size_t> {
+protected:
+    boost::asio::io_service io_service;
+    MarketManager market_manager;
+    ShardedEngine engine{2};
+    EngineIds engine_ids;
+    IoStrand engine_strand{boost::asio::make_strand(io_service)};
+    const Symbol test_symbol{0, "USDRUB"};
+
+    ShardedEngine *engine_ptr() { return (GetParam() > 0) ? &engine : nullptr; }
+
+    void SetUp() override {
+        if (engine_ptr() != nullptr) {
+            engine.AddSymbol(test_symbol);
+            engine.Start();
+        } else {
+            market_manager.AddSymbol(test_symbol);
+            market_manager.AddOrderBook(test_symbol);
+        }
+    }
+
+    void TearDown() override {
+        engine.Stop();
+    }
+
+    template<typename Message>
+    static AckMessage Request(boost::asio::ip::tcp::socket &socket, const Message &message) {
+        boost::asio::write(socket, boost::asio::buffer(&message, sizeof(message)));
+
+        AckMessage ack;
+        boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)));
+        return ack;
+    }
+};
+
+TEST_P(BinarySessionTest, OrderEntryTest) {
+    BinaryServer server(io_service, 0, market_manager, engine_ptr(), engine_ids, engine_strand);
+    std::thread io_thread([this]() { io_service.run(); });
+
+    boost::asio::ip::tcp::socket socket(io_service);
+    socket.connect({boost::asio::ip::make_address("127.0.0.1"), server.local_endpoint().port()});
+
+    AckMessage ack = Request(socket, AddOrderRequest{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 0,
+                                                     OrderSide::BUY, 100, 1});
+    EXPECT_EQ(BinaryMessageType::ADD_ORDER, ack.Request);
+    EXPECT_EQ(ErrorCode::USER_NOT_FOUND, ack.Error);
+
+    RegisterRequest registration{{sizeof(RegisterRequest), BinaryMessageType::REGISTER}, "user0"};
+    ack = Request(socket, registration);
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+    EXPECT_EQ(0, ack.Value);
+
+    ack = Request(socket, AddOrderRequest{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 0,
+                                          OrderSide::SELL, 100, 10});
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+    boost::uint64_t order_id = ack.OrderId;
+
+    ack = Request(socket, ReplaceOrderRequest{{sizeof(ReplaceOrderRequest), BinaryMessageType::REPLACE_ORDER}, 0,
+                                              order_id, 90, 5});
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+    EXPECT_NE(order_id, ack.OrderId);
+    boost::uint64_t replaced_id = ack.OrderId;
+
+    ack = Request(socket, ModifyOrderRequest{{sizeof(ModifyOrderRequest), BinaryMessageType::MODIFY_ORDER}, 0,
+                                             replaced_id, 90, 0});
+    EXPECT_EQ(BinaryMessageType::MODIFY_ORDER, ack.Request);
+    EXPECT_EQ(ErrorCode::ORDER_QUANTITY_INVALID, ack.Error);
+
+    ack = Request(socket, ModifyOrderRequest{{sizeof(ModifyOrderRequest), BinaryMessageType::MODIFY_ORDER}, 0,
+                                             replaced_id, 90, 3});
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+    EXPECT_EQ(replaced_id, ack.OrderId);
+
+    ack = Request(socket, CancelOrderRequest{{sizeof(CancelOrderRequest), BinaryMessageType::CANCEL_ORDER}, 0,
+                                             order_id});
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, ack.Error);
+
+    // The replacement kept the sell side, so a buy at its price trades against it
+    ack = Request(socket, AddOrderRequest{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 0,
+                                          OrderSide::BUY, 90, 2});
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+
+    ack = Request(socket, BalanceRequest{{sizeof(BalanceRequest), BinaryMessageType::BALANCE}});
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+    EXPECT_EQ(0, ack.Value);
+
+    // Symbol 2 falls on the shard of symbol 0, a cancel naming it must still leave the order alone
+    ack = Request(socket, CancelOrderRequest{{sizeof(CancelOrderRequest), BinaryMessageType::CANCEL_ORDER}, 2,
+                                             replaced_id});
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, ack.Error);
+
+    ack = Request(socket, CancelOrderRequest{{sizeof(CancelOrderRequest), BinaryMessageType::CANCEL_ORDER}, 0,
+                                             replaced_id});
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+
+    // A malformed header closes the connection
+    BinaryHeader header{1, BinaryMessageType::ADD_ORDER};
+    boost::asio::write(socket, boost::asio::buffer(&header, sizeof(header)));
+    boost::system::error_code error;
+    boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)), error);
+    EXPECT_TRUE(error);
+
+    io_service.stop();
+    io_thread.join();
+}
+
+TEST(BinaryServerTest, CancelOnDisconnectTest) {
+    boost::asio::io_service io_service;
+    MarketManager market_manager;
+    EngineIds engine_ids;
+    IoStrand engine_strand{boost::asio::make_strand(io_service)};
+    const Symbol test_symbol{0, "USDRUB"};
+    market_manager.AddSymbol(test_symbol);
+    market_manager.AddOrderBook(test_symbol);
+
+    BinaryServer server(io_service, 0, market_manager, nullptr, engine_ids, engine_strand);
+    auto work = boost::asio::make_work_guard(io_service);
+    std::thread io_thread([&io_service]() { io_service.run(); });
+
+    // The orders are read on the engine strand, where the sessions execute
+    auto orders = [&]() {
+        std::atomic<size_t> size{std::numeric_limits<size_t>::max()};
+        boost::asio::post(engine_strand, [&]() { size = market_manager.orders().size(); });
+        while (size == std::numeric_limits<size_t>::max())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return size.load();
+    };
+
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> sockets;
+    for (size_t client = 0; client < 2; ++client) {
+        sockets.push_back(std::make_unique<boost::asio::ip::tcp::socket>(io_service));
+        boost::asio::ip::tcp::socket &socket = *sockets.back();
+        socket.connect({boost::asio::ip::make_address("127.0.0.1"), server.local_endpoint().port()});
+
+        std::vector<boost::uint8_t> stream(sizeof(RegisterRequest) + 3 * sizeof(AddOrderRequest));
+        EncodeBinaryMessage(RegisterRequest{{sizeof(RegisterRequest), BinaryMessageType::REGISTER}, "user"},
+                            stream.data());
+        for (size_t i = 0; i < 3; ++i)
+            EncodeBinaryMessage(AddOrderRequest{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 0,
+                                                OrderSide::BUY, 100 + i, 1},
+                                stream.data() + sizeof(RegisterRequest) + i * sizeof(AddOrderRequest));
+        boost::asio::write(socket, boost::asio::buffer(stream));
+
+        std::vector<AckMessage> acks(4);
+        boost::asio::read(socket, boost::asio::buffer(acks.data(), acks.size() * sizeof(AckMessage)));
+        EXPECT_EQ(ErrorCode::OK, acks.back().Error);
+    }
+    EXPECT_EQ(6, orders());
+
+    // Only the orders of the disconnected user go
+    sockets.front()->close();
+    for (int i = 0; (i < 5000) && (orders() > 3); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(3, orders());
+    EXPECT_EQ(3, market_manager.GetUserOrders(1)->size());
+
+    sockets.back()->close();
+    for (int i = 0; (i < 5000) && (orders() > 0); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(0, orders());
+    EXPECT_EQ(2, market_manager.users().size());
+
+    work.reset();
+    io_service.stop();
+    io_thread.join();
+}
+
+TEST_P(BinarySessionTest, PipeliningTest) {
+    BinaryServer server(io_service, 0, market_manager, engine_ptr(), engine_ids, engine_strand);
+    std::thread io_thread([this]() { io_service.run(); });
+
+    boost::asio::ip::tcp::socket socket(io_service);
+    socket.connect({boost::asio::ip::make_address("127.0.0.1"), server.local_endpoint().port()});
+
+    // Requests sent back to back, the book of symbol 1 does not exist and its orders fail on another shard
+    std::vector<boost::uint8_t> stream;
+    auto append = [&stream](const auto &message) {
+        boost::uint8_t buffer[sizeof(message)];
+        EncodeBinaryMessage(message, buffer);
+        stream.insert(stream.end(), buffer, buffer + sizeof(message));
+    };
+    append(RegisterRequest{{sizeof(RegisterRequest), BinaryMessageType::REGISTER}, "user0"});
+    for (boost::uint64_t i = 0; i < 8; ++i)
+        append(AddOrderRequest{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, i % 2, OrderSide::BUY,
+                               100 + i, 1});
+    append(BalanceRequest{{sizeof(BalanceRequest), BinaryMessageType::BALANCE}});
+    append(CancelOrderRequest{{sizeof(CancelOrderRequest), BinaryMessageType::CANCEL_ORDER}, 0, 12345});
+
+    // The last request is split across writes
+    size_t split = stream.size() - 5;
+    boost::asio::write(socket, boost::asio::buffer(stream.data(), split));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    boost::asio::write(socket, boost::asio::buffer(stream.data() + split, stream.size() - split));
+
+    AckMessage ack;
+    boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)));
+    EXPECT_EQ(BinaryMessageType::REGISTER, ack.Request);
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+
+    for (boost::uint64_t i = 0; i < 8; ++i) {
+        boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)));
+        EXPECT_EQ(BinaryMessageType::ADD_ORDER, ack.Request);
+        EXPECT_EQ((i % 2 == 0) ? ErrorCode::OK : ErrorCode::ORDER_BOOK_NOT_FOUND, ack.Error);
+    }
+
+    boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)));
+    EXPECT_EQ(BinaryMessageType::BALANCE, ack.Request);
+
+    boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)));
+    EXPECT_EQ(BinaryMessageType::CANCEL_ORDER, ack.Request);
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, ack.Error);
+    EXPECT_EQ(12345, ack.OrderId);
+
+    io_service.stop();
+    io_thread.join();
+}
+
+TEST_P(BinarySessionTest, BackpressureTest) {
+    BinaryServer server(io_service, 0, market_manager, engine_ptr(), engine_ids, engine_strand);
+    std::thread io_thread([this]() { io_service.run(); });
+
+    boost::asio::ip::tcp::socket socket(io_service);
+    socket.connect({boost::asio::ip::make_address("127.0.0.1"), server.local_endpoint().port()});
+
+    // More requests than the session keeps unanswered, sent before reading any ack
+    const size_t requests = 3 * MaxPendingReplies;
+    std::vector<boost::uint8_t> stream(requests * sizeof(BalanceRequest));
+    for (size_t i = 0; i < requests; ++i)
+        EncodeBinaryMessage(BalanceRequest{{sizeof(BalanceRequest), BinaryMessageType::BALANCE}},
+                            stream.data() + i * sizeof(BalanceRequest));
+    std::thread writer([&socket, &stream]() { boost::asio::write(socket, boost::asio::buffer(stream)); });
+
+    std::vector<AckMessage> acks(requests);
+    boost::asio::read(socket, boost::asio::buffer(acks.data(), acks.size() * sizeof(AckMessage)));
+    writer.join();
+    for (const auto &ack: acks) {
+        EXPECT_EQ(BinaryMessageType::BALANCE, ack.Request);
+        EXPECT_EQ(ErrorCode::USER_NOT_FOUND, ack.Error);
+    }
+
+    io_service.stop();
+    io_thread.join();
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, BinarySessionTest, ::testing::Values(0, 2));
+
+TEST(BinaryServerTest, IoThreadsTest) {
+    boost::asio::io_service io_service;
+    MarketManager market_manager;
+    EngineIds engine_ids;
+    IoStrand engine_strand{boost::asio::make_strand(io_service)};
+    const Symbol test_symbol{0, "USDRUB"};
+    market_manager.AddSymbol(test_symbol);
+    market_manager.AddOrderBook(test_symbol);
+
+    BinaryServer server(io_service, 0, market_manager, nullptr, engine_ids, engine_strand);
+    auto work = boost::asio::make_work_guard(io_service);
+    std::vector<std::thread> io_threads;
+    for (int i = 0; i < 4; ++i)
+        io_threads.emplace_back([&io_service]() { io_service.run(); });
+
+    // Clients pipelining orders at once, the engine strand hands out every order id once
+    const size_t clients = 4;
+    const size_t orders = 500;
+    std::vector<std::vector<boost::uint64_t>> order_ids(clients);
+    std::vector<std::thread> client_threads;
+    for (size_t client = 0; client < clients; ++client) {
+        client_threads.emplace_back([&, client]() {
+            boost::asio::ip::tcp::socket socket(io_service);
+            socket.connect({boost::asio::ip::make_address("127.0.0.1"), server.local_endpoint().port()});
+
+            std::vector<boost::uint8_t> stream;
+            RegisterRequest registration{{sizeof(RegisterRequest), BinaryMessageType::REGISTER}, "user"};
+            stream.resize(sizeof(registration) + orders * sizeof(AddOrderRequest));
+            EncodeBinaryMessage(registration, stream.data());
+            for (size_t i = 0; i < orders; ++i)
+                EncodeBinaryMessage(AddOrderRequest{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 0,
+                                                    OrderSide::BUY, 100, 1},
+                                    stream.data() + sizeof(registration) + i * sizeof(AddOrderRequest));
+            boost::asio::write(socket, boost::asio::buffer(stream));
+
+            std::vector<AckMessage> acks(orders + 1);
+            boost::asio::read(socket, boost::asio::buffer(acks.data(), acks.size() * sizeof(AckMessage)));
+            for (size_t i = 1; i < acks.size(); ++i)
+                if (acks[i].Error == ErrorCode::OK)
+                    order_ids[client].push_back(acks[i].OrderId);
+        });
+    }
+    for (auto &thread: client_threads)
+        thread.join();
+
+    work.reset();
+    io_service.stop();
+    for (auto &thread: io_threads)
+        thread.join();
+
+    std::set<boost::uint64_t> unique;
+    for (const auto &ids: order_ids) {
+        EXPECT_EQ(orders, ids.size());
+        unique.insert(ids.begin(), ids.end());
+    }
+    EXPECT_EQ(clients * orders, unique.size());
+    EXPECT_EQ(clients, market_manager.users().size());
+}
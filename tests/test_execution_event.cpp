@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../src/market_manager.hpp"
+
+class ExecutionEventTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    ExecutionEventRing ring{1024};
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol);
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+        market_manager.Subscribe(ring);
+    }
+
+    void TearDown() override {
+        market_manager.Unsubscribe(ring);
+        market_manager.DeleteUser(test_user0.Id);
+        market_manager.DeleteUser(test_user1.Id);
+        market_manager.DeleteOrderBook(test_symbol.Id);
+        market_manager.DeleteSymbol(test_symbol.Id);
+    }
+
+    std::vector<ExecutionEvent> Drain() {
+        std::vector<ExecutionEvent> events;
+        ring.Drain([&events](const ExecutionEvent &event) { events.push_back(event); });
+        return events;
+    }
+};
+
+TEST_F(ExecutionEventTest, AddOrderTest) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+
+    auto events = Drain();
+    ASSERT_EQ(2, events.size());
+
+    EXPECT_EQ(ExecutionEventType::ORDER_ACCEPTED, events[0].Type);
+    EXPECT_EQ(1, events[0].Sequence);
+    EXPECT_EQ(1, events[0].OrderState.OrderId);
+    EXPECT_EQ(10, events[0].OrderState.LeavesQuantity);
+
+    EXPECT_EQ(ExecutionEventType::LEVEL_UPDATE, events[1].Type);
+    EXPECT_EQ(2, events[1].Sequence);
+    EXPECT_EQ(UpdateType::ADD, events[1].LevelState.Update);
+    EXPECT_EQ(LevelType::ASK, events[1].LevelState.Type);
+    EXPECT_EQ(100, events[1].LevelState.Price);
+    EXPECT_EQ(10, events[1].LevelState.TotalVolume);
+    EXPECT_TRUE(events[1].LevelState.Top);
+
+    market_manager.DeleteOrder(1);
+}
+
+TEST_F(ExecutionEventTest, TradeTest) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    Drain();
+
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user1.Id, 101, 4));
+
+    auto events = Drain();
+    ASSERT_EQ(4, events.size());
+
+    EXPECT_EQ(ExecutionEventType::ORDER_ACCEPTED, events[0].Type);
+    EXPECT_EQ(2, events[0].OrderState.OrderId);
+
+    EXPECT_EQ(ExecutionEventType::TRADE, events[1].Type);
+    EXPECT_EQ(1, events[1].Trade.MakerOrderId);
+    EXPECT_EQ(2, events[1].Trade.TakerOrderId);
+    EXPECT_EQ(test_user1.Id, events[1].Trade.TakerUserId);
+    EXPECT_EQ(OrderSide::BUY, events[1].Trade.TakerSide);
+    EXPECT_EQ(100, events[1].Trade.Price);
+    EXPECT_EQ(4, events[1].Trade.Quantity);
+
+    EXPECT_EQ(ExecutionEventType::ORDER_REDUCED, events[2].Type);
+    EXPECT_EQ(1, events[2].OrderState.OrderId);
+    EXPECT_EQ(6, events[2].OrderState.LeavesQuantity);
+
+    EXPECT_EQ(ExecutionEventType::LEVEL_UPDATE, events[3].Type);
+    EXPECT_EQ(UpdateType::UPDATE, events[3].LevelState.Update);
+    EXPECT_EQ(6, events[3].LevelState.TotalVolume);
+
+    EXPECT_EQ(events[0].Sequence + 3, events[3].Sequence);
+
+    market_manager.DeleteOrder(1);
+}
+
+TEST_F(ExecutionEventTest, CancelTest) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 100, 10));
+    Drain();
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.DeleteOrder(1));
+
+    auto events = Drain();
+    ASSERT_EQ(2, events.size());
+
+    EXPECT_EQ(ExecutionEventType::ORDER_CANCELLED, events[0].Type);
+    EXPECT_EQ(1, events[0].OrderState.OrderId);
+    EXPECT_EQ(0, events[0].OrderState.LeavesQuantity);
+
+    EXPECT_EQ(ExecutionEventType::LEVEL_UPDATE, events[1].Type);
+    EXPECT_EQ(UpdateType::DELETE, events[1].LevelState.Update);
+    EXPECT_EQ(0, events[1].LevelState.TotalVolume);
+}
+
+TEST_F(ExecutionEventTest, DuplicateTest) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    Drain();
+
+    EXPECT_EQ(ErrorCode::ORDER_DUPLICATE, market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user1.Id, 100, 5)));
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(10, market_manager.GetOrder(1)->LeavesQuantity);
+
+    market_manager.DeleteOrder(1);
+}
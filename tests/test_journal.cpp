@@ -0,0 +1,342 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <unistd.h>
+
+#include "../src/journal.hpp"
+#include "../src/market_manager.hpp"
+
+class JournalTest : public ::testing::Test {
+protected:
+    std::filesystem::path directory;
+    const Symbol test_symbol0{0, "USDRUB"};
+    const Symbol test_symbol1{1, "EURRUB"};
+
+    void SetUp() override {
+        directory = std::filesystem::temp_directory_path() /
+                    ("journal_test_" + std::to_string(::getpid()) + "_" +
+                     ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(directory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    // Symbols, users and a stream of crossing limit, stop and cancel commands, some of them failing
+    static void Trade(MarketManager &market_manager, const Symbol &symbol0, const Symbol &symbol1, size_t orders,
+                      unsigned seed) {
+        market_manager.AddSymbol(symbol0);
+        market_manager.AddOrderBook(symbol0);
+        market_manager.AddSymbol(symbol1);
+        market_manager.AddOrderBook(symbol1, OrderBookOptions::Ladder(1, 64));
+        for (boost::uint64_t user_id = market_manager.users().size(); user_id < 8; ++user_id)
+            market_manager.AddUser(User(user_id, "user" + std::to_string(user_id)));
+
+        std::mt19937 random(seed);
+        for (size_t i = 0; i < orders; ++i) {
+            boost::uint64_t id = market_manager.GetOrdersCount();
+            boost::uint64_t symbol_id = random() % 2;
+            boost::uint64_t user_id = random() % 8;
+            boost::uint64_t price = 90 + random() % 20;
+            boost::uint64_t quantity = 1 + random() % 10;
+
+            switch (random() % 6) {
+                case 0:
+                    market_manager.DeleteOrder(1 + random() % id);
+                    break;
+                case 1:
+                    market_manager.AddOrder(Order::BuyStopLimit(id, symbol_id, user_id, price, price - 5, quantity));
+                    break;
+                case 2:
+                case 3:
+                    market_manager.AddOrder(Order::Buy(id, symbol_id, user_id, price, quantity));
+                    break;
+                default:
+                    market_manager.AddOrder(Order::Sell(id, symbol_id, user_id, price, quantity));
+                    break;
+            }
+        }
+    }
+
+    static void ExpectSameState(const MarketManager &expected, const MarketManager &actual) {
+        EXPECT_EQ(expected.GetOrdersCount(), actual.GetOrdersCount());
+
+        ASSERT_EQ(expected.users().size(), actual.users().size());
+        for (size_t user_id = 0; user_id < expected.users().size(); ++user_id) {
+            ASSERT_NE(nullptr, actual.GetUser(user_id));
+            EXPECT_EQ(expected.GetUser(user_id)->Name, actual.GetUser(user_id)->Name);
+            EXPECT_EQ(expected.GetUser(user_id)->Balance, actual.GetUser(user_id)->Balance);
+        }
+
+        ASSERT_EQ(expected.orders().size(), actual.orders().size());
+        expected.orders().ForEach([&actual](const Order *order_ptr) {
+            const Order *actual_ptr = actual.GetOrder(order_ptr->Id);
+            ASSERT_NE(nullptr, actual_ptr);
+            EXPECT_EQ(order_ptr->Type, actual_ptr->Type);
+            EXPECT_EQ(order_ptr->Price, actual_ptr->Price);
+            EXPECT_EQ(order_ptr->StopPrice, actual_ptr->StopPrice);
+            EXPECT_EQ(order_ptr->LeavesQuantity, actual_ptr->LeavesQuantity);
+            EXPECT_EQ(order_ptr->ExecutedQuantity, actual_ptr->ExecutedQuantity);
+        });
+
+        for (boost::uint64_t symbol_id = 0; symbol_id < 2; ++symbol_id) {
+            const OrderBook *expected_ptr = expected.GetOrderBook(symbol_id);
+            const OrderBook *actual_ptr = actual.GetOrderBook(symbol_id);
+            ASSERT_NE(nullptr, actual_ptr);
+            EXPECT_EQ(expected_ptr->symbol().Name, actual_ptr->symbol().Name);
+            EXPECT_EQ(expected_ptr->options().Layout, actual_ptr->options().Layout);
+            EXPECT_EQ(expected_ptr->size(), actual_ptr->size());
+            EXPECT_EQ(expected_ptr->best_bid() ? expected_ptr->best_bid()->Price : 0,
+                      actual_ptr->best_bid() ? actual_ptr->best_bid()->Price : 0);
+            EXPECT_EQ(expected_ptr->best_ask() ? expected_ptr->best_ask()->Price : 0,
+                      actual_ptr->best_ask() ? actual_ptr->best_ask()->Price : 0);
+        }
+    }
+
+    std::vector<std::filesystem::path> Segments() const {
+        std::vector<std::filesystem::path> segments;
+        for (const auto &entry: std::filesystem::directory_iterator(directory))
+            segments.push_back(entry.path());
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+};
+
+TEST_F(JournalTest, ReplayRestoresState) {
+    for (JournalDurability durability: {JournalDurability::NONE, JournalDurability::BATCHED,
+                                        JournalDurability::PER_COMMAND}) {
+        std::filesystem::remove_all(directory);
+
+        MarketManager market_manager;
+        boost::uint64_t sequence;
+        {
+            Journal journal(directory.string(), durability);
+            market_manager.AttachJournal(journal);
+            Trade(market_manager, test_symbol0, test_symbol1, 2000, 7);
+            market_manager.DetachJournal();
+
+            journal.Flush();
+            EXPECT_EQ(journal.sequence(), journal.durable_sequence());
+            EXPECT_FALSE(journal.error());
+            sequence = journal.sequence();
+        }
+
+        MarketManager replayed;
+        JournalReader reader(directory.string());
+        EXPECT_EQ(sequence, reader.Replay(replayed));
+        ExpectSameState(market_manager, replayed);
+    }
+}
+
+TEST_F(JournalTest, FailedCommandsAreNotJournaled) {
+    MarketManager market_manager;
+    Journal journal(directory.string());
+    market_manager.AttachJournal(journal);
+
+    market_manager.AddSymbol(test_symbol0);
+    EXPECT_EQ(ErrorCode::SYMBOL_DUPLICATE, market_manager.AddSymbol(test_symbol0));
+    EXPECT_EQ(ErrorCode::ORDER_BOOK_NOT_FOUND, market_manager.AddOrder(Order::Buy(1, 5, 0, 10, 1)));
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, market_manager.DeleteOrder(7));
+    EXPECT_EQ(ErrorCode::USER_NOT_FOUND, market_manager.DeleteUser(3));
+    EXPECT_EQ(1, journal.sequence());
+}
+
+TEST_F(JournalTest, ModificationsReplay) {
+    MarketManager market_manager;
+    {
+        Journal journal(directory.string());
+        market_manager.AttachJournal(journal);
+        Trade(market_manager, test_symbol0, test_symbol1, 500, 13);
+
+        // Modify every resting order of the first book, some of them into crossing prices
+        std::mt19937 random(17);
+        std::vector<boost::uint64_t> ids;
+        market_manager.orders().ForEach([&ids](const Order *order_ptr) { ids.push_back(order_ptr->Id); });
+        std::sort(ids.begin(), ids.end());
+        for (boost::uint64_t id: ids) {
+            const Order *order_ptr = market_manager.GetOrder(id);
+            if (order_ptr != nullptr)
+                market_manager.ModifyOrder(id, 90 + random() % 20, 1 + random() % 10);
+        }
+        EXPECT_EQ(ErrorCode::ORDER_QUANTITY_INVALID, market_manager.ModifyOrder(ids.back(), 100, 0));
+        market_manager.DetachJournal();
+    }
+
+    MarketManager replayed;
+    JournalReader reader(directory.string());
+    reader.Replay(replayed);
+    ExpectSameState(market_manager, replayed);
+}
+
+TEST_F(JournalTest, MassCancelsReplay) {
+    MarketManager market_manager;
+    {
+        Journal journal(directory.string());
+        market_manager.AttachJournal(journal);
+        Trade(market_manager, test_symbol0, test_symbol1, 2000, 19);
+        EXPECT_LT(0, market_manager.CancelAllOrders(3, test_symbol1.Id));
+        EXPECT_LT(0, market_manager.CancelAllOrders(5));
+        market_manager.DetachJournal();
+    }
+    EXPECT_TRUE(market_manager.GetUserOrders(5)->empty());
+
+    MarketManager replayed;
+    JournalReader reader(directory.string());
+    reader.Replay(replayed);
+    ExpectSameState(market_manager, replayed);
+    EXPECT_TRUE(replayed.GetUserOrders(5)->empty());
+}
+
+TEST_F(JournalTest, BatchesReplayAsOneRecord) {
+    MarketManager market_manager;
+    boost::uint64_t sequence;
+    {
+        Journal journal(directory.string());
+        market_manager.AttachJournal(journal);
+        Trade(market_manager, test_symbol0, test_symbol1, 100, 3);
+        sequence = journal.sequence();
+
+        std::mt19937 random(5);
+        std::vector<Order> orders;
+        for (boost::uint64_t id = 1000; id < 1000 + MarketManager::MaxBatchSize + 10; ++id) {
+            boost::uint64_t price = 90 + random() % 20;
+            orders.push_back((random() % 2) ? Order::Buy(id, random() % 2, random() % 8, price, 1 + random() % 10)
+                                            : Order::Sell(id, random() % 2, random() % 8, price, 1 + random() % 10));
+        }
+        orders.push_back(Order::Buy(2000, 7, 0, 100, 1));
+        std::vector<ErrorCode> results(orders.size());
+        EXPECT_EQ(orders.size() - 1, market_manager.AddOrders(orders, results));
+        EXPECT_EQ(ErrorCode::ORDER_BOOK_NOT_FOUND, results.back());
+
+        std::vector<boost::uint64_t> ids;
+        for (boost::uint64_t id = 1000; id < 1100; ++id)
+            ids.push_back(id);
+        results.resize(ids.size());
+        market_manager.DeleteOrders(ids, results);
+
+        // Two chunks of orders and one of cancels
+        EXPECT_EQ(sequence + 3, journal.sequence());
+        market_manager.DetachJournal();
+    }
+
+    MarketManager replayed;
+    JournalReader reader(directory.string());
+    EXPECT_EQ(sequence + 3, reader.Replay(replayed));
+    ExpectSameState(market_manager, replayed);
+}
+
+TEST_F(JournalTest, SegmentsRoll) {
+    MarketManager market_manager;
+    {
+        Journal journal(directory.string(), JournalDurability::BATCHED, 0);
+        market_manager.AttachJournal(journal);
+        Trade(market_manager, test_symbol0, test_symbol1, 5000, 11);
+        market_manager.DetachJournal();
+    }
+    EXPECT_GT(Segments().size(), 2);
+
+    MarketManager replayed;
+    JournalReader reader(directory.string());
+    reader.Replay(replayed);
+    EXPECT_EQ(Segments().size(), reader.segments());
+    ExpectSameState(market_manager, replayed);
+}
+
+TEST_F(JournalTest, RestartContinuesJournal) {
+    MarketManager market_manager;
+    {
+        Journal journal(directory.string());
+        market_manager.AttachJournal(journal);
+        Trade(market_manager, test_symbol0, test_symbol1, 500, 3);
+        market_manager.DetachJournal();
+    }
+
+    MarketManager restarted;
+    {
+        JournalReader reader(directory.string());
+        reader.Replay(restarted);
+        ExpectSameState(market_manager, restarted);
+
+        Journal journal(directory.string());
+        EXPECT_EQ(reader.sequence(), journal.sequence());
+        restarted.AttachJournal(journal);
+        Trade(restarted, test_symbol0, test_symbol1, 500, 5);
+        restarted.DetachJournal();
+    }
+    Trade(market_manager, test_symbol0, test_symbol1, 500, 5);
+    EXPECT_EQ(2, Segments().size());
+
+    MarketManager replayed;
+    JournalReader reader(directory.string());
+    reader.Replay(replayed);
+    ExpectSameState(restarted, replayed);
+    ExpectSameState(market_manager, replayed);
+}
+
+TEST_F(JournalTest, TornTailIsDropped) {
+    MarketManager market_manager;
+    boost::uint64_t sequence;
+    {
+        Journal journal(directory.string(), JournalDurability::PER_COMMAND);
+        market_manager.AttachJournal(journal);
+        market_manager.AddSymbol(test_symbol0);
+        market_manager.AddOrderBook(test_symbol0);
+        market_manager.AddUser(User(0, "user0"));
+        market_manager.AddOrder(Order::Buy(1, test_symbol0.Id, 0, 100, 10));
+        sequence = journal.sequence();
+        market_manager.AddOrder(Order::Buy(2, test_symbol0.Id, 0, 101, 10));
+        market_manager.DetachJournal();
+    }
+
+    // Corrupt a byte in the payload of the last record
+    auto segments = Segments();
+    ASSERT_EQ(1, segments.size());
+    std::vector<JournalRecord> records;
+    {
+        JournalReader reader(directory.string());
+        JournalRecord record;
+        while (reader.Next(record))
+            records.push_back(record);
+    }
+    ASSERT_EQ(sequence + 1, records.size());
+
+    std::fstream file(segments.front(), std::ios::in | std::ios::out | std::ios::binary);
+    std::vector<char> data(Journal::BlockSize * 2);
+    file.read(data.data(), std::streamsize(data.size()));
+    size_t offset = Journal::BlockSize;
+    for (boost::uint64_t i = 0; i < sequence; ++i) {
+        JournalRecordHeader header{};
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        offset += header.Size;
+    }
+    file.seekp(std::streamoff(offset + sizeof(JournalRecordHeader) + 1));
+    file.put(char(0x5a));
+    file.close();
+
+    MarketManager replayed;
+    JournalReader reader(directory.string());
+    EXPECT_EQ(sequence, reader.Replay(replayed));
+    EXPECT_EQ(sequence, reader.sequence());
+    EXPECT_NE(nullptr, replayed.GetOrder(1));
+    EXPECT_EQ(nullptr, replayed.GetOrder(2));
+
+    // The next journal carries on after the last intact record
+    Journal journal(directory.string());
+    EXPECT_EQ(sequence, journal.sequence());
+    replayed.AttachJournal(journal);
+    EXPECT_EQ(ErrorCode::OK, replayed.AddOrder(Order::Buy(2, test_symbol0.Id, 0, 102, 10)));
+    replayed.DetachJournal();
+    journal.Close();
+
+    MarketManager restarted;
+    JournalReader restarted_reader(directory.string());
+    EXPECT_EQ(sequence + 1, restarted_reader.Replay(restarted));
+    ASSERT_NE(nullptr, restarted.GetOrder(2));
+    EXPECT_EQ(102, restarted.GetOrder(2)->Price);
+}
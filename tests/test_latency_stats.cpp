@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include "../src/latency_stats.hpp"
+#include "../src/market_manager.hpp"
+
+TEST(LatencyHistogramTest, BucketsAreLogLinear) {
+    for (boost::uint64_t value = 0; value < LatencyHistogram::SubBuckets; ++value)
+        EXPECT_EQ(value, LatencyHistogram::UpperBound(LatencyHistogram::Index(value)));
+
+    // Every value falls into a bucket at most 1/SubBuckets wider than itself
+    for (boost::uint64_t value: {32ULL, 33ULL, 64ULL, 65ULL, 1000ULL, 123456789ULL, ~0ULL}) {
+        size_t index = LatencyHistogram::Index(value);
+        ASSERT_LT(index, LatencyHistogram::Buckets);
+        EXPECT_GE(LatencyHistogram::UpperBound(index), value);
+        EXPECT_LE(LatencyHistogram::UpperBound(index) - value, value / LatencyHistogram::SubBuckets);
+        if (index > 0) {
+            EXPECT_LT(LatencyHistogram::UpperBound(index - 1), value);
+        }
+    }
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0, histogram.Percentile(50));
+
+    for (boost::uint64_t value = 1; value <= 1000; ++value)
+        histogram.Record(value);
+    EXPECT_EQ(1000, histogram.count());
+    EXPECT_EQ(1000, histogram.max());
+
+    // Within the 1/32 precision of the buckets
+    EXPECT_NEAR(500, histogram.Percentile(50), 500 / 32);
+    EXPECT_NEAR(990, histogram.Percentile(99), 990 / 32);
+    EXPECT_EQ(1000, histogram.Percentile(100));
+
+    LatencyHistogram merged(histogram);
+    merged.Merge(histogram);
+    EXPECT_EQ(2000, merged.count());
+    EXPECT_EQ(histogram.Percentile(50), merged.Percentile(50));
+}
+
+TEST(LatencyStatsTest, MarketManagerRecordsHotPath) {
+    MarketManager market_manager;
+    const Symbol symbol{3, "USDRUB"};
+    market_manager.AddSymbol(symbol);
+    market_manager.AddOrderBook(symbol);
+    market_manager.AddUser(User(0, "user0"));
+    market_manager.AddOrder(Order::Buy(1, symbol.Id, 0, 100, 10));
+    market_manager.AddOrder(Order::Sell(2, symbol.Id, 0, 100, 5));
+    market_manager.DeleteOrder(1);
+
+    const LatencyStats &stats = market_manager.latency_stats();
+#if LATENCY_STATS
+    ASSERT_NE(nullptr, stats.Get(LatencyOperation::ADD_ORDER, symbol.Id));
+    EXPECT_EQ(2, stats.Get(LatencyOperation::ADD_ORDER, symbol.Id)->count());
+    EXPECT_EQ(1, stats.Get(LatencyOperation::DELETE_ORDER, symbol.Id)->count());
+    EXPECT_EQ(3, stats.Get(LatencyOperation::MATCH, symbol.Id)->count());
+    EXPECT_LE(3, stats.Get(LatencyOperation::ACTIVATE_STOP_ORDERS, symbol.Id)->count());
+    EXPECT_EQ(nullptr, stats.Get(LatencyOperation::ADD_ORDER, 0));
+
+    LatencyStats merged;
+    merged.Merge(stats);
+    merged.Merge(stats);
+    EXPECT_EQ(4, merged.Get(LatencyOperation::ADD_ORDER, symbol.Id)->count());
+    EXPECT_NE(std::string::npos, merged.Format().find("AddOrder symbol 3: count 4"));
+    EXPECT_NE(std::string::npos, merged.Format().find("AddOrder all: count 4"));
+#else
+    EXPECT_EQ(nullptr, stats.Get(LatencyOperation::ADD_ORDER, symbol.Id));
+    EXPECT_TRUE(stats.Format().empty());
+#endif
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/market_data.hpp"
+#include "../src/market_manager.hpp"
+
+class MemoryMarketDataSink : public MarketDataSink {
+public:
+    std::vector<std::vector<boost::uint8_t>> Datagrams;
+
+    void Send(const boost::uint8_t *data, size_t size) override { Datagrams.emplace_back(data, data + size); }
+};
+
+class MarketDataTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    ExecutionEventRing ring{4096};
+    MemoryMarketDataSink sink;
+    MarketDataPublisher publisher{ring, sink, std::chrono::hours(1)};
+    MarketDataReceiver receiver;
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol);
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+        market_manager.Subscribe(ring);
+    }
+
+    void TearDown() override {
+        market_manager.Unsubscribe(ring);
+        market_manager.DeleteUser(test_user0.Id);
+        market_manager.DeleteUser(test_user1.Id);
+        market_manager.DeleteOrderBook(test_symbol.Id);
+        market_manager.DeleteSymbol(test_symbol.Id);
+    }
+
+    void Deliver() {
+        for (auto &datagram: sink.Datagrams)
+            EXPECT_TRUE(receiver.OnDatagram(datagram.data(), datagram.size()));
+        sink.Datagrams.clear();
+    }
+
+    static MarketDataHeader Header(const std::vector<boost::uint8_t> &datagram) {
+        MarketDataHeader header;
+        std::memcpy(&header, datagram.data(), sizeof(header));
+        return header;
+    }
+};
+
+TEST_F(MarketDataTest, IncrementalTest) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 99, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol.Id, test_user0.Id, 101, 10));
+    market_manager.AddOrder(Order::Sell(3, test_symbol.Id, test_user0.Id, 101, 5));
+
+    EXPECT_EQ(6, publisher.Poll());
+
+    // Level updates of one poll share a datagram
+    ASSERT_EQ(1, sink.Datagrams.size());
+    MarketDataHeader header = Header(sink.Datagrams[0]);
+    EXPECT_EQ(MarketDataMessageType::INCREMENTAL, header.Type);
+    EXPECT_EQ(1, header.Sequence);
+    EXPECT_EQ(3, header.Count);
+
+    const L2Book *book_ptr = publisher.GetBook(test_symbol.Id);
+    ASSERT_NE(nullptr, book_ptr);
+    EXPECT_EQ(10, book_ptr->bids().at(99).Volume);
+    EXPECT_EQ(15, book_ptr->asks().at(101).Volume);
+    EXPECT_EQ(2, book_ptr->asks().at(101).Orders);
+
+    // Nothing is applied before the first snapshot
+    Deliver();
+    EXPECT_EQ(nullptr, receiver.GetBook(test_symbol.Id));
+
+    market_manager.DeleteOrder(1);
+    market_manager.DeleteOrder(2);
+    market_manager.DeleteOrder(3);
+}
+
+TEST_F(MarketDataTest, SnapshotTest) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 99, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol.Id, test_user0.Id, 101, 10));
+    publisher.Poll();
+    sink.Datagrams.clear();
+
+    publisher.PublishSnapshots();
+    ASSERT_EQ(1, sink.Datagrams.size());
+    EXPECT_EQ(MarketDataMessageType::SNAPSHOT, Header(sink.Datagrams[0]).Type);
+    EXPECT_EQ(2, Header(sink.Datagrams[0]).Sequence);
+    Deliver();
+
+    const L2Book *book_ptr = receiver.GetBook(test_symbol.Id);
+    ASSERT_NE(nullptr, book_ptr);
+    EXPECT_EQ(10, book_ptr->bids().at(99).Volume);
+    EXPECT_EQ(10, book_ptr->asks().at(101).Volume);
+
+    market_manager.AddOrder(Order::Buy(3, test_symbol.Id, test_user1.Id, 101, 4));
+    market_manager.DeleteOrder(1);
+    publisher.Poll();
+    Deliver();
+
+    EXPECT_TRUE(book_ptr->bids().empty());
+    EXPECT_EQ(6, book_ptr->asks().at(101).Volume);
+
+    market_manager.DeleteOrder(2);
+}
+
+TEST_F(MarketDataTest, LargeSnapshotTest) {
+    for (boost::uint64_t id = 1; id <= 300; ++id)
+        market_manager.AddOrder(Order::Sell(id, test_symbol.Id, test_user0.Id, 1000 + id, 1));
+    publisher.Poll();
+    sink.Datagrams.clear();
+
+    publisher.PublishSnapshots();
+    EXPECT_EQ((300 + MaxMarketDataLevels - 1) / MaxMarketDataLevels, sink.Datagrams.size());
+    for (auto &datagram: sink.Datagrams)
+        EXPECT_LE(datagram.size(), MaxMarketDataDatagramSize);
+
+    // Losing a part keeps the receiver out of sync
+    sink.Datagrams.erase(sink.Datagrams.begin());
+    Deliver();
+    EXPECT_EQ(nullptr, receiver.GetBook(test_symbol.Id));
+
+    publisher.PublishSnapshots();
+    Deliver();
+    ASSERT_NE(nullptr, receiver.GetBook(test_symbol.Id));
+    EXPECT_EQ(300, receiver.GetBook(test_symbol.Id)->asks().size());
+    EXPECT_EQ(1001, receiver.GetBook(test_symbol.Id)->asks().begin()->first);
+    EXPECT_EQ(1300, receiver.GetBook(test_symbol.Id)->asks().rbegin()->first);
+
+    for (boost::uint64_t id = 1; id <= 300; ++id)
+        market_manager.DeleteOrder(id);
+}
+
+TEST_F(MarketDataTest, GapTest) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 99, 10));
+    publisher.Poll();
+    publisher.PublishSnapshots();
+    Deliver();
+    ASSERT_NE(nullptr, receiver.GetBook(test_symbol.Id));
+
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 98, 10));
+    publisher.Poll();
+    sink.Datagrams.clear();
+
+    market_manager.AddOrder(Order::Buy(3, test_symbol.Id, test_user0.Id, 97, 10));
+    publisher.Poll();
+    Deliver();
+
+    EXPECT_EQ(1, receiver.gaps());
+    EXPECT_EQ(nullptr, receiver.GetBook(test_symbol.Id));
+
+    publisher.PublishSnapshots();
+    Deliver();
+    ASSERT_NE(nullptr, receiver.GetBook(test_symbol.Id));
+    EXPECT_EQ(3, receiver.GetBook(test_symbol.Id)->bids().size());
+
+    market_manager.DeleteOrder(1);
+    market_manager.DeleteOrder(2);
+    market_manager.DeleteOrder(3);
+}
+
+TEST_F(MarketDataTest, UdpTest) {
+    boost::asio::io_context io_context;
+    boost::asio::ip::udp::socket socket(io_context, boost::asio::ip::udp::endpoint(
+            boost::asio::ip::make_address("127.0.0.1"), 0));
+    UdpMarketDataSink udp_sink(io_context, socket.local_endpoint());
+    MarketDataPublisher udp_publisher(ring, udp_sink, std::chrono::hours(1));
+
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 101, 10));
+    udp_publisher.Poll();
+    udp_publisher.PublishSnapshots();
+
+    std::array<boost::uint8_t, MaxMarketDataDatagramSize> buffer;
+    for (int i = 0; i < 2; ++i) {
+        size_t size = socket.receive(boost::asio::buffer(buffer));
+        EXPECT_TRUE(receiver.OnDatagram(buffer.data(), size));
+    }
+
+    ASSERT_NE(nullptr, receiver.GetBook(test_symbol.Id));
+    EXPECT_EQ(10, receiver.GetBook(test_symbol.Id)->asks().at(101).Volume);
+
+    market_manager.DeleteOrder(1);
+}
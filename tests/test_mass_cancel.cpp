@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+
+class MarketManagerMassCancelTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    const Symbol test_symbol0{0, "USDRUB"};
+    const Symbol test_symbol1{1, "EURRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol0);
+        market_manager.AddOrderBook(test_symbol0);
+        market_manager.AddSymbol(test_symbol1);
+        market_manager.AddOrderBook(test_symbol1, OrderBookOptions::Ladder(1, 64));
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+    }
+};
+
+TEST_F(MarketManagerMassCancelTest, UserOrdersAreIndexed) {
+    EXPECT_EQ(nullptr, market_manager.GetUserOrders(test_user0.Id));
+
+    market_manager.AddOrder(Order::Buy(1, test_symbol0.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol0.Id, test_user1.Id, 105, 10));
+    market_manager.AddOrder(Order::BuyStopLimit(3, test_symbol0.Id, test_user0.Id, 110, 108, 5));
+    market_manager.AddOrder(Order::Sell(4, test_symbol1.Id, test_user0.Id, 105, 4));
+    ASSERT_NE(nullptr, market_manager.GetUserOrders(test_user0.Id));
+    EXPECT_EQ(3, market_manager.GetUserOrders(test_user0.Id)->size());
+    EXPECT_EQ(1, market_manager.GetUserOrders(test_user0.Id)->front().Id);
+
+    // Filled and cancelled orders leave the list
+    market_manager.AddOrder(Order::Buy(5, test_symbol1.Id, test_user1.Id, 105, 4));
+    market_manager.DeleteOrder(1);
+    EXPECT_EQ(1, market_manager.GetUserOrders(test_user0.Id)->size());
+    EXPECT_EQ(3, market_manager.GetUserOrders(test_user0.Id)->front().Id);
+    EXPECT_EQ(1, market_manager.GetUserOrders(test_user1.Id)->size());
+}
+
+TEST_F(MarketManagerMassCancelTest, CancelsOnlyTheUserOrders) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol0.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol0.Id, test_user1.Id, 100, 10));
+    market_manager.AddOrder(Order::SellStopLimit(3, test_symbol0.Id, test_user0.Id, 90, 95, 5));
+    market_manager.AddOrder(Order::Sell(4, test_symbol1.Id, test_user0.Id, 105, 4));
+    market_manager.AddOrder(Order::Sell(5, test_symbol1.Id, test_user1.Id, 106, 4));
+
+    EXPECT_EQ(1, market_manager.CancelAllOrders(test_user0.Id, test_symbol1.Id));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(4));
+    EXPECT_EQ(106, market_manager.GetOrderBook(test_symbol1.Id)->best_ask()->Price);
+
+    EXPECT_EQ(2, market_manager.CancelAllOrders(test_user0.Id));
+    EXPECT_TRUE(market_manager.GetUserOrders(test_user0.Id)->empty());
+    EXPECT_EQ(2, market_manager.orders().size());
+    EXPECT_EQ(10, market_manager.GetOrderBook(test_symbol0.Id)->best_bid()->TotalVolume);
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol0.Id)->best_sell_stop());
+
+    EXPECT_EQ(0, market_manager.CancelAllOrders(test_user0.Id));
+    EXPECT_EQ(0, market_manager.CancelAllOrders(7));
+}
+
+TEST_F(MarketManagerMassCancelTest, StopsActivateOncePerBook) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol0.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol0.Id, test_user0.Id, 101, 10));
+    market_manager.AddOrder(Order::Sell(3, test_symbol0.Id, test_user1.Id, 103, 10));
+    market_manager.AddOrder(Order::BuyStopLimit(4, test_symbol0.Id, test_user1.Id, 105, 102, 5));
+
+    // Cancelling the offers below the stop price lifts the market to 103, which triggers the stop
+    EXPECT_EQ(2, market_manager.CancelAllOrders(test_user0.Id));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(4));
+    EXPECT_EQ(5, market_manager.GetOrder(3)->LeavesQuantity);
+}
+
+TEST_F(MarketManagerMassCancelTest, CancelsMoreThanOneBatch) {
+    const size_t orders = 3 * MarketManager::MaxBatchSize + 5;
+    for (boost::uint64_t id = 1; id <= 2 * orders; ++id) {
+        boost::uint64_t user_id = id % 2;
+        boost::uint64_t symbol_id = (id / 2) % 2;
+        market_manager.AddOrder(user_id ? Order::Sell(id, symbol_id, user_id, 110 + id % 20, 1)
+                                        : Order::Buy(id, symbol_id, user_id, 90 - id % 20, 1));
+    }
+    size_t orders_used = market_manager.order_pool_stats().Used;
+
+    EXPECT_EQ(orders, market_manager.CancelAllOrders(test_user1.Id));
+    EXPECT_TRUE(market_manager.GetUserOrders(test_user1.Id)->empty());
+    EXPECT_EQ(orders, market_manager.GetUserOrders(test_user0.Id)->size());
+    EXPECT_EQ(orders_used - orders, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol0.Id)->best_ask());
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol1.Id)->best_ask());
+}
+
+TEST_F(MarketManagerMassCancelTest, RejectsOrdersOfUnknownUsers) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol0.Id, test_user0.Id, 100, 10));
+
+    // An unregistered session sends the largest user id, which must not resize the user order lists
+    const boost::uint64_t unknown_user_id = std::numeric_limits<boost::uint64_t>::max();
+    EXPECT_EQ(ErrorCode::USER_NOT_FOUND,
+              market_manager.AddOrder(Order::Buy(2, test_symbol0.Id, unknown_user_id, 100, 10)));
+    EXPECT_EQ(ErrorCode::USER_NOT_FOUND, market_manager.AddOrder(Order::Buy(3, test_symbol0.Id, 7, 100, 10)));
+
+    const Order orders[] = {Order::Buy(4, test_symbol0.Id, unknown_user_id, 100, 10),
+                            Order::Buy(5, test_symbol0.Id, test_user1.Id, 100, 10)};
+    ErrorCode results[std::size(orders)];
+    EXPECT_EQ(1, market_manager.AddOrders(orders, results));
+    EXPECT_EQ(ErrorCode::USER_NOT_FOUND, results[0]);
+    EXPECT_EQ(ErrorCode::OK, results[1]);
+
+    EXPECT_EQ(nullptr, market_manager.GetOrder(2));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(4));
+    EXPECT_EQ(nullptr, market_manager.GetUserOrders(unknown_user_id));
+    EXPECT_EQ(1, market_manager.GetUserOrders(test_user0.Id)->size());
+    EXPECT_EQ(1, market_manager.GetUserOrders(test_user1.Id)->size());
+}
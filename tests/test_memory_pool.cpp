@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+
+class MemoryPoolTest : public ::testing::Test {
+protected:
+    MemoryPool<OrderNode, 4> pool;
+};
+
+TEST_F(MemoryPoolTest, CreateReleaseTest) {
+    OrderNode *order1_ptr = pool.Create(Order::Buy(1, 0, 0, 62, 10));
+    OrderNode *order2_ptr = pool.Create(Order::Sell(2, 0, 0, 63, 20));
+
+    EXPECT_EQ(1, order1_ptr->Id);
+    EXPECT_EQ(2, order2_ptr->Id);
+    EXPECT_EQ(nullptr, order1_ptr->Level);
+    EXPECT_EQ(2, pool.stats().Used);
+    EXPECT_EQ(4, pool.stats().Capacity);
+    EXPECT_EQ(1, pool.stats().Chunks);
+
+    pool.Release(order2_ptr);
+    EXPECT_EQ(1, pool.stats().Used);
+
+    OrderNode *order3_ptr = pool.Create(Order::Buy(3, 0, 0, 64, 30));
+    EXPECT_EQ(order2_ptr, order3_ptr);
+
+    pool.Release(order1_ptr);
+    pool.Release(order3_ptr);
+    EXPECT_EQ(0, pool.stats().Used);
+    EXPECT_EQ(2, pool.stats().HighWaterMark);
+}
+
+TEST_F(MemoryPoolTest, GrowTest) {
+    OrderNode *orders[9];
+    for (size_t i = 0; i < 9; ++i)
+        orders[i] = pool.Create(Order::Buy(i + 1, 0, 0, 62, 10));
+
+    EXPECT_EQ(9, pool.stats().Used);
+    EXPECT_EQ(12, pool.stats().Capacity);
+    EXPECT_EQ(3, pool.stats().Chunks);
+    EXPECT_EQ(3, pool.stats().Available());
+
+    for (auto &order_ptr: orders)
+        pool.Release(order_ptr);
+
+    EXPECT_EQ(0, pool.stats().Used);
+    EXPECT_EQ(9, pool.stats().HighWaterMark);
+    EXPECT_EQ(12, pool.stats().Capacity);
+}
+
+TEST_F(MemoryPoolTest, ReserveTest) {
+    pool.Reserve(10);
+
+    EXPECT_EQ(12, pool.stats().Capacity);
+    EXPECT_EQ(0, pool.stats().Used);
+    EXPECT_EQ(0, pool.stats().HighWaterMark);
+}
+
+class MarketManagerMemoryPoolTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user{0, "user"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol);
+        market_manager.AddUser(test_user);
+    }
+
+    void TearDown() override {
+        market_manager.DeleteUser(test_user.Id);
+        market_manager.DeleteOrderBook(test_symbol.Id);
+        market_manager.DeleteSymbol(test_symbol.Id);
+    }
+};
+
+TEST_F(MarketManagerMemoryPoolTest, OrderChurnTest) {
+    for (boost::uint64_t id = 1; id <= 100; ++id) {
+        market_manager.AddOrder(Order::Buy(id, test_symbol.Id, test_user.Id, 50 + (id % 10), 10));
+        market_manager.DeleteOrder(id);
+    }
+
+    EXPECT_EQ(0, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(1, market_manager.order_pool_stats().HighWaterMark);
+    EXPECT_EQ(0, market_manager.level_pool_stats().Used);
+    EXPECT_EQ(1, market_manager.level_pool_stats().HighWaterMark);
+    EXPECT_EQ(1, market_manager.order_pool_stats().Chunks);
+    EXPECT_EQ(1, market_manager.level_pool_stats().Chunks);
+}
+
+TEST_F(MarketManagerMemoryPoolTest, OccupancyTest) {
+    const Order order1 = Order::Buy(1, test_symbol.Id, test_user.Id, 62, 10);
+    const Order order2 = Order::Buy(2, test_symbol.Id, test_user.Id, 62, 20);
+    const Order order3 = Order::Sell(3, test_symbol.Id, test_user.Id, 64, 20);
+    market_manager.AddOrder(order1);
+    market_manager.AddOrder(order2);
+    market_manager.AddOrder(order3);
+
+    EXPECT_EQ(3, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(2, market_manager.level_pool_stats().Used);
+
+    const Order order4 = Order::Sell(4, test_symbol.Id, test_user.Id, 62, 30);
+    market_manager.AddOrder(order4);
+
+    EXPECT_EQ(1, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(1, market_manager.level_pool_stats().Used);
+    EXPECT_EQ(3, market_manager.order_pool_stats().HighWaterMark);
+    EXPECT_EQ(2, market_manager.level_pool_stats().HighWaterMark);
+
+    market_manager.DeleteOrder(order3.Id);
+}
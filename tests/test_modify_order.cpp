@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+
+class MarketManagerModifyOrderTest : public ::testing::TestWithParam<OrderBookLayout> {
+protected:
+    MarketManager market_manager;
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol, (GetParam() == OrderBookLayout::LADDER)
+                                                 ? OrderBookOptions::Ladder(1, 64) : OrderBookOptions::Tree());
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+    }
+
+    [[nodiscard]] const OrderBook &book() const { return *market_manager.GetOrderBook(test_symbol.Id); }
+};
+
+TEST_P(MarketManagerModifyOrderTest, QuantityDownKeepsPriority) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 100, 10));
+    const Order *order_ptr = market_manager.GetOrder(1);
+    size_t orders_used = market_manager.order_pool_stats().Used;
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(1, 100, 4));
+    EXPECT_EQ(order_ptr, market_manager.GetOrder(1));
+    EXPECT_EQ(orders_used, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(4, order_ptr->LeavesQuantity);
+    EXPECT_EQ(4, order_ptr->Quantity);
+    EXPECT_EQ(14, book().best_bid()->TotalVolume);
+    EXPECT_EQ(2, book().best_bid()->Orders);
+    EXPECT_EQ(14, book().top_of_book().Load().BidVolume);
+
+    // The modified order is still first in the queue
+    market_manager.AddOrder(Order::Sell(3, test_symbol.Id, test_user1.Id, 100, 5));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(1));
+    EXPECT_EQ(9, market_manager.GetOrder(2)->LeavesQuantity);
+}
+
+TEST_P(MarketManagerModifyOrderTest, QuantityUpLosesPriority) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 100, 10));
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(1, 100, 15));
+    EXPECT_EQ(25, book().best_bid()->TotalVolume);
+
+    market_manager.AddOrder(Order::Sell(3, test_symbol.Id, test_user1.Id, 100, 5));
+    EXPECT_EQ(15, market_manager.GetOrder(1)->LeavesQuantity);
+    EXPECT_EQ(5, market_manager.GetOrder(2)->LeavesQuantity);
+}
+
+TEST_P(MarketManagerModifyOrderTest, PriceChangeRelinksOrder) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(3, test_symbol.Id, test_user0.Id, 99, 10));
+    const Order *order_ptr = market_manager.GetOrder(1);
+    size_t orders_used = market_manager.order_pool_stats().Used;
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(1, 101, 10));
+    EXPECT_EQ(order_ptr, market_manager.GetOrder(1));
+    EXPECT_EQ(orders_used, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(101, order_ptr->Price);
+    EXPECT_EQ(101, book().best_bid()->Price);
+    EXPECT_EQ(3, book().bids().size());
+    EXPECT_EQ(10, book().GetBid(100)->TotalVolume);
+    EXPECT_EQ(1, book().GetBid(100)->Orders);
+
+    // Moving the only order of a level away deletes the level, joining a level queues at its back
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(1, 99, 10));
+    EXPECT_EQ(2, book().bids().size());
+    EXPECT_EQ(100, book().best_bid()->Price);
+    market_manager.AddOrder(Order::Sell(4, test_symbol.Id, test_user1.Id, 99, 25));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(3));
+    EXPECT_EQ(5, market_manager.GetOrder(1)->LeavesQuantity);
+}
+
+TEST_P(MarketManagerModifyOrderTest, CrossingPriceMatches) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user1.Id, 105, 5));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 100, 10));
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(2, 106, 8));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(1));
+    ASSERT_NE(nullptr, market_manager.GetOrder(2));
+    EXPECT_EQ(3, market_manager.GetOrder(2)->LeavesQuantity);
+    EXPECT_EQ(5, market_manager.GetOrder(2)->ExecutedQuantity);
+    EXPECT_EQ(8, market_manager.GetOrder(2)->Quantity);
+    EXPECT_EQ(-525, market_manager.GetUser(test_user0.Id)->Balance);
+    EXPECT_EQ(525, market_manager.GetUser(test_user1.Id)->Balance);
+    EXPECT_EQ(106, book().best_bid()->Price);
+    EXPECT_EQ(nullptr, book().best_ask());
+
+    // A modification that fills the whole order removes it
+    market_manager.AddOrder(Order::Sell(3, test_symbol.Id, test_user1.Id, 107, 10));
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(2, 107, 3));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(2));
+    EXPECT_EQ(7, market_manager.GetOrder(3)->LeavesQuantity);
+    EXPECT_EQ(nullptr, book().best_bid());
+}
+
+TEST_P(MarketManagerModifyOrderTest, StopOrders) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user1.Id, 100, 10));
+    market_manager.AddOrder(Order::BuyStopLimit(2, test_symbol.Id, test_user0.Id, 105, 102, 5));
+    market_manager.AddOrder(Order::BuyStopLimit(3, test_symbol.Id, test_user0.Id, 105, 102, 5));
+
+    // The limit price does not move a stop order in its queue
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(2, 104, 2));
+    EXPECT_EQ(104, market_manager.GetOrder(2)->Price);
+    EXPECT_EQ(102, market_manager.GetOrder(2)->StopPrice);
+    EXPECT_EQ(7, book().best_buy_stop()->TotalVolume);
+    EXPECT_EQ(2, book().best_buy_stop()->OrderList.front().Id);
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(2, 104, 6));
+    EXPECT_EQ(11, book().best_buy_stop()->TotalVolume);
+    EXPECT_EQ(3, book().best_buy_stop()->OrderList.front().Id);
+}
+
+TEST_P(MarketManagerModifyOrderTest, Errors) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 100, 10));
+
+    EXPECT_EQ(ErrorCode::ORDER_ID_INVALID, market_manager.ModifyOrder(0, 100, 5));
+    EXPECT_EQ(ErrorCode::ORDER_QUANTITY_INVALID, market_manager.ModifyOrder(1, 100, 0));
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, market_manager.ModifyOrder(7, 100, 5));
+    EXPECT_EQ(ErrorCode::ORDER_NOT_FOUND, market_manager.ModifyOrder(1, test_user1.Id, 100, 5));
+    EXPECT_EQ(ErrorCode::OK, market_manager.ModifyOrder(1, test_user0.Id, 100, 5));
+    EXPECT_EQ(5, market_manager.GetOrder(1)->LeavesQuantity);
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, MarketManagerModifyOrderTest,
+                         ::testing::Values(OrderBookLayout::TREE, OrderBookLayout::LADDER));
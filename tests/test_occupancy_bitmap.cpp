@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "../src/occupancy_bitmap.hpp"
+
+TEST(OccupancyBitmapTest, EmptyTest) {
+    OccupancyBitmap bitmap(4096);
+
+    EXPECT_TRUE(bitmap.empty());
+    EXPECT_EQ(OccupancyBitmap::npos, bitmap.Next(0));
+    EXPECT_EQ(OccupancyBitmap::npos, bitmap.Previous(4095));
+
+    OccupancyBitmap disabled;
+    EXPECT_EQ(OccupancyBitmap::npos, disabled.Next(0));
+    EXPECT_EQ(OccupancyBitmap::npos, disabled.Previous(0));
+}
+
+TEST(OccupancyBitmapTest, SetResetTest) {
+    OccupancyBitmap bitmap(4096);
+
+    bitmap.Set(0);
+    bitmap.Set(63);
+    bitmap.Set(64);
+    bitmap.Set(4095);
+
+    EXPECT_FALSE(bitmap.empty());
+    EXPECT_TRUE(bitmap.Test(63));
+    EXPECT_FALSE(bitmap.Test(62));
+    EXPECT_EQ(0, bitmap.Next(0));
+    EXPECT_EQ(63, bitmap.Next(1));
+    EXPECT_EQ(64, bitmap.Next(64));
+    EXPECT_EQ(4095, bitmap.Next(65));
+    EXPECT_EQ(64, bitmap.Previous(4094));
+    EXPECT_EQ(63, bitmap.Previous(63));
+    EXPECT_EQ(0, bitmap.Previous(62));
+
+    bitmap.Reset(63);
+    bitmap.Reset(64);
+
+    EXPECT_EQ(4095, bitmap.Next(1));
+    EXPECT_EQ(0, bitmap.Previous(4094));
+
+    bitmap.Reset(0);
+    bitmap.Reset(4095);
+
+    EXPECT_TRUE(bitmap.empty());
+}
+
+TEST(OccupancyBitmapTest, SparseTest) {
+    const size_t size = 64 * 64 * 64 + 17;
+    OccupancyBitmap bitmap(size);
+    std::set<size_t> expected;
+
+    for (size_t index = 5; index < size; index += 7919) {
+        bitmap.Set(index);
+        expected.insert(index);
+    }
+
+    for (size_t index = 0; index < size; index += 997) {
+        auto next = expected.lower_bound(index);
+        EXPECT_EQ((next != expected.end()) ? *next : OccupancyBitmap::npos, bitmap.Next(index));
+
+        auto previous = expected.upper_bound(index);
+        EXPECT_EQ((previous != expected.begin()) ? *std::prev(previous) : OccupancyBitmap::npos,
+                  bitmap.Previous(index));
+    }
+
+    EXPECT_EQ(OccupancyBitmap::npos, bitmap.Next(size));
+    EXPECT_EQ(*expected.rbegin(), bitmap.Previous(size + 100));
+}
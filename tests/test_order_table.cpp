@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+
+class OrderTableTest : public ::testing::TestWithParam<OrderTablePolicy> {
+protected:
+    OrderTable table{GetParam()};
+    OrderNodePool pool;
+
+    void TearDown() override {
+        table.ForEach([this](OrderNode *order_ptr) { pool.Release(order_ptr); });
+        table.clear();
+    }
+
+    OrderNode *Insert(boost::uint64_t id) {
+        OrderNode *order_ptr = pool.Create(Order::Buy(id, 0, 0, 62, 10));
+        if (!table.Insert(order_ptr)) {
+            pool.Release(order_ptr);
+            return nullptr;
+        }
+        return order_ptr;
+    }
+
+    void Erase(boost::uint64_t id) {
+        OrderNode *order_ptr = table.Find(id);
+        ASSERT_NE(nullptr, order_ptr);
+        EXPECT_TRUE(table.Erase(id));
+        pool.Release(order_ptr);
+    }
+};
+
+TEST_P(OrderTableTest, InsertFindEraseTest) {
+    OrderNode *order1_ptr = Insert(1);
+    OrderNode *order2_ptr = Insert(2);
+
+    EXPECT_EQ(2, table.size());
+    EXPECT_EQ(order1_ptr, table.Find(1));
+    EXPECT_EQ(order2_ptr, table.Find(2));
+    EXPECT_EQ(nullptr, table.Find(3));
+
+    EXPECT_EQ(nullptr, Insert(1));
+
+    Erase(1);
+
+    EXPECT_EQ(nullptr, table.Find(1));
+    EXPECT_FALSE(table.Erase(1));
+    EXPECT_EQ(1, table.size());
+}
+
+TEST_P(OrderTableTest, SparseIdsTest) {
+    const boost::uint64_t far_id = std::numeric_limits<boost::uint64_t>::max() - 5;
+
+    OrderNode *order1_ptr = Insert(10);
+    OrderNode *order2_ptr = Insert(far_id);
+    OrderNode *order3_ptr = Insert(10 + 7 * PagedOrderTable::PageSize);
+
+    EXPECT_EQ(order1_ptr, table.Find(10));
+    EXPECT_EQ(order2_ptr, table.Find(far_id));
+    EXPECT_EQ(order3_ptr, table.Find(10 + 7 * PagedOrderTable::PageSize));
+    EXPECT_EQ(nullptr, Insert(far_id));
+    EXPECT_EQ(3, table.size());
+
+    size_t count = 0;
+    table.ForEach([&count](OrderNode *) { ++count; });
+    EXPECT_EQ(3, count);
+
+    Erase(far_id);
+    EXPECT_EQ(nullptr, table.Find(far_id));
+}
+
+INSTANTIATE_TEST_SUITE_P(OrderTablePolicies, OrderTableTest,
+                         ::testing::Values(OrderTablePolicy::HASH, OrderTablePolicy::PAGED));
+
+TEST(PagedOrderTableTest, PageRecyclingTest) {
+    PagedOrderTable table;
+    OrderNodePool pool;
+    const boost::uint64_t count = 3 * PagedOrderTable::PageSize;
+
+    for (boost::uint64_t id = 1; id <= count; ++id)
+        ASSERT_TRUE(table.Insert(pool.Create(Order::Buy(id, 0, 0, 62, 10))));
+
+    EXPECT_EQ(4, table.pages());
+
+    for (boost::uint64_t id = 1; id <= 2 * PagedOrderTable::PageSize; ++id) {
+        OrderNode *order_ptr = table.Find(id);
+        ASSERT_TRUE(table.Erase(id));
+        pool.Release(order_ptr);
+    }
+
+    EXPECT_EQ(2, table.pages());
+    EXPECT_EQ(PagedOrderTable::PageSize, table.size());
+    EXPECT_EQ(count, table.Find(count)->Id);
+
+    OrderNode *late_ptr = pool.Create(Order::Buy(1, 0, 0, 62, 10));
+    ASSERT_TRUE(table.Insert(late_ptr));
+    EXPECT_EQ(late_ptr, table.Find(1));
+    EXPECT_EQ(4, table.pages());
+
+    table.ForEach([&pool](OrderNode *order_ptr) { pool.Release(order_ptr); });
+    table.clear();
+    EXPECT_EQ(0, table.size());
+}
+
+TEST(MarketManagerOrderTableTest, HashPolicyTest) {
+    MarketManager market_manager(OrderTablePolicy::HASH);
+    const Symbol test_symbol{0, "USDRUB"};
+    market_manager.AddSymbol(test_symbol);
+    market_manager.AddOrderBook(test_symbol);
+    market_manager.AddUser(User(0, "user"));
+
+    const Order order = Order::Buy(1234567890123, test_symbol.Id, 0, 62, 10);
+    EXPECT_EQ(ErrorCode::OK, market_manager.AddOrder(order));
+    EXPECT_EQ(OrderTablePolicy::HASH, market_manager.orders().policy());
+    EXPECT_EQ(order.Price, market_manager.GetOrder(order.Id)->Price);
+    EXPECT_EQ(ErrorCode::OK, market_manager.DeleteOrder(order.Id));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(order.Id));
+}
+
+TEST(PagedOrderTableTest, AddCancelFlowTest) {
+    PagedOrderTable table;
+    OrderNodePool pool;
+
+    // Every order is cancelled before the next one arrives, so no more than one page is ever needed
+    for (boost::uint64_t id = 1; id <= 8 * PagedOrderTable::PageSize; ++id) {
+        OrderNode *order_ptr = pool.Create(Order::Buy(id, 0, 0, 62, 10));
+        ASSERT_TRUE(table.Insert(order_ptr));
+        ASSERT_TRUE(table.Erase(id));
+        pool.Release(order_ptr);
+        ASSERT_EQ(1, table.pages());
+    }
+
+    EXPECT_EQ(0, table.size());
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+
+class PriceLadderTest : public ::testing::Test {
+protected:
+    LevelNodeSet levels;
+    PriceLadder ladder{5, 8};
+
+    void TearDown() override {
+        levels.clear_and_dispose([](LevelNode *level_ptr) { delete level_ptr; });
+    }
+
+    LevelNode *AddLevel(boost::uint64_t price) {
+        auto *level_ptr = new LevelNode(LevelType::ASK, price);
+        levels.insert(*level_ptr);
+        ladder.Insert(level_ptr);
+        return level_ptr;
+    }
+};
+
+TEST_F(PriceLadderTest, CoversTest) {
+    EXPECT_FALSE(PriceLadder().Covers(0));
+    EXPECT_FALSE(PriceLadder().enabled());
+
+    EXPECT_TRUE(ladder.Covers(0));
+    EXPECT_TRUE(ladder.Covers(35));
+    EXPECT_FALSE(ladder.Covers(40));
+    EXPECT_FALSE(ladder.Covers(12));
+    EXPECT_TRUE(ladder.InWindow(12));
+}
+
+TEST_F(PriceLadderTest, LowerHigherTest) {
+    LevelNode *level1_ptr = AddLevel(5);
+    LevelNode *level2_ptr = AddLevel(25);
+    AddLevel(60);
+
+    EXPECT_EQ(level1_ptr, ladder.Get(5));
+    EXPECT_EQ(nullptr, ladder.Get(10));
+    EXPECT_EQ(level2_ptr, ladder.Higher(5));
+    EXPECT_EQ(nullptr, ladder.Higher(25));
+    EXPECT_EQ(level1_ptr, ladder.Lower(25));
+    EXPECT_EQ(nullptr, ladder.Lower(5));
+    EXPECT_TRUE(ladder.exact());
+
+    ladder.Erase(level2_ptr);
+    EXPECT_EQ(nullptr, ladder.Higher(5));
+}
+
+TEST_F(PriceLadderTest, RecenterTest) {
+    AddLevel(5);
+    LevelNode *level2_ptr = AddLevel(60);
+    LevelNode *level3_ptr = AddLevel(75);
+
+    ladder.Recenter(60, levels);
+
+    EXPECT_EQ(40, ladder.base());
+    EXPECT_FALSE(ladder.Covers(5));
+    EXPECT_EQ(level2_ptr, ladder.Get(60));
+    EXPECT_EQ(level3_ptr, ladder.Higher(60));
+}
+
+TEST_F(PriceLadderTest, OffGridTest) {
+    LevelNode *level_ptr = AddLevel(12);
+
+    EXPECT_FALSE(ladder.exact());
+    EXPECT_EQ(nullptr, ladder.Get(10));
+
+    levels.erase(levels.iterator_to(*level_ptr));
+    ladder.Erase(level_ptr);
+    delete level_ptr;
+
+    EXPECT_TRUE(ladder.exact());
+}
+
+class MarketManagerPriceLadderTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol, OrderBookOptions::Ladder(1, 16));
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+    }
+
+    void TearDown() override {
+        market_manager.DeleteUser(test_user0.Id);
+        market_manager.DeleteUser(test_user1.Id);
+        market_manager.DeleteOrderBook(test_symbol.Id);
+        market_manager.DeleteSymbol(test_symbol.Id);
+    }
+};
+
+TEST_F(MarketManagerPriceLadderTest, LayoutTest) {
+    EXPECT_TRUE(market_manager.GetOrderBook(test_symbol.Id)->options().IsLadder());
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->options().TickSize);
+}
+
+TEST_F(MarketManagerPriceLadderTest, SweepBidsTest) {
+    for (boost::uint64_t price = 100; price < 104; ++price)
+        market_manager.AddOrder(Order::Buy(price, test_symbol.Id, test_user0.Id, price, 10));
+
+    EXPECT_EQ(4, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(103, market_manager.GetOrderBook(test_symbol.Id)->best_bid()->Price);
+
+    const Order order = Order::Sell(200, test_symbol.Id, test_user1.Id, 101, 25);
+    market_manager.AddOrder(order);
+
+    EXPECT_EQ(2, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(101, market_manager.GetOrderBook(test_symbol.Id)->best_bid()->Price);
+    EXPECT_EQ(5, market_manager.GetOrderBook(test_symbol.Id)->best_bid()->TotalVolume);
+    EXPECT_EQ(100, market_manager.GetOrderBook(test_symbol.Id)->GetBid(100)->Price);
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->GetBid(102));
+    EXPECT_EQ(-(103 * 10 + 102 * 10 + 101 * 5), market_manager.GetUser(test_user0.Id)->Balance);
+
+    market_manager.DeleteOrder(100);
+    market_manager.DeleteOrder(101);
+}
+
+TEST_F(MarketManagerPriceLadderTest, DriftTest) {
+    const Order order1 = Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10);
+    const Order order2 = Order::Sell(2, test_symbol.Id, test_user0.Id, 130, 10);
+    const Order order3 = Order::Sell(3, test_symbol.Id, test_user0.Id, 500, 10);
+    market_manager.AddOrder(order1);
+    market_manager.AddOrder(order2);
+    market_manager.AddOrder(order3);
+
+    EXPECT_EQ(order2.Price, market_manager.GetOrderBook(test_symbol.Id)->GetAsk(order2.Price)->Price);
+    EXPECT_EQ(order3.Price, market_manager.GetOrderBook(test_symbol.Id)->GetAsk(order3.Price)->Price);
+
+    market_manager.AddOrder(Order::Buy(4, test_symbol.Id, test_user1.Id, 130, 20));
+
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(order3.Price, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->Price);
+
+    market_manager.AddOrder(Order::Sell(5, test_symbol.Id, test_user0.Id, 501, 10));
+    market_manager.AddOrder(Order::Buy(6, test_symbol.Id, test_user1.Id, 501, 10));
+
+    EXPECT_EQ(order3.Price + 1, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->Price);
+
+    market_manager.DeleteOrder(5);
+}
+
+TEST_F(MarketManagerPriceLadderTest, OffGridTest) {
+    market_manager.AddSymbol(Symbol(1, "EURRUB"));
+    market_manager.AddOrderBook(Symbol(1, "EURRUB"), OrderBookOptions::Ladder(10, 16));
+
+    market_manager.AddOrder(Order::Buy(1, 1, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, 1, test_user0.Id, 95, 10));
+    market_manager.AddOrder(Order::Buy(3, 1, test_user0.Id, 90, 10));
+
+    EXPECT_EQ(95, market_manager.GetOrderBook(1)->GetBid(95)->Price);
+
+    market_manager.AddOrder(Order::Sell(4, 1, test_user1.Id, 100, 10));
+
+    EXPECT_EQ(95, market_manager.GetOrderBook(1)->best_bid()->Price);
+
+    market_manager.DeleteOrder(2);
+
+    EXPECT_EQ(90, market_manager.GetOrderBook(1)->best_bid()->Price);
+
+    market_manager.DeleteOrder(3);
+    market_manager.DeleteOrderBook(1);
+    market_manager.DeleteSymbol(1);
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "../src/json_framer.hpp"
+#include "../src/receive_buffer.hpp"
+#include "../src/reply_queue.hpp"
+
+static void Append(ReceiveBuffer &buffer, const std::string &data) {
+    std::memcpy(buffer.Prepare(data.size()), data.data(), data.size());
+    buffer.Commit(data.size());
+}
+
+static std::string Front(const ReceiveBuffer &buffer, size_t size) {
+    return std::string(reinterpret_cast<const char *>(buffer.data()), size);
+}
+
+TEST(ReceiveBufferTest, ConsumeTest) {
+    ReceiveBuffer buffer(16);
+    EXPECT_TRUE(buffer.empty());
+
+    Append(buffer, "abcdef");
+    EXPECT_EQ(6, buffer.size());
+    buffer.Consume(4);
+    EXPECT_EQ("ef", Front(buffer, buffer.size()));
+
+    // The tail is moved to the front instead of growing
+    Append(buffer, "0123456789abc");
+    EXPECT_EQ(16, buffer.capacity());
+    EXPECT_EQ("ef0123456789abc", Front(buffer, buffer.size()));
+
+    buffer.Consume(buffer.size());
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(16, buffer.available());
+}
+
+TEST(ReceiveBufferTest, GrowTest) {
+    ReceiveBuffer buffer(4);
+    Append(buffer, "abc");
+    Append(buffer, "defghij");
+    EXPECT_LE(10, buffer.capacity());
+    EXPECT_EQ("abcdefghij", Front(buffer, buffer.size()));
+}
+
+TEST(JsonFramerTest, FrameTest) {
+    std::string stream = " {\"a\":{\"b\":[1,{}]}}\n{\"s\":\"}{\\\"\"}{\"c\"";
+    auto data = reinterpret_cast<const boost::uint8_t *>(stream.data());
+
+    JsonFramer framer;
+    size_t begin = 0;
+    size_t end = framer.Next(data, stream.size(), begin);
+    EXPECT_EQ(1, begin);
+    EXPECT_EQ("{\"a\":{\"b\":[1,{}]}}", stream.substr(begin, end - begin));
+
+    // Braces and escaped quotes inside strings do not count
+    stream.erase(0, end);
+    data = reinterpret_cast<const boost::uint8_t *>(stream.data());
+    end = framer.Next(data, stream.size(), begin);
+    EXPECT_EQ("{\"s\":\"}{\\\"\"}", stream.substr(begin, end - begin));
+
+    // An incomplete object waits for the rest of it
+    stream.erase(0, end);
+    data = reinterpret_cast<const boost::uint8_t *>(stream.data());
+    EXPECT_EQ(0, framer.Next(data, stream.size(), begin));
+
+    stream += ":1}";
+    data = reinterpret_cast<const boost::uint8_t *>(stream.data());
+    end = framer.Next(data, stream.size(), begin);
+    EXPECT_EQ("{\"c\":1}", stream.substr(begin, end - begin));
+}
+
+TEST(JsonFramerTest, InvalidTest) {
+    std::string stream = "[1]";
+    size_t begin = 0;
+
+    JsonFramer framer;
+    EXPECT_EQ(JsonFramer::npos, framer.Next(reinterpret_cast<const boost::uint8_t *>(stream.data()), stream.size(),
+                                            begin));
+}
+
+TEST(ReplyQueueTest, OrderTest) {
+    ReplyQueue<std::string> replies;
+    auto first = replies.Reserve();
+    auto second = replies.Reserve();
+    EXPECT_EQ(2, replies.size());
+
+    // A reply that is ready early waits for the ones before it
+    replies.Complete(second, "second");
+    EXPECT_FALSE(replies.ready());
+    replies.Complete(first, "first");
+    ASSERT_TRUE(replies.ready());
+    EXPECT_EQ("first", replies.front());
+    replies.Pop();
+
+    auto third = replies.Reserve();
+    ASSERT_TRUE(replies.ready());
+    EXPECT_EQ("second", replies.front());
+    replies.Pop();
+    EXPECT_FALSE(replies.ready());
+
+    replies.Complete(third, "third");
+    EXPECT_EQ("third", replies.front());
+}
+
+TEST(ReplyQueueTest, GatherTest) {
+    ReplyQueue<std::string> replies;
+    for (int i = 0; i < 4; ++i)
+        replies.Reserve();
+    replies.Complete(0, "a");
+    replies.Complete(1, "b");
+    replies.Complete(3, "d");
+
+    std::string gathered;
+    EXPECT_EQ(2, replies.Gather([&gathered](const std::string &reply) { gathered += reply; }, MaxGatheredReplies));
+    EXPECT_EQ("ab", gathered);
+    EXPECT_EQ(1, replies.Gather([](const std::string &) {}, 1));
+
+    replies.Pop(2);
+    EXPECT_FALSE(replies.ready());
+    replies.Complete(2, "c");
+    EXPECT_EQ(2, replies.Gather([](const std::string &) {}, MaxGatheredReplies));
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include "../src/binary_session.hpp"
+
+// Counts the heap allocations of the whole process while enabled, and separately those of the matching thread
+static std::atomic<bool> counting(false);
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> matching_allocations(0);
+static thread_local bool matching_thread = false;
+
+void *operator new(size_t size) {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if (matching_thread)
+            matching_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+// Counts the allocations of pipelined batches of an order, its cancel and a balance request, run once the session is
+// warmed up
+static size_t SteadyStateAllocations(ShardedEngine *engine_ptr) {
+    boost::asio::io_service io_service;
+    MarketManager market_manager;
+    EngineIds engine_ids;
+    IoStrand engine_strand{boost::asio::make_strand(io_service)};
+    const Symbol test_symbol{0, "USDRUB"};
+    market_manager.AddSymbol(test_symbol);
+    market_manager.AddOrderBook(test_symbol);
+
+    BinaryServer server(io_service, 0, market_manager, engine_ptr, engine_ids, engine_strand);
+    std::thread io_thread([&io_service]() { io_service.run(); });
+
+    boost::asio::ip::tcp::socket socket(io_service);
+    socket.connect({boost::asio::ip::make_address("127.0.0.1"), server.local_endpoint().port()});
+
+    RegisterRequest registration{{sizeof(RegisterRequest), BinaryMessageType::REGISTER}, "user0"};
+    AckMessage ack;
+    boost::asio::write(socket, boost::asio::buffer(&registration, sizeof(registration)));
+    boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)));
+    EXPECT_EQ(ErrorCode::OK, ack.Error);
+
+    auto batch = [&socket]() {
+        AddOrderRequest add{{sizeof(AddOrderRequest), BinaryMessageType::ADD_ORDER}, 0, OrderSide::BUY, 100, 1};
+        boost::asio::write(socket, boost::asio::buffer(&add, sizeof(add)));
+
+        AckMessage acks[3];
+        boost::asio::read(socket, boost::asio::buffer(&acks[0], sizeof(AckMessage)));
+
+        CancelOrderRequest cancel{{sizeof(CancelOrderRequest), BinaryMessageType::CANCEL_ORDER}, 0, acks[0].OrderId};
+        BalanceRequest balance{{sizeof(BalanceRequest), BinaryMessageType::BALANCE}};
+        boost::uint8_t requests[sizeof(cancel) + sizeof(balance)];
+        EncodeBinaryMessage(cancel, requests);
+        EncodeBinaryMessage(balance, requests + sizeof(cancel));
+        boost::asio::write(socket, boost::asio::buffer(requests));
+        boost::asio::read(socket, boost::asio::buffer(&acks[1], 2 * sizeof(AckMessage)));
+
+        return (acks[0].Error == ErrorCode::OK) && (acks[1].Error == ErrorCode::OK) &&
+               (acks[2].Error == ErrorCode::OK);
+    };
+
+    // Long enough for the order table to recycle its pages
+    bool ok = true;
+    for (size_t i = 0; i < 3 * PagedOrderTable::PageSize; ++i)
+        ok = batch() && ok;
+
+    allocations = 0;
+    matching_allocations = 0;
+    counting = true;
+    for (int i = 0; i < 10000; ++i)
+        ok = batch() && ok;
+    counting = false;
+
+    EXPECT_TRUE(ok);
+
+    io_service.stop();
+    io_thread.join();
+    return allocations.load();
+}
+
+TEST(SessionAllocationTest, SteadyStateTest) {
+    EXPECT_EQ(0, SteadyStateAllocations(nullptr));
+}
+
+// Replies reach the session through slots it preallocated, so the shard never allocates. The I/O thread still does
+// now and then, asio keeps a single spare block per thread for its own strand and socket operations.
+TEST(SessionAllocationTest, EngineSteadyStateTest) {
+    ShardedEngine engine(1);
+    engine.AddSymbol({0, "USDRUB"});
+    engine.Start();
+    engine.GetBalance(0, 0, [](void *, ErrorCode, boost::int64_t) { matching_thread = true; }, nullptr);
+
+    SteadyStateAllocations(&engine);
+    EXPECT_EQ(0, matching_allocations.load());
+
+    engine.Stop();
+}
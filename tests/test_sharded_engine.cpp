@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include "../src/sharded_engine.hpp"
+
+class ShardedEngineTest : public ::testing::Test {
+protected:
+    ShardedEngine engine{2, 2, 64};
+    const Symbol test_symbol0{0, "USDRUB"};
+    const Symbol test_symbol1{1, "EURRUB"};
+
+    class Results {
+    public:
+        std::atomic<size_t> Count{0};
+        std::atomic<size_t> Failed{0};
+        std::atomic<boost::int64_t> Balance{0};
+    };
+
+    static void OnResult(void *context, ErrorCode result, boost::int64_t value) {
+        auto *results_ptr = static_cast<Results *>(context);
+        results_ptr->Balance += value;
+        if (result != ErrorCode::OK)
+            ++results_ptr->Failed;
+        ++results_ptr->Count;
+    }
+
+    void SetUp() override {
+        engine.AddSymbol(test_symbol0);
+        engine.AddSymbol(test_symbol1);
+    }
+};
+
+TEST_F(ShardedEngineTest, ShardsTest) {
+    EXPECT_EQ(2, engine.shards());
+    EXPECT_EQ(0, engine.GetShard(test_symbol0.Id));
+    EXPECT_EQ(1, engine.GetShard(test_symbol1.Id));
+
+    EXPECT_NE(nullptr, engine.market_manager(0).GetOrderBook(test_symbol0.Id));
+    EXPECT_EQ(nullptr, engine.market_manager(0).GetOrderBook(test_symbol1.Id));
+    EXPECT_NE(nullptr, engine.market_manager(1).GetOrderBook(test_symbol1.Id));
+
+    EXPECT_EQ(ErrorCode::SYMBOL_DUPLICATE, engine.AddSymbol(test_symbol0));
+}
+
+TEST_F(ShardedEngineTest, MatchingTest) {
+    Results users;
+    Results orders;
+    Results balance;
+
+    engine.Start();
+
+    engine.AddUser(0, 0, &OnResult, &users);
+    engine.AddUser(0, 1, &OnResult, &users);
+
+    // Two producers feeding both shards, each symbol gets a resting sell and a crossing buy
+    for (boost::uint64_t id = 1; id <= 1000; ++id) {
+        engine.AddOrder(0, Order::Sell(id, id % 2, 0, 100, 1), &OnResult, &orders);
+        engine.AddOrder(1, Order::Buy(1000 + id, id % 2, 1, 100, 1), &OnResult, &orders);
+    }
+    engine.DeleteOrder(0, test_symbol0.Id, 12345, 0, &OnResult, &orders);
+
+    engine.Stop();
+
+    EXPECT_EQ(4, users.Count);
+    EXPECT_EQ(0, users.Failed);
+    EXPECT_EQ(2001, orders.Count);
+    EXPECT_EQ(1, orders.Failed);
+
+    // Orders and buys on either producer may arrive first, but every unit ends up matched
+    for (size_t shard = 0; shard < engine.shards(); ++shard) {
+        const OrderBook *order_book_ptr = engine.market_manager(shard).GetOrderBook(shard);
+        EXPECT_EQ(0, order_book_ptr->size());
+        EXPECT_EQ(0, engine.market_manager(shard).orders().size());
+    }
+
+    engine.Start();
+    engine.GetBalance(0, 0, &OnResult, &balance);
+    engine.Stop();
+
+    EXPECT_EQ(2, balance.Count);
+    EXPECT_EQ(1000 * 100, balance.Balance);
+}
+
+TEST_F(ShardedEngineTest, ReplaceOrderTest) {
+    const Symbol test_symbol2{2, "GBPRUB"};
+    engine.AddSymbol(test_symbol2);
+
+    Results users;
+    Results orders;
+
+    engine.Start();
+
+    engine.AddUser(0, 0, &OnResult, &users);
+    engine.AddOrder(0, Order::Sell(1, test_symbol0.Id, 0, 100, 10), &OnResult, &orders);
+    engine.AddOrder(0, Order::Sell(2, test_symbol1.Id, 0, 100, 10), &OnResult, &orders);
+
+    // The symbol has to match the replaced order, whether it lives on the same shard or another one
+    engine.ReplaceOrder(0, test_symbol2.Id, 1, 0, 3, 101, 5, &OnResult, &orders);
+    engine.ReplaceOrder(0, test_symbol0.Id, 2, 0, 4, 101, 5, &OnResult, &orders);
+    engine.ReplaceOrder(0, test_symbol0.Id, 1, 1, 5, 101, 5, &OnResult, &orders);
+    engine.ReplaceOrder(0, test_symbol0.Id, 1, 0, 6, 101, 5, &OnResult, &orders);
+
+    engine.Stop();
+
+    EXPECT_EQ(6, orders.Count);
+    EXPECT_EQ(3, orders.Failed);
+
+    const MarketManager &market_manager = engine.market_manager(0);
+    EXPECT_EQ(nullptr, market_manager.GetOrder(1));
+    EXPECT_EQ(nullptr, market_manager.GetOrder(3));
+    const Order *order_ptr = market_manager.GetOrder(6);
+    ASSERT_NE(nullptr, order_ptr);
+    EXPECT_EQ(test_symbol0.Id, order_ptr->SymbolId);
+    EXPECT_EQ(OrderSide::SELL, order_ptr->Side);
+    EXPECT_EQ(101, order_ptr->Price);
+    EXPECT_EQ(5, order_ptr->Quantity);
+    EXPECT_NE(nullptr, engine.market_manager(1).GetOrder(2));
+}
+
+TEST_F(ShardedEngineTest, ModifyOrderTest) {
+    const Symbol test_symbol2{2, "GBPRUB"};
+    engine.AddSymbol(test_symbol2);
+
+    Results users;
+    Results orders;
+
+    engine.Start();
+
+    engine.AddUser(0, 0, &OnResult, &users);
+    engine.AddOrder(0, Order::Sell(1, test_symbol0.Id, 0, 100, 10), &OnResult, &orders);
+
+    // Symbols 0 and 2 share a shard, so the symbol has to be checked there
+    engine.ModifyOrder(0, test_symbol2.Id, 1, 0, 102, 3, &OnResult, &orders);
+    engine.ModifyOrder(0, test_symbol0.Id, 1, 1, 102, 3, &OnResult, &orders);
+    engine.ModifyOrder(0, test_symbol0.Id, 1, 0, 101, 5, &OnResult, &orders);
+
+    engine.Stop();
+
+    EXPECT_EQ(4, orders.Count);
+    EXPECT_EQ(2, orders.Failed);
+
+    const Order *order_ptr = engine.market_manager(0).GetOrder(1);
+    ASSERT_NE(nullptr, order_ptr);
+    EXPECT_EQ(test_symbol0.Id, order_ptr->SymbolId);
+    EXPECT_EQ(101, order_ptr->Price);
+    EXPECT_EQ(5, order_ptr->Quantity);
+}
+
+TEST_F(ShardedEngineTest, DeleteOrderTest) {
+    const Symbol test_symbol2{2, "GBPRUB"};
+    engine.AddSymbol(test_symbol2);
+
+    Results users;
+    Results orders;
+
+    engine.Start();
+
+    engine.AddUser(0, 0, &OnResult, &users);
+    engine.AddOrder(0, Order::Sell(1, test_symbol0.Id, 0, 100, 10), &OnResult, &orders);
+
+    // Symbols 0 and 2 share a shard, a cancel naming the wrong one must leave the order alone
+    engine.DeleteOrder(0, test_symbol2.Id, 1, 0, &OnResult, &orders);
+    engine.DeleteOrder(0, test_symbol1.Id, 1, 0, &OnResult, &orders);
+
+    engine.Stop();
+
+    EXPECT_EQ(3, orders.Count);
+    EXPECT_EQ(2, orders.Failed);
+    EXPECT_NE(nullptr, engine.market_manager(0).GetOrder(1));
+
+    engine.Start();
+    engine.DeleteOrder(0, test_symbol0.Id, 1, 0, &OnResult, &orders);
+    engine.Stop();
+
+    EXPECT_EQ(4, orders.Count);
+    EXPECT_EQ(2, orders.Failed);
+    EXPECT_EQ(nullptr, engine.market_manager(0).GetOrder(1));
+}
@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <unistd.h>
+
+#include "../src/journal.hpp"
+#include "../src/market_manager.hpp"
+#include "../src/snapshot.hpp"
+
+class SnapshotTest : public ::testing::Test {
+protected:
+    std::string path;
+    const Symbol test_symbol0{0, "USDRUB"};
+    const Symbol test_symbol1{1, "EURRUB"};
+
+    void SetUp() override {
+        path = (std::filesystem::temp_directory_path() /
+                ("snapshot_test_" + std::to_string(::getpid()) + "_" +
+                 ::testing::UnitTest::GetInstance()->current_test_info()->name())).string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+    }
+
+    void Setup(MarketManager &market_manager) const {
+        market_manager.AddSymbol(test_symbol0);
+        market_manager.AddOrderBook(test_symbol0);
+        market_manager.AddSymbol(test_symbol1);
+        market_manager.AddOrderBook(test_symbol1, OrderBookOptions::Ladder(1, 64));
+        for (boost::uint64_t user_id = 0; user_id < 8; ++user_id)
+            market_manager.AddUser(User(user_id, "user" + std::to_string(user_id)));
+    }
+
+    // Crossing limit, iceberg, stop and trailing stop orders and cancels
+    static void Trade(MarketManager &market_manager, size_t orders, unsigned seed) {
+        std::mt19937 random(seed);
+        for (size_t i = 0; i < orders; ++i) {
+            boost::uint64_t id = market_manager.GetOrdersCount();
+            boost::uint64_t symbol_id = random() % 2;
+            boost::uint64_t user_id = random() % 8;
+            boost::uint64_t price = 90 + random() % 20;
+            boost::uint64_t quantity = 1 + random() % 10;
+
+            switch (random() % 8) {
+                case 0:
+                    market_manager.DeleteOrder(1 + random() % id);
+                    break;
+                case 1:
+                    market_manager.AddOrder(Order::BuyStopLimit(id, symbol_id, user_id, price, price + 3, quantity));
+                    break;
+                case 2:
+                    market_manager.AddOrder(Order::SellStopLimit(id, symbol_id, user_id, price, price - 3, quantity));
+                    break;
+                case 3:
+                    market_manager.AddOrder((random() % 2)
+                                            ? Order::TrailingBuyStopLimit(id, symbol_id, user_id, price, 200, quantity,
+                                                                          5, 1)
+                                            : Order::TrailingSellStopLimit(id, symbol_id, user_id, price, 0, quantity,
+                                                                           5, 1));
+                    break;
+                case 4:
+                    market_manager.AddOrder(Order::Buy(id, symbol_id, user_id, price, quantity, 2));
+                    break;
+                case 5:
+                    market_manager.AddOrder(Order::Buy(id, symbol_id, user_id, price, quantity));
+                    break;
+                default:
+                    market_manager.AddOrder(Order::Sell(id, symbol_id, user_id, price, quantity));
+                    break;
+            }
+        }
+    }
+
+    static void ExpectSameLevels(const LevelNodeSet &expected, const LevelNodeSet &actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (auto it1 = expected.begin(), it2 = actual.begin(); it1 != expected.end(); ++it1, ++it2) {
+            EXPECT_EQ(it1->Type, it2->Type);
+            EXPECT_EQ(it1->Price, it2->Price);
+            EXPECT_EQ(it1->TotalVolume, it2->TotalVolume);
+            EXPECT_EQ(it1->HiddenVolume, it2->HiddenVolume);
+            EXPECT_EQ(it1->VisibleVolume, it2->VisibleVolume);
+            EXPECT_EQ(it1->Orders, it2->Orders);
+            ASSERT_EQ(it1->OrderList.size(), it2->OrderList.size());
+            for (auto order1 = it1->OrderList.begin(), order2 = it2->OrderList.begin();
+                 order1 != it1->OrderList.end(); ++order1, ++order2) {
+                EXPECT_EQ(order1->Id, order2->Id);
+                EXPECT_EQ(order1->StopPrice, order2->StopPrice);
+                EXPECT_EQ(order1->LeavesQuantity, order2->LeavesQuantity);
+                EXPECT_EQ(order1->TrailingSequence, order2->TrailingSequence);
+                EXPECT_EQ(&*it2, order2->Level);
+            }
+        }
+    }
+
+    static void ExpectSameState(const MarketManager &expected, const MarketManager &actual) {
+        EXPECT_EQ(expected.GetOrdersCount(), actual.GetOrdersCount());
+        EXPECT_EQ(expected.orders().size(), actual.orders().size());
+
+        ASSERT_EQ(expected.users().size(), actual.users().size());
+        for (size_t user_id = 0; user_id < expected.users().size(); ++user_id) {
+            ASSERT_NE(nullptr, actual.GetUser(user_id));
+            EXPECT_EQ(expected.GetUser(user_id)->Name, actual.GetUser(user_id)->Name);
+            EXPECT_EQ(expected.GetUser(user_id)->Balance, actual.GetUser(user_id)->Balance);
+
+            const UserOrderList *expected_orders_ptr = expected.GetUserOrders(user_id);
+            const UserOrderList *actual_orders_ptr = actual.GetUserOrders(user_id);
+            size_t expected_size = (expected_orders_ptr != nullptr) ? expected_orders_ptr->size() : 0;
+            size_t actual_size = (actual_orders_ptr != nullptr) ? actual_orders_ptr->size() : 0;
+            ASSERT_EQ(expected_size, actual_size);
+            if (expected_size == 0)
+                continue;
+            for (auto order1 = expected_orders_ptr->begin(), order2 = actual_orders_ptr->begin();
+                 order1 != expected_orders_ptr->end(); ++order1, ++order2)
+                EXPECT_EQ(order1->Id, order2->Id);
+        }
+
+        for (boost::uint64_t symbol_id = 0; symbol_id < 2; ++symbol_id) {
+            const OrderBook *expected_ptr = expected.GetOrderBook(symbol_id);
+            const OrderBook *actual_ptr = actual.GetOrderBook(symbol_id);
+            ASSERT_NE(nullptr, actual_ptr);
+            EXPECT_EQ(expected_ptr->symbol().Name, actual_ptr->symbol().Name);
+            EXPECT_EQ(expected_ptr->options().Layout, actual_ptr->options().Layout);
+            ExpectSameLevels(expected_ptr->bids(), actual_ptr->bids());
+            ExpectSameLevels(expected_ptr->asks(), actual_ptr->asks());
+            ExpectSameLevels(expected_ptr->buy_stop(), actual_ptr->buy_stop());
+            ExpectSameLevels(expected_ptr->sell_stop(), actual_ptr->sell_stop());
+            ExpectSameLevels(expected_ptr->trailing_buy_stop(), actual_ptr->trailing_buy_stop());
+            ExpectSameLevels(expected_ptr->trailing_sell_stop(), actual_ptr->trailing_sell_stop());
+
+            auto price = [](const LevelNode *level_ptr) { return (level_ptr != nullptr) ? level_ptr->Price : 0; };
+            EXPECT_EQ(price(expected_ptr->best_bid()), price(actual_ptr->best_bid()));
+            EXPECT_EQ(price(expected_ptr->best_ask()), price(actual_ptr->best_ask()));
+            EXPECT_EQ(price(expected_ptr->best_buy_stop()), price(actual_ptr->best_buy_stop()));
+            EXPECT_EQ(price(expected_ptr->best_sell_stop()), price(actual_ptr->best_sell_stop()));
+            EXPECT_EQ(price(expected_ptr->best_trailing_buy_stop()), price(actual_ptr->best_trailing_buy_stop()));
+            EXPECT_EQ(price(expected_ptr->best_trailing_sell_stop()), price(actual_ptr->best_trailing_sell_stop()));
+            EXPECT_EQ(expected_ptr->top_of_book().Load(), actual_ptr->top_of_book().Load());
+        }
+    }
+};
+
+TEST_F(SnapshotTest, LoadRestoresState) {
+    MarketManager market_manager;
+    Setup(market_manager);
+    Trade(market_manager, 5000, 13);
+    ASSERT_FALSE(market_manager.orders().empty());
+
+    Snapshot::Save(market_manager, path, 42);
+
+    MarketManager loaded;
+    EXPECT_EQ(42, Snapshot::Load(loaded, path));
+    ExpectSameState(market_manager, loaded);
+
+    // The loaded books keep matching, triggering stops and moving trailing stops exactly like the original ones
+    Trade(market_manager, 5000, 17);
+    Trade(loaded, 5000, 17);
+    ExpectSameState(market_manager, loaded);
+}
+
+TEST_F(SnapshotTest, EmptyManager) {
+    MarketManager market_manager;
+    Snapshot::Save(market_manager, path);
+
+    MarketManager loaded;
+    EXPECT_EQ(0, Snapshot::Load(loaded, path));
+    EXPECT_TRUE(loaded.symbols().empty());
+    EXPECT_EQ(market_manager.GetOrdersCount(), loaded.GetOrdersCount());
+}
+
+TEST_F(SnapshotTest, LoadRejectsInvalidSnapshots) {
+    MarketManager market_manager;
+    Setup(market_manager);
+    Trade(market_manager, 1000, 19);
+    Snapshot::Save(market_manager, path);
+
+    MarketManager non_empty;
+    Setup(non_empty);
+    EXPECT_THROW(Snapshot::Load(non_empty, path), std::logic_error);
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+    MarketManager truncated;
+    EXPECT_THROW(Snapshot::Load(truncated, path), std::runtime_error);
+
+    MarketManager missing;
+    EXPECT_THROW(Snapshot::Load(missing, path + ".missing"), std::system_error);
+}
+
+TEST_F(SnapshotTest, JournalReplaysAfterSnapshot) {
+    std::filesystem::path directory = path + ".journal";
+    std::filesystem::remove_all(directory);
+
+    MarketManager market_manager;
+    boost::uint64_t sequence;
+    {
+        Journal journal(directory.string());
+        market_manager.AttachJournal(journal);
+        Setup(market_manager);
+        Trade(market_manager, 2000, 23);
+        sequence = journal.sequence();
+        market_manager.DetachJournal();
+    }
+    Snapshot::Save(market_manager, path, sequence);
+    {
+        Journal journal(directory.string());
+        market_manager.AttachJournal(journal);
+        Trade(market_manager, 2000, 29);
+        market_manager.DetachJournal();
+    }
+
+    // Only the segment written after the snapshot survives and the snapshot plus its records restore the state
+    Journal::RemoveSegments(directory.string(), sequence);
+    MarketManager restarted;
+    ASSERT_EQ(sequence, Snapshot::Load(restarted, path));
+    JournalReader reader(directory.string(), sequence);
+    EXPECT_EQ(1, reader.segments());
+    EXPECT_GT(reader.Replay(restarted), 0);
+    ExpectSameState(market_manager, restarted);
+
+    std::filesystem::remove_all(directory);
+}
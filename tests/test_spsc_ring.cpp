@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "../src/spsc_ring.hpp"
+
+TEST(SpscRingTest, CapacityTest) {
+    EXPECT_EQ(2, SpscRing<int>(0).capacity());
+    EXPECT_EQ(8, SpscRing<int>(5).capacity());
+    EXPECT_EQ(1024, SpscRing<int>(1024).capacity());
+}
+
+TEST(SpscRingTest, PushPopTest) {
+    SpscRing<int> ring(4);
+    int value;
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.TryPop(value));
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.TryPush(i));
+    EXPECT_FALSE(ring.TryPush(4));
+    EXPECT_EQ(4, ring.size());
+
+    EXPECT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(ring.TryPush(4));
+
+    for (int i = 1; i < 5; ++i) {
+        EXPECT_TRUE(ring.TryPop(value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, DrainTest) {
+    SpscRing<int> ring(8);
+
+    // Push and drain across the end of the storage a few times
+    int expected = 0;
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 6; ++i)
+            ring.Push(round * 6 + i);
+
+        EXPECT_EQ(2, ring.Drain([&expected](int value) { EXPECT_EQ(expected++, value); }, 2));
+        EXPECT_EQ(4, ring.Drain([&expected](int value) { EXPECT_EQ(expected++, value); }));
+        EXPECT_EQ(0, ring.Drain([](int) { FAIL(); }));
+    }
+    EXPECT_EQ(30, expected);
+}
+
+TEST(SpscRingTest, ThreadsTest) {
+    constexpr boost::uint64_t count = 1000000;
+    SpscRing<boost::uint64_t> ring(64);
+
+    std::thread producer([&ring]() {
+        for (boost::uint64_t i = 0; i < count; ++i)
+            ring.Push(i);
+    });
+
+    boost::uint64_t expected = 0;
+    bool ordered = true;
+    while (expected < count) {
+        if (ring.Drain([&expected, &ordered](boost::uint64_t value) { ordered &= (value == expected++); }) == 0)
+            std::this_thread::yield();
+    }
+
+    producer.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+#include "../src/state_hash.hpp"
+
+class StateHashTest : public ::testing::Test {
+protected:
+    const Symbol test_symbol{0, "USDRUB"};
+
+    void Setup(MarketManager &market_manager) const {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol);
+        market_manager.AddUser(User(0, "user0"));
+        market_manager.AddUser(User(1, "user1"));
+        market_manager.AddOrder(Order::Buy(1, test_symbol.Id, 0, 100, 10));
+        market_manager.AddOrder(Order::Sell(2, test_symbol.Id, 1, 105, 10));
+        market_manager.AddOrder(Order::BuyStopLimit(3, test_symbol.Id, 0, 110, 106, 5));
+    }
+};
+
+TEST_F(StateHashTest, SameCommandsHashTheSame) {
+    MarketManager market_manager1;
+    MarketManager market_manager2;
+    Setup(market_manager1);
+    Setup(market_manager2);
+    EXPECT_EQ(StateHash::Compute(market_manager1), StateHash::Compute(market_manager2));
+
+    MarketManager empty;
+    EXPECT_NE(StateHash::Compute(empty), StateHash::Compute(market_manager1));
+}
+
+TEST_F(StateHashTest, FillsChangeTheHash) {
+    MarketManager market_manager1;
+    MarketManager market_manager2;
+    Setup(market_manager1);
+    Setup(market_manager2);
+
+    // The same resting quantity, but one sell filled against the bid and moved the balances
+    market_manager1.AddOrder(Order::Sell(4, test_symbol.Id, 1, 100, 4));
+    market_manager2.AddOrder(Order::Sell(4, test_symbol.Id, 1, 101, 4));
+    market_manager2.DeleteOrder(4);
+    EXPECT_NE(StateHash::Compute(market_manager1), StateHash::Compute(market_manager2));
+
+    MarketManager market_manager3;
+    Setup(market_manager3);
+    market_manager3.AddOrder(Order::Sell(4, test_symbol.Id, 1, 100, 4));
+    EXPECT_EQ(StateHash::Compute(market_manager1), StateHash::Compute(market_manager3));
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+
+#include "../src/market_manager.hpp"
+
+class MarketManagerStopOrdersTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+    const User test_user2{2, "user2"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol);
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+        market_manager.AddUser(test_user2);
+    }
+
+    void TearDown() override {
+        market_manager.DeleteUser(test_user0.Id);
+        market_manager.DeleteUser(test_user1.Id);
+        market_manager.DeleteUser(test_user2.Id);
+        market_manager.DeleteOrderBook(test_symbol.Id);
+        market_manager.DeleteSymbol(test_symbol.Id);
+    }
+};
+
+TEST_F(MarketManagerStopOrdersTest, BuyStopActivation) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol.Id, test_user0.Id, 103, 10));
+
+    const Order order3 = Order::BuyStopLimit(3, test_symbol.Id, test_user2.Id, 105, 102, 5);
+    EXPECT_EQ(ErrorCode::OK, market_manager.AddOrder(order3));
+
+    EXPECT_EQ(3, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(order3.StopPrice, market_manager.GetOrderBook(test_symbol.Id)->best_buy_stop()->Price);
+    EXPECT_TRUE(market_manager.GetOrder(order3.Id)->IsStopLimit());
+
+    market_manager.AddOrder(Order::Buy(4, test_symbol.Id, test_user1.Id, 100, 10));
+
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_buy_stop());
+    EXPECT_EQ(5, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->TotalVolume);
+    EXPECT_EQ(nullptr, market_manager.GetOrder(order3.Id));
+    EXPECT_EQ(-(103 * 5), market_manager.GetUser(test_user2.Id)->Balance);
+
+    market_manager.DeleteOrder(2);
+}
+
+TEST_F(MarketManagerStopOrdersTest, SellStopActivation) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 97, 10));
+
+    const Order order3 = Order::SellStopLimit(3, test_symbol.Id, test_user2.Id, 95, 98, 5);
+    market_manager.AddOrder(order3);
+
+    EXPECT_EQ(order3.StopPrice, market_manager.GetOrderBook(test_symbol.Id)->best_sell_stop()->Price);
+
+    market_manager.AddOrder(Order::Sell(4, test_symbol.Id, test_user1.Id, 100, 10));
+
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(5, market_manager.GetOrderBook(test_symbol.Id)->best_bid()->TotalVolume);
+    EXPECT_EQ(97 * 5, market_manager.GetUser(test_user2.Id)->Balance);
+
+    market_manager.DeleteOrder(2);
+}
+
+TEST_F(MarketManagerStopOrdersTest, ImmediateActivation) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::BuyStopLimit(2, test_symbol.Id, test_user1.Id, 100, 99, 5));
+
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_buy_stop());
+    EXPECT_EQ(-(100 * 5), market_manager.GetUser(test_user1.Id)->Balance);
+
+    market_manager.DeleteOrder(1);
+}
+
+TEST_F(MarketManagerStopOrdersTest, DeleteStopOrder) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::BuyStopLimit(2, test_symbol.Id, test_user1.Id, 110, 105, 5));
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.DeleteOrder(2));
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_buy_stop());
+    EXPECT_EQ(nullptr, market_manager.GetOrder(2));
+
+    market_manager.DeleteOrder(1);
+}
+
+TEST_F(MarketManagerStopOrdersTest, TrailingBuyStop) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user1.Id, 100, 1));
+
+    const Order order3 = Order::TrailingBuyStopLimit(3, test_symbol.Id, test_user2.Id, 120, 200, 5, 5);
+    market_manager.AddOrder(order3);
+
+    EXPECT_TRUE(market_manager.GetOrder(order3.Id)->IsTrailingStopLimit());
+    EXPECT_EQ(105, market_manager.GetOrder(order3.Id)->StopPrice);
+    EXPECT_EQ(105, market_manager.GetOrderBook(test_symbol.Id)->best_trailing_buy_stop()->Price);
+
+    market_manager.AddOrder(Order::Sell(4, test_symbol.Id, test_user0.Id, 97, 10));
+    market_manager.AddOrder(Order::Buy(5, test_symbol.Id, test_user1.Id, 97, 1));
+
+    EXPECT_EQ(102, market_manager.GetOrder(order3.Id)->StopPrice);
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->trailing_buy_stop().size());
+    EXPECT_EQ(102, market_manager.GetOrderBook(test_symbol.Id)->best_trailing_buy_stop()->Price);
+
+    market_manager.AddOrder(Order::Sell(6, test_symbol.Id, test_user0.Id, 104, 10));
+
+    EXPECT_EQ(102, market_manager.GetOrder(order3.Id)->StopPrice);
+
+    market_manager.AddOrder(Order::Buy(7, test_symbol.Id, test_user1.Id, 104, 18));
+
+    EXPECT_EQ(nullptr, market_manager.GetOrder(order3.Id));
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_trailing_buy_stop());
+    EXPECT_EQ(5, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->TotalVolume);
+    EXPECT_EQ(-(104 * 5), market_manager.GetUser(test_user2.Id)->Balance);
+
+    market_manager.DeleteOrder(6);
+}
+
+TEST_F(MarketManagerStopOrdersTest, TrailingStep) {
+    market_manager.AddOrder(Order::Sell(1, test_symbol.Id, test_user0.Id, 100, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user1.Id, 100, 1));
+    market_manager.AddOrder(Order::TrailingBuyStopLimit(3, test_symbol.Id, test_user2.Id, 120, 200, 5, 5, 3));
+
+    EXPECT_EQ(105, market_manager.GetOrder(3)->StopPrice);
+
+    market_manager.AddOrder(Order::Sell(4, test_symbol.Id, test_user0.Id, 98, 10));
+    market_manager.AddOrder(Order::Buy(5, test_symbol.Id, test_user1.Id, 98, 1));
+
+    EXPECT_EQ(105, market_manager.GetOrder(3)->StopPrice);
+
+    market_manager.AddOrder(Order::Sell(6, test_symbol.Id, test_user0.Id, 97, 10));
+    market_manager.AddOrder(Order::Buy(7, test_symbol.Id, test_user1.Id, 97, 1));
+
+    EXPECT_EQ(102, market_manager.GetOrder(3)->StopPrice);
+
+    market_manager.DeleteOrder(1);
+    market_manager.DeleteOrder(3);
+    market_manager.DeleteOrder(4);
+    market_manager.DeleteOrder(6);
+}
+
+TEST_F(MarketManagerStopOrdersTest, TrailingSellStopPercentage) {
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 1000, 10));
+    market_manager.AddOrder(Order::Sell(2, test_symbol.Id, test_user1.Id, 1000, 1));
+
+    const Order order3 = Order::TrailingSellStopLimit(3, test_symbol.Id, test_user2.Id, 900, 0, 5, -100);
+    market_manager.AddOrder(order3);
+
+    EXPECT_EQ(990, market_manager.GetOrder(order3.Id)->StopPrice);
+
+    market_manager.AddOrder(Order::Buy(4, test_symbol.Id, test_user0.Id, 1100, 10));
+    market_manager.AddOrder(Order::Sell(5, test_symbol.Id, test_user1.Id, 1100, 1));
+
+    EXPECT_EQ(1089, market_manager.GetOrder(order3.Id)->StopPrice);
+    EXPECT_EQ(1089, market_manager.GetOrderBook(test_symbol.Id)->best_trailing_sell_stop()->Price);
+
+    EXPECT_EQ(ErrorCode::OK, market_manager.DeleteOrder(order3.Id));
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_trailing_sell_stop());
+
+    market_manager.AddOrder(Order::Buy(6, test_symbol.Id, test_user0.Id, 1200, 10));
+    market_manager.AddOrder(Order::Sell(7, test_symbol.Id, test_user1.Id, 1200, 1));
+
+    EXPECT_EQ(3, market_manager.GetOrderBook(test_symbol.Id)->size());
+
+    market_manager.DeleteOrder(1);
+    market_manager.DeleteOrder(4);
+    market_manager.DeleteOrder(6);
+}
+
+TEST_F(MarketManagerStopOrdersTest, StopCascade) {
+    for (boost::uint64_t price = 100; price < 105; ++price)
+        market_manager.AddOrder(Order::Sell(price, test_symbol.Id, test_user0.Id, price, 1));
+    market_manager.AddOrder(Order::Buy(6, test_symbol.Id, test_user0.Id, 96, 1));
+
+    market_manager.AddOrder(Order::BuyStopLimit(1, test_symbol.Id, test_user1.Id, 110, 101, 1));
+    market_manager.AddOrder(Order::BuyStopLimit(2, test_symbol.Id, test_user2.Id, 110, 101, 1));
+    market_manager.AddOrder(Order::BuyStopLimit(3, test_symbol.Id, test_user1.Id, 110, 103, 1));
+    market_manager.AddOrder(Order::SellStopLimit(4, test_symbol.Id, test_user2.Id, 90, 95, 1));
+
+    market_manager.AddOrder(Order::Buy(5, test_symbol.Id, test_user2.Id, 100, 1));
+
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_buy_stop());
+    EXPECT_EQ(104, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->Price);
+    EXPECT_EQ(-(101 + 103), market_manager.GetUser(test_user1.Id)->Balance);
+    EXPECT_EQ(-(100 + 102), market_manager.GetUser(test_user2.Id)->Balance);
+    EXPECT_NE(nullptr, market_manager.GetOrder(4));
+
+    market_manager.DeleteOrder(4);
+    market_manager.DeleteOrder(6);
+    market_manager.DeleteOrder(104);
+}
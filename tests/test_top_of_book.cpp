@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "../src/market_manager.hpp"
+#include "../src/top_of_book.hpp"
+
+TEST(TopOfBookSeqLockTest, StoreLoadTest) {
+    TopOfBookSeqLock seqlock;
+
+    EXPECT_EQ(0, seqlock.version());
+    EXPECT_EQ(TopOfBook{}, seqlock.Load());
+
+    TopOfBook top{99, 10, 1, 101, 20, 2, 100, 100};
+    seqlock.Store(top);
+
+    EXPECT_EQ(1, seqlock.version());
+    EXPECT_EQ(top, seqlock.Load());
+}
+
+TEST(TopOfBookSeqLockTest, ThreadsTest) {
+    constexpr boost::uint64_t count = 100000;
+    TopOfBookSeqLock seqlock;
+    std::atomic<bool> done(false);
+
+    std::thread writer([&seqlock, &done]() {
+        for (boost::uint64_t i = 1; i <= count; ++i)
+            seqlock.Store({i, i, i, i, i, i, i, i});
+        done = true;
+    });
+
+    // Every load has to return one of the stored records whole
+    bool consistent = true;
+    boost::uint64_t previous = 0;
+    while (!done.load()) {
+        TopOfBook top = seqlock.Load();
+        consistent &= (top == TopOfBook{top.BidPrice, top.BidPrice, top.BidPrice, top.BidPrice, top.BidPrice,
+                                        top.BidPrice, top.BidPrice, top.BidPrice}) && (top.BidPrice >= previous);
+        previous = top.BidPrice;
+        std::this_thread::yield();
+    }
+
+    writer.join();
+
+    EXPECT_TRUE(consistent);
+    EXPECT_EQ(count, seqlock.Load().BidPrice);
+    EXPECT_EQ(count, seqlock.version());
+}
+
+class TopOfBookTest : public ::testing::Test {
+protected:
+    MarketManager market_manager;
+    const Symbol test_symbol{0, "USDRUB"};
+    const User test_user0{0, "user0"};
+    const User test_user1{1, "user1"};
+
+    void SetUp() override {
+        market_manager.AddSymbol(test_symbol);
+        market_manager.AddOrderBook(test_symbol);
+        market_manager.AddUser(test_user0);
+        market_manager.AddUser(test_user1);
+    }
+
+    void TearDown() override {
+        market_manager.DeleteUser(test_user0.Id);
+        market_manager.DeleteUser(test_user1.Id);
+        market_manager.DeleteOrderBook(test_symbol.Id);
+        market_manager.DeleteSymbol(test_symbol.Id);
+    }
+};
+
+TEST_F(TopOfBookTest, MarketManagerTest) {
+    const TopOfBookSeqLock *top_ptr = market_manager.GetTopOfBook(test_symbol.Id);
+    ASSERT_NE(nullptr, top_ptr);
+    EXPECT_EQ(nullptr, market_manager.GetTopOfBook(1));
+
+    market_manager.AddOrder(Order::Buy(1, test_symbol.Id, test_user0.Id, 99, 10));
+    market_manager.AddOrder(Order::Buy(2, test_symbol.Id, test_user0.Id, 99, 5));
+    market_manager.AddOrder(Order::Sell(3, test_symbol.Id, test_user0.Id, 101, 20, 7));
+
+    EXPECT_EQ((TopOfBook{99, 15, 2, 101, 7, 1, 0, 0}), top_ptr->Load());
+
+    market_manager.AddOrder(Order::Buy(4, test_symbol.Id, test_user1.Id, 101, 20));
+
+    EXPECT_EQ((TopOfBook{99, 15, 2, 0, 0, 0, 101, 101}), top_ptr->Load());
+
+    // A change behind the best levels does not touch the record
+    boost::uint64_t version = top_ptr->version();
+    market_manager.AddOrder(Order::Buy(5, test_symbol.Id, test_user0.Id, 90, 1));
+    EXPECT_EQ(version, top_ptr->version());
+
+    market_manager.DeleteOrder(1);
+    market_manager.DeleteOrder(2);
+    market_manager.DeleteOrder(5);
+
+    EXPECT_EQ((TopOfBook{0, 0, 0, 0, 0, 0, 101, 101}), top_ptr->Load());
+}
@@ -248,3 +248,41 @@ TEST_F(MarketManagerTradingTest, PartialFillWithCancelledOrderSell) {
     // The container only stores a reference and that you must make sure that the inserted elements stay alive longer than the container.
     market_manager.DeleteOrder(order1.Id);
 }
+
+TEST_F(MarketManagerTradingTest, MultipleLevelsMatchingSell) {
+    for (boost::uint64_t price = 100; price < 104; ++price)
+        market_manager.AddOrder(Order::Buy(price, test_symbol.Id, test_user0.Id, price, 10));
+
+    const Order order = Order::Sell(200, test_symbol.Id, test_user1.Id, 101, 25);
+    market_manager.AddOrder(order);
+
+    EXPECT_EQ(2, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(101, market_manager.GetOrderBook(test_symbol.Id)->best_bid()->Price);
+    EXPECT_EQ(5, market_manager.GetOrderBook(test_symbol.Id)->best_bid()->TotalVolume);
+    EXPECT_EQ(-(103 * 10 + 102 * 10 + 101 * 5), market_manager.GetUser(test_user0.Id)->Balance);
+    EXPECT_EQ(103 * 10 + 102 * 10 + 101 * 5, market_manager.GetUser(test_user1.Id)->Balance);
+
+    market_manager.DeleteOrder(100);
+    market_manager.DeleteOrder(101);
+
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_bid());
+}
+
+TEST_F(MarketManagerTradingTest, SweepManyLevelsBuy) {
+    for (boost::uint64_t price = 100; price < 150; ++price)
+        market_manager.AddOrder(Order::Sell(price, test_symbol.Id, test_user0.Id, price, 2));
+
+    EXPECT_EQ(50, market_manager.GetOrderBook(test_symbol.Id)->size());
+
+    const Order order = Order::Buy(1, test_symbol.Id, test_user1.Id, 200, 99);
+    market_manager.AddOrder(order);
+
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->size());
+    EXPECT_EQ(1, market_manager.orders().size());
+    EXPECT_EQ(1, market_manager.order_pool_stats().Used);
+    EXPECT_EQ(149, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->Price);
+    EXPECT_EQ(1, market_manager.GetOrderBook(test_symbol.Id)->best_ask()->TotalVolume);
+    EXPECT_EQ(nullptr, market_manager.GetOrderBook(test_symbol.Id)->best_bid());
+
+    market_manager.DeleteOrder(149);
+}
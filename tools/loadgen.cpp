@@ -0,0 +1,318 @@
+#include <utility>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include "../src/common.hpp"
+#include "../src/latency_stats.hpp"
+
+// Load generator for the JSON order entry port. Every connection registers its own user and then sends AddOrder
+// requests, either on a fixed schedule that together makes up the requested rate (open loop) or whenever one of its
+// outstanding requests is acknowledged (closed loop). Prices are drawn from a normal distribution around the mid
+// price and sides with the given buy ratio, so the flow both rests and crosses. Open loop latencies are measured from
+// the scheduled send time, a server that falls behind shows up in them instead of slowing the load down.
+//
+//   stock_exchange_loadgen [--host <address>] [--port <port>] [--connections <n>] [--duration <seconds>]
+//                          [--closed <outstanding per connection>] [--rate <orders/s>] [--mid <price>]
+//                          [--price-stddev <ticks>] [--buy-ratio <share>] [--max-quantity <n>] [--seed <n>]
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+class LoadOptions {
+public:
+    std::string Host = "127.0.0.1";
+    boost::uint16_t Port = PORT;
+    size_t Connections = 8;
+    double Duration = 10;
+    // Outstanding requests per connection in closed loop, zero runs open loop at Rate
+    size_t Window = 0;
+    double Rate = 10000;
+    boost::uint64_t MidPrice = 1000;
+    double PriceStdDev = 5;
+    double BuyRatio = 0.5;
+    boost::uint64_t MaxQuantity = 10;
+    unsigned Seed = 1;
+};
+
+class LoadStats {
+public:
+    LatencyHistogram Latency;
+    boost::uint64_t Sent = 0;
+    boost::uint64_t Acknowledged = 0;
+    boost::uint64_t Rejected = 0;
+    size_t Connected = 0;
+};
+
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(boost::asio::io_context &io_context, const LoadOptions &options, LoadStats &stats, size_t index,
+               Clock::time_point start, Clock::time_point end)
+            : socket_(io_context), timer_(io_context), acknowledged_(io_context, Clock::time_point::max()),
+              options_(options), stats_(stats), index_(index), start_(start), end_(end),
+              random_(options.Seed + unsigned(index)), price_(double(options.MidPrice), options.PriceStdDev),
+              side_(options.BuyRatio), quantity_(1, options.MaxQuantity), sending_(true), waiting_(false) {
+    }
+
+    void Start() {
+        boost::asio::co_spawn(socket_.get_executor(), Run(shared_from_this()), boost::asio::detached);
+    }
+
+private:
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::steady_timer timer_;
+    // Never expires, cancelled by the reader to wake a closed loop sender waiting for acknowledgements
+    boost::asio::steady_timer acknowledged_;
+    const LoadOptions &options_;
+    LoadStats &stats_;
+    size_t index_;
+    Clock::time_point start_;
+    Clock::time_point end_;
+
+    std::mt19937_64 random_;
+    std::normal_distribution<double> price_;
+    std::bernoulli_distribution side_;
+    std::uniform_int_distribution<boost::uint64_t> quantity_;
+
+    boost::asio::streambuf input_;
+    std::string output_;
+    // Send times of the requests awaiting their reply, in request order
+    std::deque<Clock::time_point> outstanding_;
+    bool sending_;
+    bool waiting_;
+
+    boost::asio::awaitable<void> Run(std::shared_ptr<Connection> self) {
+        boost::system::error_code error;
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address(options_.Host), options_.Port);
+        co_await socket_.async_connect(endpoint, boost::asio::redirect_error(boost::asio::use_awaitable, error));
+        if (error) {
+            std::cerr << "Connection " << index_ << ": " << error.message() << std::endl;
+            co_return;
+        }
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+
+        output_ = R"({"ReqType":)" + std::to_string(boost::uint64_t(Requests::Registration)) +
+                  R"(,"Username":"loadgen)" + std::to_string(index_) + R"("})";
+        co_await boost::asio::async_write(socket_, boost::asio::buffer(output_),
+                                          boost::asio::redirect_error(boost::asio::use_awaitable, error));
+        std::string reply;
+        if (!error)
+            reply = co_await ReadLine(error);
+        if (error || (reply.find("Registration is successful!") == std::string::npos)) {
+            std::cerr << "Connection " << index_ << ": registration failed" << std::endl;
+            co_return;
+        }
+        ++stats_.Connected;
+
+        boost::asio::co_spawn(socket_.get_executor(), (options_.Window > 0) ? SendClosed(self) : SendOpen(self),
+                              boost::asio::detached);
+
+        for (;;) {
+            if (!sending_ && outstanding_.empty())
+                break;
+            reply = co_await ReadLine(error);
+            if (error || outstanding_.empty())
+                break;
+
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - outstanding_.front());
+            outstanding_.pop_front();
+            stats_.Latency.Record(boost::uint64_t(std::max<Clock::rep>(latency.count(), 0)));
+            ++stats_.Acknowledged;
+            if (reply.find("successfully created") == std::string::npos)
+                ++stats_.Rejected;
+
+            if (waiting_)
+                acknowledged_.cancel();
+        }
+
+        sending_ = false;
+        socket_.close(error);
+        timer_.cancel();
+        acknowledged_.cancel();
+    }
+
+    // Sends on a fixed schedule, every connection taking its turn within the period. Requests due while a write is
+    // in flight go out together in the next one, stamped with the time they were due.
+    boost::asio::awaitable<void> SendOpen(std::shared_ptr<Connection> self) {
+        boost::system::error_code error;
+        auto period = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(double(options_.Connections) / options_.Rate));
+        Clock::time_point next = start_ + period * index_ / options_.Connections;
+
+        while (socket_.is_open() && (next < end_)) {
+            if (next > Clock::now()) {
+                timer_.expires_at(next);
+                co_await timer_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, error));
+                if (!socket_.is_open())
+                    break;
+            }
+
+            output_.clear();
+            for (auto now = Clock::now(); (next <= now) && (next < end_); next += period) {
+                AppendOrder();
+                outstanding_.push_back(next);
+            }
+            co_await boost::asio::async_write(socket_, boost::asio::buffer(output_),
+                                              boost::asio::redirect_error(boost::asio::use_awaitable, error));
+            if (error)
+                break;
+        }
+        StopSending();
+    }
+
+    // Keeps the window of requests outstanding until the end of the run
+    boost::asio::awaitable<void> SendClosed(std::shared_ptr<Connection> self) {
+        boost::system::error_code error;
+        while (socket_.is_open() && (Clock::now() < end_)) {
+            if (outstanding_.size() >= options_.Window) {
+                waiting_ = true;
+                co_await acknowledged_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, error));
+                waiting_ = false;
+                continue;
+            }
+
+            output_.clear();
+            auto now = Clock::now();
+            while (outstanding_.size() < options_.Window) {
+                AppendOrder();
+                outstanding_.push_back(now);
+            }
+            co_await boost::asio::async_write(socket_, boost::asio::buffer(output_),
+                                              boost::asio::redirect_error(boost::asio::use_awaitable, error));
+            if (error)
+                break;
+        }
+        StopSending();
+    }
+
+    // The reader stops once the last reply is in, or right away when none is owed
+    void StopSending() {
+        sending_ = false;
+        boost::system::error_code error;
+        if (outstanding_.empty())
+            socket_.close(error);
+    }
+
+    void AppendOrder() {
+        auto price = boost::uint64_t(std::max<double>(std::llround(price_(random_)), 1));
+        bool buy = side_(random_);
+        output_ += R"({"ReqType":)" + std::to_string(boost::uint64_t(Requests::AddOrder)) + R"(,"SymbolId":0,"Type":")" +
+                   (buy ? "Buy" : "Sell") + R"(","Price":)" + std::to_string(price) + R"(,"Quantity":)" +
+                   std::to_string(quantity_(random_)) + "}";
+        ++stats_.Sent;
+    }
+
+    boost::asio::awaitable<std::string> ReadLine(boost::system::error_code &error) {
+        size_t size = co_await boost::asio::async_read_until(
+                socket_, input_, '\n', boost::asio::redirect_error(boost::asio::use_awaitable, error));
+        if (error)
+            co_return std::string();
+        std::string line(boost::asio::buffers_begin(input_.data()), boost::asio::buffers_begin(input_.data()) + size);
+        input_.consume(size);
+        co_return line;
+    }
+};
+
+void Usage() {
+    std::cerr << "Usage: stock_exchange_loadgen [--host <address>] [--port <port>] [--connections <n>]"
+                 " [--duration <seconds>] [--closed <outstanding per connection>] [--rate <orders/s>] [--mid <price>]"
+                 " [--price-stddev <ticks>] [--buy-ratio <share>] [--max-quantity <n>] [--seed <n>]" << std::endl;
+}
+
+bool ParseOptions(int argc, char *argv[], LoadOptions &options) {
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc)
+            return false;
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--host")
+            options.Host = value;
+        else if (name == "--port")
+            options.Port = boost::uint16_t(std::stoul(value));
+        else if (name == "--connections")
+            options.Connections = std::max<size_t>(std::stoul(value), 1);
+        else if (name == "--duration")
+            options.Duration = std::stod(value);
+        else if (name == "--closed")
+            options.Window = std::max<size_t>(std::stoul(value), 1);
+        else if (name == "--rate")
+            options.Rate = std::max(std::stod(value), 1.0);
+        else if (name == "--mid")
+            options.MidPrice = std::stoull(value);
+        else if (name == "--price-stddev")
+            options.PriceStdDev = std::stod(value);
+        else if (name == "--buy-ratio")
+            options.BuyRatio = std::stod(value);
+        else if (name == "--max-quantity")
+            options.MaxQuantity = std::max<boost::uint64_t>(std::stoull(value), 1);
+        else if (name == "--seed")
+            options.Seed = unsigned(std::stoul(value));
+        else
+            return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    LoadOptions options;
+    try {
+        if (!ParseOptions(argc, argv, options)) {
+            Usage();
+            return EXIT_FAILURE;
+        }
+    } catch (std::exception &) {
+        Usage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        boost::asio::io_context io_context;
+        LoadStats stats;
+
+        // Connecting and registering happen before the measured window starts
+        auto start = Clock::now() + std::chrono::milliseconds(500);
+        auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.Duration));
+        for (size_t i = 0; i < options.Connections; ++i)
+            std::make_shared<Connection>(io_context, options, stats, i, start, end)->Start();
+        io_context.run();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << "Mode:        ";
+        if (options.Window > 0)
+            std::cout << "closed loop with " << options.Window << " outstanding";
+        else
+            std::cout << "open loop at " << options.Rate << " orders/s";
+        std::cout << " over " << stats.Connected << " of " << options.Connections << " connections" << std::endl;
+        std::cout << "Orders:      " << stats.Sent << " sent, " << stats.Acknowledged << " acknowledged, "
+                  << stats.Rejected << " rejected" << std::endl;
+        std::cout << "Throughput:  " << std::fixed << std::setprecision(0)
+                  << ((seconds > 0) ? double(stats.Acknowledged) / seconds : 0) << " orders/s" << std::endl;
+
+        auto microseconds = [](boost::uint64_t nanoseconds) { return double(nanoseconds) / 1000; };
+        std::cout << "Round trip:  " << std::setprecision(1) << "p50 " << microseconds(stats.Latency.Percentile(50))
+                  << " us, p90 " << microseconds(stats.Latency.Percentile(90)) << " us, p99 "
+                  << microseconds(stats.Latency.Percentile(99)) << " us, p99.9 "
+                  << microseconds(stats.Latency.Percentile(99.9)) << " us, max "
+                  << microseconds(stats.Latency.max()) << " us" << std::endl;
+        if (stats.Connected == 0)
+            return EXIT_FAILURE;
+    } catch (std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/journal.hpp"
+#include "../src/market_manager.hpp"
+#include "../src/snapshot.hpp"
+#include "../src/state_hash.hpp"
+
+// Replays a recorded journal into a market manager as fast as it can apply the commands and reports the throughput,
+// the latency percentiles of applying one command and the hash of the final state. Records are decoded outside the
+// timed section. With --expect the exit status tells whether the final state hash matches, so the same journal
+// checks that an engine change kept every fill.
+//
+//   stock_exchange_replay <journal_dir> [--snapshot <path>] [--expect <hash>]
+
+namespace {
+
+void Usage() {
+    std::cerr << "Usage: stock_exchange_replay <journal_dir> [--snapshot <path>] [--expect <hash>]" << std::endl;
+}
+
+boost::uint64_t Percentile(const std::vector<boost::uint64_t> &sorted, double percentile) {
+    if (sorted.empty())
+        return 0;
+    size_t index = size_t(percentile / 100.0 * double(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        Usage();
+        return EXIT_FAILURE;
+    }
+
+    std::string directory = argv[1];
+    std::string snapshot_path;
+    std::string expected_hash;
+    for (int i = 2; i < argc; ++i) {
+        if ((std::strcmp(argv[i], "--snapshot") == 0) && (i + 1 < argc)) {
+            snapshot_path = argv[++i];
+        } else if ((std::strcmp(argv[i], "--expect") == 0) && (i + 1 < argc)) {
+            expected_hash = argv[++i];
+        } else {
+            Usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        MarketManager market_manager;
+        boost::uint64_t snapshot_sequence = 0;
+        if (!snapshot_path.empty())
+            snapshot_sequence = Snapshot::Load(market_manager, snapshot_path);
+
+        JournalReader reader(directory, snapshot_sequence);
+        std::vector<boost::uint64_t> latencies;
+        size_t orders = 0;
+        size_t rejected = 0;
+        JournalRecord record;
+
+        auto start = std::chrono::steady_clock::now();
+        while (reader.Next(record)) {
+            auto apply_start = std::chrono::steady_clock::now();
+            ErrorCode result = JournalReader::Apply(market_manager, record);
+            auto apply_end = std::chrono::steady_clock::now();
+            latencies.push_back(boost::uint64_t(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(apply_end - apply_start).count()));
+
+            if ((record.Type == JournalRecordType::ADD_ORDER) || (record.Type == JournalRecordType::DELETE_ORDER) ||
+                (record.Type == JournalRecordType::MODIFY_ORDER))
+                ++orders;
+            else if (record.Type == JournalRecordType::ADD_ORDERS)
+                orders += record.Orders.size();
+            else if (record.Type == JournalRecordType::DELETE_ORDERS)
+                orders += record.Ids.size();
+            // Only accepted commands are journaled, so a rejection means the engine diverged from the recording
+            if (result != ErrorCode::OK)
+                ++rejected;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::sort(latencies.begin(), latencies.end());
+        boost::uint64_t hash = StateHash::Compute(market_manager);
+
+        std::cout << "Commands:    " << latencies.size() << " (" << rejected << " rejected), " << orders
+                  << " order commands, last sequence " << reader.sequence() << std::endl;
+        std::cout << "Elapsed:     " << std::fixed << std::setprecision(3) << seconds << " s" << std::endl;
+        std::cout << "Throughput:  " << std::setprecision(0) << ((seconds > 0) ? double(orders) / seconds : 0)
+                  << " orders/s, " << ((seconds > 0) ? double(latencies.size()) / seconds : 0) << " commands/s"
+                  << std::endl;
+        std::cout << "Latency ns:  p50 " << Percentile(latencies, 50) << ", p90 " << Percentile(latencies, 90)
+                  << ", p99 " << Percentile(latencies, 99) << ", p99.9 " << Percentile(latencies, 99.9)
+                  << ", p99.99 " << Percentile(latencies, 99.99) << ", max "
+                  << (latencies.empty() ? 0 : latencies.back()) << std::endl;
+        std::cout << "Resting:     " << market_manager.orders().size() << " orders, orders count "
+                  << market_manager.GetOrdersCount() << std::endl;
+        std::cout << "State hash:  " << std::hex << std::setw(16) << std::setfill('0') << hash << std::endl;
+
+        if (rejected > 0)
+            return EXIT_FAILURE;
+        if (!expected_hash.empty() && (std::strtoull(expected_hash.c_str(), nullptr, 16) != hash)) {
+            std::cerr << "State hash differs from the expected " << expected_hash << std::endl;
+            return EXIT_FAILURE;
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}